@@ -0,0 +1,141 @@
+/*
+ * aisdedup.c - time-windowed AIS duplicate suppression
+ *
+ * The table is an array of buckets of AIS_DEDUP_WAYS entries.  A
+ * fingerprint can only live in the bucket its low bits select, so a
+ * lookup touches one cache line; when the bucket is full the entry
+ * heard longest ago makes room.  Nothing is ever deleted, entries
+ * just age out of the window.
+ *
+ * This file is Copyright (c) 2010 by the GPSD project
+ * BSD terms apply: see the file COPYING in the distribution root for details.
+ */
+#include <stdlib.h>
+#include <string.h>
+
+#include "aisdedup.h"
+
+bool ais_dedup_init(struct ais_dedup_t *dd, double window)
+/* set up a table good for AIS_DEDUP_RATE messages/s over window seconds */
+{
+    size_t buckets = 1024;
+
+    while (buckets * AIS_DEDUP_WAYS < window * AIS_DEDUP_RATE
+	   && buckets * AIS_DEDUP_WAYS < AIS_DEDUP_MAX)
+	buckets *= 2;
+
+    memset(dd, '\0', sizeof(*dd));
+    dd->table = (struct ais_dedup_entry_t *)calloc(buckets * AIS_DEDUP_WAYS,
+					   sizeof(struct ais_dedup_entry_t));
+    if (dd->table == NULL)
+	return false;
+    dd->window = window;
+    dd->mask = buckets - 1;
+    return true;
+}
+
+void ais_dedup_free(struct ais_dedup_t *dd)
+{
+    free(dd->table);
+    dd->table = NULL;
+}
+
+size_t ais_dedup_unarmor(const char *payload, int fill,
+			 unsigned char *bits, size_t maxbytes)
+/*
+ * Unpack a 6-bit armored payload, as in field 6 of an AIVDM sentence,
+ * into bits (MSB first, like the AIVDM driver does) and return how many
+ * are valid.  Trailing fill bits are cleared so they can't tell two
+ * copies apart.
+ */
+{
+    size_t bitlen = 0;
+    const char *cp;
+
+    memset(bits, '\0', maxbytes);
+    for (cp = payload; *cp != '\0' && *cp != ','; cp++) {
+	unsigned char ch = (unsigned char)*cp - 48;
+
+	if (ch >= 40)
+	    ch -= 8;
+	if (bitlen + 6 > maxbytes * 8)
+	    break;
+	/* six bits straddle at most two bytes */
+	bits[bitlen / 8] |= (unsigned char)((ch & 0x3f) << 2 >> (bitlen % 8));
+	if (bitlen % 8 > 2)
+	    bits[bitlen / 8 + 1] |= (unsigned char)((ch & 0x3f) << (10 - bitlen % 8));
+	bitlen += 6;
+    }
+    if (fill > 0 && (size_t)fill <= bitlen) {
+	bitlen -= (size_t)fill;
+	if (bitlen % 8 != 0)
+	    bits[bitlen / 8] &= (unsigned char)(0xff << (8 - bitlen % 8));
+	if (bitlen / 8 + 1 < maxbytes)
+	    bits[bitlen / 8 + 1] = '\0';
+    }
+    return bitlen;
+}
+
+uint64_t ais_dedup_hash(uint64_t seed, const unsigned char *bits,
+			size_t bitlen, char channel)
+/*
+ * FNV-1a over the valid payload bits, their count, and the channel.
+ * Pass AIS_DEDUP_SEED for a whole message, or the previous fragment's
+ * value to chain the fragments of one message together.
+ */
+{
+    uint64_t h = seed;
+    size_t i, nbytes = (bitlen + 7) / 8;
+
+#define FNV(b)	h = (h ^ (uint64_t)(b)) * 0x100000001b3ULL
+    for (i = 0; i < nbytes; i++) {
+	unsigned char b = bits[i];
+
+	if (i == nbytes - 1 && bitlen % 8 != 0)
+	    b &= (unsigned char)(0xff << (8 - bitlen % 8));
+	FNV(b);
+    }
+    FNV(bitlen & 0xff);
+    FNV(bitlen >> 8);
+    /* receivers differ on how they name the two channels */
+    if (channel == '1' || channel == '\0')
+	channel = 'A';
+    else if (channel == '2')
+	channel = 'B';
+    FNV(channel);
+#undef FNV
+    return h;
+}
+
+bool ais_dedup_seen(struct ais_dedup_t *dd, uint64_t fingerprint,
+		    timestamp_t now)
+/*
+ * True if fingerprint was already heard within the window; otherwise
+ * remember it and return false.  The window runs from the first copy,
+ * so a stream of copies cannot keep a message suppressed forever.
+ */
+{
+    struct ais_dedup_entry_t *bucket, *victim;
+    int i;
+
+    bucket = dd->table
+	+ ((fingerprint ^ (fingerprint >> 32)) & dd->mask) * AIS_DEDUP_WAYS;
+    victim = bucket;
+    for (i = 0; i < AIS_DEDUP_WAYS; i++) {
+	if (bucket[i].fingerprint == fingerprint) {
+	    if (now - bucket[i].seen < dd->window) {
+		dd->dropped++;
+		return true;
+	    }
+	    victim = &bucket[i];
+	    break;
+	}
+	if (bucket[i].seen < victim->seen)
+	    victim = &bucket[i];
+    }
+    victim->fingerprint = fingerprint;
+    victim->seen = now;
+    return false;
+}
+
+/* aisdedup.c ends here */
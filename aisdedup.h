@@ -0,0 +1,47 @@
+/*
+ * aisdedup.h - drop AIS messages already heard by another receiver
+ *
+ * Several receivers covering the same water each hand in their own
+ * copy of every transmission.  A copy is recognized by a fingerprint
+ * of its payload bits and radio channel; fingerprints are remembered
+ * for a fixed window in a table of fixed size, so memory stays bounded
+ * however busy the channel is.  Under overload the oldest fingerprints
+ * are forgotten first, which costs missed duplicates, never lost
+ * messages.
+ *
+ * This file is Copyright (c) 2010 by the GPSD project
+ * BSD terms apply: see the file COPYING in the distribution root for details.
+ */
+#ifndef _GPSD_AISDEDUP_H_
+#define _GPSD_AISDEDUP_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "gps.h"
+
+#define AIS_DEDUP_SEED		0xcbf29ce484222325ULL	/* FNV-1a offset basis */
+#define AIS_DEDUP_WAYS		4	/* entries per bucket, one cache line */
+#define AIS_DEDUP_RATE		20000	/* messages/s the table is sized for */
+#define AIS_DEDUP_MAX		(1 << 20)	/* cap on entries */
+
+struct ais_dedup_entry_t {
+    uint64_t fingerprint;
+    timestamp_t seen;		/* when first heard */
+};
+
+struct ais_dedup_t {
+    double window;		/* seconds a fingerprint is remembered */
+    size_t mask;		/* buckets - 1 */
+    struct ais_dedup_entry_t *table;
+    unsigned long dropped;	/* duplicates reported so far */
+};
+
+extern bool ais_dedup_init(struct ais_dedup_t *, double);
+extern void ais_dedup_free(struct ais_dedup_t *);
+extern size_t ais_dedup_unarmor(const char *, int, unsigned char *, size_t);
+extern uint64_t ais_dedup_hash(uint64_t, const unsigned char *, size_t, char);
+extern bool ais_dedup_seen(struct ais_dedup_t *, uint64_t, timestamp_t);
+
+#endif /* _GPSD_AISDEDUP_H_ */
@@ -0,0 +1,317 @@
+/*
+ * capture.c - write, seek in and replay packet capture files
+ *
+ * See capture.h for the layout.  Writers frame the data themselves with
+ * capture_file_header() and capture_record_header(), which lets them
+ * keep their own buffering, and report each record's offset to
+ * capture_index_note() to maintain the sparse index.
+ *
+ * This file is Copyright (c) 2010 by the GPSD project
+ * BSD terms apply: see the file COPYING in the distribution root for details.
+ */
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/types.h>
+
+#include "gps.h"
+#include "bits.h"
+#include "capture.h"
+#include "strfuncs.h"
+
+#define putle64(buf, off, v) do {putle32(buf, (off)+4, (uint64_t)(v) >> 32); putle32(buf, (off), (uint64_t)(v) & 0xffffffff);} while (0)
+
+/* writer side */
+
+void capture_file_header(unsigned char *buf, int64_t started)
+/* fill in CAPTURE_HEADER_LEN bytes of file header */
+{
+    memset(buf, '\0', CAPTURE_HEADER_LEN);
+    memcpy(buf, CAPTURE_MAGIC, 8);
+    putle32(buf, 8, CAPTURE_VERSION);
+    putle32(buf, 12, CAPTURE_HEADER_LEN);
+    putle64(buf, 16, started);
+}
+
+size_t capture_record_header(unsigned char *buf, int64_t mono, int64_t real,
+			     int type, const char *device, size_t len)
+/*
+ * Fill in a record header, followed by the device name; the data go
+ * right after.  Returns the bytes used, at most
+ * CAPTURE_RECORD_LEN + CAPTURE_DEVICE_MAX - 1.
+ */
+{
+    size_t devlen = (device == NULL) ? 0 : strlen(device);
+
+    if (devlen > CAPTURE_DEVICE_MAX - 1)
+	devlen = CAPTURE_DEVICE_MAX - 1;
+    memset(buf, '\0', CAPTURE_RECORD_LEN);
+    putle32(buf, 0, CAPTURE_SYNC);
+    putle32(buf, 4, len);
+    putle64(buf, 8, mono);
+    putle64(buf, 16, real);
+    putle16(buf, 24, (uint16_t)type);
+    putle16(buf, 26, devlen);
+    if (devlen > 0)
+	memcpy(buf + CAPTURE_RECORD_LEN, device, devlen);
+    return CAPTURE_RECORD_LEN + devlen;
+}
+
+bool capture_index_open(struct capture_index_t *idx, const char *path)
+/* start the index for the capture at path */
+{
+    char name[GPS_PATH_MAX + 8];
+
+    (void)snprintf(name, sizeof(name), "%s.idx", path);
+    idx->next = 0;
+    if ((idx->fp = fopen(name, "wb")) == NULL)
+	return false;
+    (void)fwrite(CAPTURE_INDEX_MAGIC, 1, 8, idx->fp);
+    return true;
+}
+
+void capture_index_note(struct capture_index_t *idx, int64_t real,
+			uint64_t offset)
+/* a record at offset has realtime real; index it if a step has passed */
+{
+    unsigned char entry[16];
+
+    if (idx->fp == NULL || real < idx->next)
+	return;
+    putle64(entry, 0, real);
+    putle64(entry, 8, offset);
+    (void)fwrite(entry, 1, sizeof(entry), idx->fp);
+    /* stdio holds it; a lost tail only costs a longer scan */
+    idx->next = (real / CAPTURE_INDEX_STEP + 1) * CAPTURE_INDEX_STEP;
+}
+
+void capture_index_close(struct capture_index_t *idx)
+{
+    if (idx->fp != NULL)
+	(void)fclose(idx->fp);
+    idx->fp = NULL;
+}
+
+/* reader side */
+
+bool capture_open(struct capture_t *cap, const char *path)
+/* open a capture for reading and check its header */
+{
+    unsigned char hdr[CAPTURE_HEADER_LEN];
+
+    memset(cap, '\0', sizeof(*cap));
+    if ((cap->fp = fopen(path, "rb")) == NULL)
+	return false;
+    if (fread(hdr, 1, sizeof(hdr), cap->fp) != sizeof(hdr)
+	|| memcmp(hdr, CAPTURE_MAGIC, 8) != 0
+	|| getleu32(hdr, 8) != CAPTURE_VERSION
+	|| getleu32(hdr, 12) < CAPTURE_HEADER_LEN) {
+	(void)fclose(cap->fp);
+	cap->fp = NULL;
+	errno = EINVAL;
+	return false;
+    }
+    cap->start = getles64(hdr, 16);
+    cap->path = strdup(path);
+    /* later versions may have a longer header */
+    (void)fseeko(cap->fp, (off_t)getleu32(hdr, 12), SEEK_SET);
+    return true;
+}
+
+void capture_close(struct capture_t *cap)
+{
+    if (cap->fp != NULL)
+	(void)fclose(cap->fp);
+    free(cap->path);
+    free(cap->buf);
+    memset(cap, '\0', sizeof(*cap));
+}
+
+int capture_next(struct capture_t *cap, struct capture_record_t *rec)
+/*
+ * Read the next record.  Returns 1, or 0 at the end of the file.  A
+ * damaged stretch is skipped up to the next sync word.
+ */
+{
+    unsigned char hdr[CAPTURE_RECORD_LEN];
+    size_t devlen;
+
+    for (;;) {
+	if (fread(hdr, 1, 4, cap->fp) != 4)
+	    return 0;
+	while (getleu32(hdr, 0) != CAPTURE_SYNC) {
+	    int c = getc(cap->fp);
+
+	    if (c == EOF)
+		return 0;
+	    memmove(hdr, hdr + 1, 3);
+	    hdr[3] = (unsigned char)c;
+	}
+	if (fread(hdr + 4, 1, sizeof(hdr) - 4, cap->fp) != sizeof(hdr) - 4)
+	    return 0;
+	rec->len = getleu32(hdr, 4);
+	devlen = getleu16(hdr, 26);
+	if (rec->len > CAPTURE_DATA_MAX || devlen >= CAPTURE_DEVICE_MAX) {
+	    /* not a real header; look for the next one */
+	    (void)fseeko(cap->fp, -(off_t)(sizeof(hdr) - 1), SEEK_CUR);
+	    continue;
+	}
+	rec->mono = getles64(hdr, 8);
+	rec->real = getles64(hdr, 16);
+	rec->type = getles16(hdr, 24);
+	if (fread(rec->device, 1, devlen, cap->fp) != devlen)
+	    return 0;
+	rec->device[devlen] = '\0';
+	if (rec->len + 1 > cap->bufsize) {
+	    unsigned char *nbuf = (unsigned char *)realloc(cap->buf, rec->len + 1);
+
+	    if (nbuf == NULL)
+		return 0;
+	    cap->buf = nbuf;
+	    cap->bufsize = rec->len + 1;
+	}
+	if (fread(cap->buf, 1, rec->len, cap->fp) != rec->len)
+	    return 0;
+	cap->buf[rec->len] = '\0';	/* handy for textual packets */
+	rec->data = cap->buf;
+	return 1;
+    }
+}
+
+bool capture_seek(struct capture_t *cap, int64_t when)
+/*
+ * Position the reader at the first record with realtime at or after
+ * when: a binary search of the index, if there is one, gets close and a
+ * short scan does the rest.  False if there is no such record.
+ */
+{
+    char name[GPS_PATH_MAX + 8];
+    off_t offset = CAPTURE_HEADER_LEN;
+    struct capture_record_t rec;
+    FILE *ifp;
+
+    (void)snprintf(name, sizeof(name), "%s.idx", cap->path);
+    if ((ifp = fopen(name, "rb")) != NULL) {
+	unsigned char entry[16];
+	off_t lo = 0, hi;
+
+	if (fread(entry, 1, 8, ifp) == 8
+	    && memcmp(entry, CAPTURE_INDEX_MAGIC, 8) == 0
+	    && fseeko(ifp, 0, SEEK_END) == 0) {
+	    /* last entry at or before when */
+	    hi = (ftello(ifp) - 8) / 16;
+	    while (lo < hi) {
+		off_t mid = (lo + hi) / 2;
+
+		if (fseeko(ifp, 8 + mid * 16, SEEK_SET) != 0
+		    || fread(entry, 1, sizeof(entry), ifp) != sizeof(entry))
+		    break;
+		if (getles64(entry, 0) <= when) {
+		    offset = (off_t)getleu64(entry, 8);
+		    lo = mid + 1;
+		} else
+		    hi = mid;
+	    }
+	}
+	(void)fclose(ifp);
+    }
+
+    if (fseeko(cap->fp, offset, SEEK_SET) != 0)
+	return false;
+    for (;;) {
+	off_t here = ftello(cap->fp);
+
+	if (capture_next(cap, &rec) != 1)
+	    return false;
+	if (rec.real >= when)
+	    return fseeko(cap->fp, here, SEEK_SET) == 0;
+    }
+}
+
+bool capture_parse_time(const char *arg, const struct capture_t *cap,
+			int64_t *when)
+/*
+ * A point in a capture: +seconds from its start, seconds since the
+ * epoch, or an ISO8601 UTC time.
+ */
+{
+    char *end;
+    double t;
+
+    if (arg[0] == '+') {
+	t = strtod(arg + 1, &end);
+	if (*end != '\0' || cap == NULL)
+	    return false;
+	*when = cap->start + (int64_t)(t * 1e9);
+	return true;
+    }
+    t = strtod(arg, &end);
+    if (*end == '\0' && end != arg) {
+	*when = (int64_t)(t * 1e9);
+	return true;
+    }
+    if (strlen(arg) < 10 || !isdigit((unsigned char)arg[0]) || arg[4] != '-')
+	return false;
+    else {
+	char iso[64];
+
+	/* iso8601_to_unix() wants the trailing Z */
+	(void)strlcpy(iso, arg, sizeof(iso) - 1);
+	if (iso[strlen(iso) - 1] != 'Z')
+	    (void)strlcat(iso, "Z", sizeof(iso));
+	*when = (int64_t)(iso8601_to_unix(iso) * 1e9);
+	return true;
+    }
+}
+
+long capture_replay(struct capture_t *cap, int fd, int64_t end, double speed)
+/*
+ * Write the data of each record from here until realtime end (0 for no
+ * limit) to fd, keeping the original spacing divided by speed; speed 0
+ * means as fast as fd takes it.  Returns the records written, or -1 on
+ * a write error.
+ */
+{
+    struct capture_record_t rec;
+    struct timespec base;
+    int64_t first = 0;
+    long count = 0;
+
+    (void)clock_gettime(CLOCK_MONOTONIC, &base);
+    while (capture_next(cap, &rec) == 1) {
+	unsigned char *cp;
+
+	if (end != 0 && rec.real > end)
+	    break;
+	if (count == 0)
+	    first = rec.mono;
+	else if (speed > 0) {
+	    int64_t due = (int64_t)base.tv_sec * 1000000000LL + base.tv_nsec
+		+ (int64_t)((rec.mono - first) / speed);
+	    struct timespec at;
+
+	    at.tv_sec = (time_t)(due / 1000000000LL);
+	    at.tv_nsec = (long)(due % 1000000000LL);
+	    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &at, NULL)
+		   == EINTR)
+		continue;
+	}
+	for (cp = rec.data; cp < rec.data + rec.len;) {
+	    ssize_t w = write(fd, cp, (size_t)(rec.data + rec.len - cp));
+
+	    if (w == -1) {
+		if (errno == EINTR)
+		    continue;
+		return -1;
+	    }
+	    cp += w;
+	}
+	count++;
+    }
+    return count;
+}
+
+/* capture.c ends here */
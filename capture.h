@@ -0,0 +1,91 @@
+/*
+ * capture.h - framed, indexed packet capture files
+ *
+ * A capture file is a fixed header followed by records, each holding one
+ * packet's bytes together with a monotonic and a realtime timestamp,
+ * the device it came from and its packet type (the *_PACKET codes from
+ * gpsd.h, or -1 when unknown).  All integers are little-endian.
+ *
+ *   file header (CAPTURE_HEADER_LEN bytes)
+ *	0  "GPSDCAP1"
+ *	8  uint32 version (CAPTURE_VERSION)
+ *	12 uint32 header length
+ *	16 int64  realtime the file was started, ns
+ *	24 8 bytes reserved
+ *   record header (CAPTURE_RECORD_LEN bytes), then device, then data
+ *	0  uint32 CAPTURE_SYNC, to resynchronize after damage
+ *	4  uint32 data length
+ *	8  int64  monotonic time, ns
+ *	16 int64  realtime, ns
+ *	24 int16  packet type
+ *	26 uint16 device length
+ *	28 4 bytes reserved
+ *
+ * Beside each capture file a sparse index, <file>.idx, holds one entry
+ * per CAPTURE_INDEX_STEP of realtime giving the offset of the first
+ * record at or after it, so a reader can start anywhere in a long
+ * recording without scanning up to it.  An index is a convenience: the
+ * capture alone is complete and a missing index only makes seeks slow.
+ *
+ *   index: "GPSDIDX1", then entries of int64 realtime ns, uint64 offset
+ *
+ * This file is Copyright (c) 2010 by the GPSD project
+ * BSD terms apply: see the file COPYING in the distribution root for details.
+ */
+#ifndef _GPSD_CAPTURE_H_
+#define _GPSD_CAPTURE_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+
+#define CAPTURE_MAGIC		"GPSDCAP1"
+#define CAPTURE_INDEX_MAGIC	"GPSDIDX1"
+#define CAPTURE_VERSION		1
+#define CAPTURE_HEADER_LEN	32
+#define CAPTURE_RECORD_LEN	32
+#define CAPTURE_SYNC		0x43455247	/* "GREC" */
+#define CAPTURE_INDEX_STEP	1000000000LL	/* ns between index entries */
+#define CAPTURE_DEVICE_MAX	256
+#define CAPTURE_DATA_MAX	(1024 * 1024)
+
+struct capture_record_t {
+    int64_t mono;		/* CLOCK_MONOTONIC, ns */
+    int64_t real;		/* CLOCK_REALTIME, ns */
+    int type;			/* *_PACKET, or -1 */
+    char device[CAPTURE_DEVICE_MAX];
+    size_t len;
+    unsigned char *data;	/* points into the reader's buffer */
+};
+
+/* writer side: the caller owns the data stream, this tracks the index */
+struct capture_index_t {
+    FILE *fp;
+    int64_t next;		/* realtime due for the next entry */
+};
+
+extern void capture_file_header(unsigned char *, int64_t);
+extern size_t capture_record_header(unsigned char *, int64_t, int64_t,
+				    int, const char *, size_t);
+extern bool capture_index_open(struct capture_index_t *, const char *);
+extern void capture_index_note(struct capture_index_t *, int64_t, uint64_t);
+extern void capture_index_close(struct capture_index_t *);
+
+/* reader side */
+struct capture_t {
+    FILE *fp;
+    char *path;
+    int64_t start;		/* realtime the file was started */
+    unsigned char *buf;		/* record data */
+    size_t bufsize;
+};
+
+extern bool capture_open(struct capture_t *, const char *);
+extern void capture_close(struct capture_t *);
+extern bool capture_seek(struct capture_t *, int64_t);
+extern int capture_next(struct capture_t *, struct capture_record_t *);
+extern bool capture_parse_time(const char *, const struct capture_t *,
+			       int64_t *);
+extern long capture_replay(struct capture_t *, int, int64_t, double);
+
+#endif /* _GPSD_CAPTURE_H_ */
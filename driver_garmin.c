@@ -736,7 +736,7 @@ static void Build_Send_USB_Packet(struct gps_device_t *session,
 				  uint32_t layer_id, uint32_t pkt_id,
 				  uint32_t length, uint32_t data)
 {
-    uint8_t *buffer = (uint8_t *) session->driver.garmin.Buffer;
+    uint8_t *buffer = (uint8_t *) session->driver->garmin.Buffer;
     Packet_t *thePacket = (Packet_t *) buffer;
     ssize_t theBytesReturned = 0;
     ssize_t theBytesToWrite = 12 + (ssize_t) length;
@@ -779,7 +779,7 @@ static void Build_Send_SER_Packet(struct gps_device_t *session,
 				  uint32_t layer_id UNUSED, uint32_t pkt_id,
 				  uint32_t length, uint32_t data)
 {
-    uint8_t *buffer = (uint8_t *) session->driver.garmin.Buffer;
+    uint8_t *buffer = (uint8_t *) session->driver->garmin.Buffer;
     uint8_t *buffer0 = buffer;
     Packet_t *thePacket = (Packet_t *) buffer;
     ssize_t theBytesReturned = 0;
@@ -946,7 +946,7 @@ static bool garmin_usb_detect(struct gps_device_t *session UNUSED)
 	    return false;
 	}
 
-	if (sizeof(session->driver.garmin.Buffer) < sizeof(Packet_t)) {
+	if (sizeof(session->driver->garmin.Buffer) < sizeof(Packet_t)) {
 	    /* dunno how this happens, but it does on some compilers */
 	    gpsd_log(&session->context->errout, LOG_ERROR,
 		     "Garmin: garmin_usb_detect: Compile error, garmin.Buffer too small.\n");
@@ -1038,10 +1038,11 @@ gps_mask_t garmin_ser_parse(struct gps_device_t *session)
 	return 0;
     }
     /* debug */
-    for (i = 0; i < (int)len; i++) {
-	gpsd_log(&session->context->errout, LOG_RAW + 1,
-		 "Garmin: Char: %#02x\n", buf[i]);
-    }
+    if (gpsd_log_enabled(&session->context->errout, LOG_RAW + 1))
+	for (i = 0; i < (int)len; i++) {
+	    gpsd_log(&session->context->errout, LOG_RAW + 1,
+		     "Garmin: Char: %#02x\n", buf[i]);
+	}
 
     if ('\x10' != buf[0]) {
 	Send_NAK();
@@ -1145,10 +1146,11 @@ gps_mask_t garmin_ser_parse(struct gps_device_t *session)
     }
 
     /* debug */
-    for (i = 0; i < data_index; i++) {
-	gpsd_log(&session->context->errout, LOG_RAW + 1,
-		 "Garmin: Char: %#02x\n", data_buf[i]);
-    }
+    if (gpsd_log_enabled(&session->context->errout, LOG_RAW + 1))
+	for (i = 0; i < data_index; i++) {
+	    gpsd_log(&session->context->errout, LOG_RAW + 1,
+		     "Garmin: Char: %#02x\n", data_buf[i]);
+	}
 
 
     gpsd_log(&session->context->errout, LOG_DATA,
@@ -1265,9 +1267,9 @@ static int GetPacket(struct gps_device_t *session)
     int cnt = 0;
     // int x = 0; // for debug dump
 
-    memset(session->driver.garmin.Buffer, 0, sizeof(Packet_t));
+    memset(session->driver->garmin.Buffer, 0, sizeof(Packet_t));
     memset(&delay, 0, sizeof(delay));
-    session->driver.garmin.BufferLen = 0;
+    session->driver->garmin.BufferLen = 0;
     session->lexer.outbuflen = 0;
 
     gpsd_log(&session->context->errout, LOG_DATA, "Garmin: GetPacket()\n");
@@ -1280,12 +1282,12 @@ static int GetPacket(struct gps_device_t *session)
 	// not optimal, but given the speed and packet nature of
 	// the USB not too bad for a start
 	ssize_t theBytesReturned = 0;
-	uint8_t *buf = (uint8_t *) session->driver.garmin.Buffer;
+	uint8_t *buf = (uint8_t *) session->driver->garmin.Buffer;
 	Packet_t *thePacket = (Packet_t *) buf;
 
 	theBytesReturned =
 	    read(session->gpsdata.gps_fd,
-		 buf + session->driver.garmin.BufferLen, ASYNC_DATA_SIZE);
+		 buf + session->driver->garmin.BufferLen, ASYNC_DATA_SIZE);
 	// zero byte returned is a legal value and denotes the end of a
 	// binary packet.
 	if (0 > theBytesReturned) {
@@ -1299,24 +1301,24 @@ static int GetPacket(struct gps_device_t *session)
 	gpsd_log(&session->context->errout, LOG_RAW,
 		 "Garmin: got %d bytes\n", theBytesReturned);
 
-	session->driver.garmin.BufferLen += theBytesReturned;
-	if (256 <= session->driver.garmin.BufferLen) {
+	session->driver->garmin.BufferLen += theBytesReturned;
+	if (256 <= session->driver->garmin.BufferLen) {
 	    // really bad read error...
 	    gpsd_log(&session->context->errout, LOG_ERROR,
 		     "Garmin: GetPacket() packet too long, %ld > 255 !\n",
-		     session->driver.garmin.BufferLen);
-	    session->driver.garmin.BufferLen = 0;
+		     session->driver->garmin.BufferLen);
+	    session->driver->garmin.BufferLen = 0;
 	    break;
 	}
 	pkt_size = 12 + get_int32((uint8_t *) & thePacket->mDataSize);
-	if (12 <= session->driver.garmin.BufferLen) {
+	if (12 <= session->driver->garmin.BufferLen) {
 	    // have enough data to check packet size
-	    if (session->driver.garmin.BufferLen > pkt_size) {
+	    if (session->driver->garmin.BufferLen > pkt_size) {
 		// wrong amount of data in buffer
 		gpsd_log(&session->context->errout, LOG_ERROR,
 			 "Garmin: GetPacket() packet size wrong! Packet: %ld, s/b %ld\n",
-			 session->driver.garmin.BufferLen, pkt_size);
-		session->driver.garmin.BufferLen = 0;
+			 session->driver->garmin.BufferLen, pkt_size);
+		session->driver->garmin.BufferLen = 0;
 		break;
 	    }
 	}
@@ -1332,8 +1334,8 @@ static int GetPacket(struct gps_device_t *session)
 	    continue;
     }
     // dump the individual bytes, debug only
-    // for ( x = 0; x < session->driver.garmin.BufferLen; x++ ) {
-    // gpsd_log(&session->context->errout, LOG_RAW+1, "Garmin: p[%d] = %x\n", x, session->driver.garmin.Buffer[x]);
+    // for ( x = 0; x < session->driver->garmin.BufferLen; x++ ) {
+    // gpsd_log(&session->context->errout, LOG_RAW+1, "Garmin: p[%d] = %x\n", x, session->driver->garmin.Buffer[x]);
     // }
     if (10 <= cnt) {
 	gpsd_log(&session->context->errout, LOG_ERROR,
@@ -1343,8 +1345,8 @@ static int GetPacket(struct gps_device_t *session)
 
     gpsd_log(&session->context->errout, LOG_RAW,
 	     "Garmin: GotPacket() sz=%d \n",
-	     session->driver.garmin.BufferLen);
-    session->lexer.outbuflen = session->driver.garmin.BufferLen;
+	     session->driver->garmin.BufferLen);
+    session->lexer.outbuflen = session->driver->garmin.BufferLen;
     return 0;
 }
 
@@ -1353,7 +1355,7 @@ static gps_mask_t garmin_usb_parse(struct gps_device_t *session)
     gpsd_log(&session->context->errout, LOG_PROG,
 	     "Garmin: garmin_usb_parse()\n");
     return PrintUSBPacket(session,
-			  (Packet_t *) session->driver.garmin.Buffer);
+			  (Packet_t *) session->driver->garmin.Buffer);
 }
 
 static ssize_t garmin_get_packet(struct gps_device_t *session)
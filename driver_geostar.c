@@ -374,12 +374,12 @@ static gps_mask_t geostar_analyze(struct gps_device_t *session)
 		 "Response to Query output data rate\n");
 	break;
     case 0x86:
-	session->driver.geostar.physical_port = (unsigned int)getleu32(buf, OFFSET(1));
+	session->driver->geostar.physical_port = (unsigned int)getleu32(buf, OFFSET(1));
 	gpsd_log(&session->context->errout, LOG_INF,
 		 "Response to Query data protocol assignment to communication port\n");
 	gpsd_log(&session->context->errout, LOG_INF,
 		 "Connected to physical port %d\n",
-		 session->driver.geostar.physical_port);
+		 session->driver->geostar.physical_port);
 	break;
     case 0x88:
 	gpsd_log(&session->context->errout, LOG_INF,
@@ -563,7 +563,7 @@ static bool geostar_speed_switch(struct gps_device_t *session,
 	break;
     }
 
-    putbe32(buf, 0, session->driver.geostar.physical_port);
+    putbe32(buf, 0, session->driver->geostar.physical_port);
     putbe32(buf, 4, speed);
     putbe32(buf, 8, stopbits);
     putbe32(buf, 12, parity);
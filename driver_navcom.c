@@ -316,7 +316,7 @@ static gps_mask_t handle_0x06(struct gps_device_t *session)
     unsigned char *buf = session->lexer.outbuffer + 3;
     uint8_t cmd_id = getub(buf, 3);
     uint8_t port = getub(buf, 4);
-    session->driver.navcom.physical_port = port;	/* This tells us which serial port was used last */
+    session->driver->navcom.physical_port = port;	/* This tells us which serial port was used last */
     gpsd_log(&session->context->errout, LOG_PROG,
 	     "Navcom: received packet type 0x06 (Acknowledgement (without error))\n");
     gpsd_log(&session->context->errout, LOG_DATA,
@@ -827,6 +827,9 @@ static gps_mask_t handle_0xb0(struct gps_device_t *session)
 	     tm_slew_acc, status,
 	     ((status & 0x80) ? "channel time set - " : ""),
 	     ((status & 0x40) ? "stable" : "not stable"), status & 0x0f);
+    /* the per-satellite decode below is only logged, never stored */
+    if (!gpsd_log_enabled(&session->context->errout, LOG_DATA + 1))
+	return 0;
     for (n = 11; n < msg_len - 1; n += 16) {
 	uint8_t sv_status = getub(buf, n);
 	uint8_t ch_status = getub(buf, n + 1);
@@ -912,11 +915,11 @@ static gps_mask_t handle_0xb5(struct gps_device_t *session)
 	return mask;
     } else {
 	/* Ignore this message block */
-	if (!session->driver.navcom.warned) {
+	if (!session->driver->navcom.warned) {
 	    gpsd_log(&session->context->errout, LOG_WARN,
 		     "Navcom: received packet type 0xb5 (Pseudorange Noise Statistics) ignored "
 		     " - sizeof(double) == 64 bits required\n");
-	    session->driver.navcom.warned = true;
+	    session->driver->navcom.warned = true;
 	}
 	return 0;		/* Block ignored - wrong sizeof(double) */
     }
@@ -1187,7 +1190,7 @@ static bool navcom_speed(struct gps_device_t *session,
     } else {
 	uint8_t port, port_selection;
 	uint8_t baud;
-	if (session->driver.navcom.physical_port == (uint8_t) 0xFF) {
+	if (session->driver->navcom.physical_port == (uint8_t) 0xFF) {
 	    /* We still don't know which port we're connected to */
 	    return false;
 	}
@@ -1226,7 +1229,7 @@ static bool navcom_speed(struct gps_device_t *session,
 	}
 
 	/* Proceed to construct our message */
-	port = session->driver.navcom.physical_port;
+	port = session->driver->navcom.physical_port;
 	port_selection = (port ? port : (uint8_t) 0xff) | baud;
 
 	/* Send it off */
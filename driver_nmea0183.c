@@ -1619,12 +1619,12 @@ void nmea_add_checksum(char *sentence)
 ssize_t nmea_write(struct gps_device_t *session, char *buf, size_t len UNUSED)
 /* ship a command to the GPS, adding * and correct checksum */
 {
-    (void)strlcpy(session->msgbuf, buf, sizeof(session->msgbuf));
+    (void)strlcpy(session->msgbuf, buf, GPS_MSGBUF_MAX);
     if (session->msgbuf[0] == '$') {
-	(void)strlcat(session->msgbuf, "*", sizeof(session->msgbuf));
+	(void)strlcat(session->msgbuf, "*", GPS_MSGBUF_MAX);
 	nmea_add_checksum(session->msgbuf);
     } else
-	(void)strlcat(session->msgbuf, "\r\n", sizeof(session->msgbuf));
+	(void)strlcat(session->msgbuf, "\r\n", GPS_MSGBUF_MAX);
     session->msgbuflen = strlen(session->msgbuf);
     return gpsd_write(session, session->msgbuf, session->msgbuflen);
 }
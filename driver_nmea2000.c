@@ -100,13 +100,13 @@ static void print_data(struct gps_context_t *context,
 
 static gps_mask_t get_mode(struct gps_device_t *session)
 {
-    if (session->driver.nmea2000.mode_valid & 1) {
-        session->newdata.mode = session->driver.nmea2000.mode;
+    if (session->driver->nmea2000.mode_valid & 1) {
+        session->newdata.mode = session->driver->nmea2000.mode;
     } else {
         session->newdata.mode = MODE_NOT_SEEN;
     }
 
-    if (session->driver.nmea2000.mode_valid & 2) {
+    if (session->driver->nmea2000.mode_valid & 2) {
         return MODE_SET | USED_IS;
     } else {
         return MODE_SET;
@@ -149,7 +149,7 @@ static void decode_ais_channel_info(unsigned char *bu,
     pos = offset / 8;
     bpos = offset % 8;
     if (pos >= (unsigned int)len) {
-        session->driver.aivdm.ais_channel = 'A';
+        session->driver->aivdm.ais_channel = 'A';
 	return;
     }
     x = getleu16(bu, pos);
@@ -157,10 +157,10 @@ static void decode_ais_channel_info(unsigned char *bu,
     switch (x) {
     case 1:
     case 3:
-        session->driver.aivdm.ais_channel = 'B';
+        session->driver->aivdm.ais_channel = 'B';
 	break;
     default:
-        session->driver.aivdm.ais_channel = 'A';
+        session->driver->aivdm.ais_channel = 'A';
 	break;
     }
     return;
@@ -192,7 +192,7 @@ static gps_mask_t hnd_059392(unsigned char *bu, int len, PGN *pgn, struct gps_de
 {
     print_data(session->context, bu, len, pgn);
     gpsd_log(&session->context->errout, LOG_DATA,
-	     "pgn %6d(%3d):\n", pgn->pgn, session->driver.nmea2000.unit);
+	     "pgn %6d(%3d):\n", pgn->pgn, session->driver->nmea2000.unit);
     return(0);
 }
 
@@ -204,7 +204,7 @@ static gps_mask_t hnd_060928(unsigned char *bu, int len, PGN *pgn, struct gps_de
 {
     print_data(session->context, bu, len, pgn);
     gpsd_log(&session->context->errout, LOG_DATA,
-	     "pgn %6d(%3d):\n", pgn->pgn, session->driver.nmea2000.unit);
+	     "pgn %6d(%3d):\n", pgn->pgn, session->driver->nmea2000.unit);
     return(0);
 }
 
@@ -216,7 +216,7 @@ static gps_mask_t hnd_126208(unsigned char *bu, int len, PGN *pgn, struct gps_de
 {
     print_data(session->context, bu, len, pgn);
     gpsd_log(&session->context->errout, LOG_DATA,
-	     "pgn %6d(%3d):\n", pgn->pgn, session->driver.nmea2000.unit);
+	     "pgn %6d(%3d):\n", pgn->pgn, session->driver->nmea2000.unit);
     return(0);
 }
 
@@ -228,7 +228,7 @@ static gps_mask_t hnd_126464(unsigned char *bu, int len, PGN *pgn, struct gps_de
 {
     print_data(session->context, bu, len, pgn);
     gpsd_log(&session->context->errout, LOG_DATA,
-	     "pgn %6d(%3d):\n", pgn->pgn, session->driver.nmea2000.unit);
+	     "pgn %6d(%3d):\n", pgn->pgn, session->driver->nmea2000.unit);
     return(0);
 }
 
@@ -240,7 +240,7 @@ static gps_mask_t hnd_126996(unsigned char *bu, int len, PGN *pgn, struct gps_de
 {
     print_data(session->context, bu, len, pgn);
     gpsd_log(&session->context->errout, LOG_DATA,
-	     "pgn %6d(%3d):\n", pgn->pgn, session->driver.nmea2000.unit);
+	     "pgn %6d(%3d):\n", pgn->pgn, session->driver->nmea2000.unit);
     return(0);
 }
 
@@ -252,7 +252,7 @@ static gps_mask_t hnd_127258(unsigned char *bu, int len, PGN *pgn, struct gps_de
 {
     print_data(session->context, bu, len, pgn);
     gpsd_log(&session->context->errout, LOG_DATA,
-	     "pgn %6d(%3d):\n", pgn->pgn, session->driver.nmea2000.unit);
+	     "pgn %6d(%3d):\n", pgn->pgn, session->driver->nmea2000.unit);
     return(0);
 }
 
@@ -264,7 +264,7 @@ static gps_mask_t hnd_129025(unsigned char *bu, int len, PGN *pgn, struct gps_de
 {
     print_data(session->context, bu, len, pgn);
     gpsd_log(&session->context->errout, LOG_DATA,
-	     "pgn %6d(%3d):\n", pgn->pgn, session->driver.nmea2000.unit);
+	     "pgn %6d(%3d):\n", pgn->pgn, session->driver->nmea2000.unit);
 
     session->newdata.latitude = getles32(bu, 0) * 1e-7;
     session->newdata.longitude = getles32(bu, 4) * 1e-7;
@@ -280,9 +280,9 @@ static gps_mask_t hnd_129026(unsigned char *bu, int len, PGN *pgn, struct gps_de
 {
     print_data(session->context, bu, len, pgn);
     gpsd_log(&session->context->errout, LOG_DATA,
-	     "pgn %6d(%3d):\n", pgn->pgn, session->driver.nmea2000.unit);
+	     "pgn %6d(%3d):\n", pgn->pgn, session->driver->nmea2000.unit);
 
-    session->driver.nmea2000.sid[0]  =  bu[0];
+    session->driver->nmea2000.sid[0]  =  bu[0];
 
     session->newdata.track           =  getleu16(bu, 2) * 1e-4 * RAD_2_DEG;
     session->newdata.speed           =  getleu16(bu, 4) * 1e-2;
@@ -301,7 +301,7 @@ static gps_mask_t hnd_126992(unsigned char *bu, int len, PGN *pgn, struct gps_de
 
     print_data(session->context, bu, len, pgn);
     gpsd_log(&session->context->errout, LOG_DATA,
-	     "pgn %6d(%3d):\n", pgn->pgn, session->driver.nmea2000.unit);
+	     "pgn %6d(%3d):\n", pgn->pgn, session->driver->nmea2000.unit);
 
     //sid        = bu[0];
     //source     = bu[1] & 0x0f;
@@ -326,12 +326,12 @@ static gps_mask_t hnd_129539(unsigned char *bu, int len, PGN *pgn, struct gps_de
 
     print_data(session->context, bu, len, pgn);
     gpsd_log(&session->context->errout, LOG_DATA,
-	     "pgn %6d(%3d):\n", pgn->pgn, session->driver.nmea2000.unit);
+	     "pgn %6d(%3d):\n", pgn->pgn, session->driver->nmea2000.unit);
 
     mask                             = 0;
-    session->driver.nmea2000.sid[1]  = bu[0];
+    session->driver->nmea2000.sid[1]  = bu[0];
 
-    session->driver.nmea2000.mode_valid |= 1;
+    session->driver->nmea2000.mode_valid |= 1;
 
     req_mode = (unsigned int)((bu[1] >> 0) & 0x07);
     act_mode = (unsigned int)((bu[1] >> 3) & 0x07);
@@ -341,7 +341,7 @@ static gps_mask_t hnd_129539(unsigned char *bu, int len, PGN *pgn, struct gps_de
         act_mode = req_mode;
     }
 
-    session->driver.nmea2000.mode    = mode_tab[act_mode];
+    session->driver->nmea2000.mode    = mode_tab[act_mode];
 
     session->gpsdata.dop.hdop        = getleu16(bu, 2) * 1e-2;
     session->gpsdata.dop.vdop        = getleu16(bu, 4) * 1e-2;
@@ -351,8 +351,8 @@ static gps_mask_t hnd_129539(unsigned char *bu, int len, PGN *pgn, struct gps_de
     gpsd_log(&session->context->errout, LOG_DATA,
 	     "pgn %6d(%3d): sid:%02x hdop:%5.2f vdop:%5.2f tdop:%5.2f\n",
 	     pgn->pgn,
-	     session->driver.nmea2000.unit,
-	     session->driver.nmea2000.sid[1],
+	     session->driver->nmea2000.unit,
+	     session->driver->nmea2000.sid[1],
 	     session->gpsdata.dop.hdop,
 	     session->gpsdata.dop.vdop,
 	     session->gpsdata.dop.tdop);
@@ -370,9 +370,9 @@ static gps_mask_t hnd_129540(unsigned char *bu, int len, PGN *pgn, struct gps_de
 
     print_data(session->context, bu, len, pgn);
     gpsd_log(&session->context->errout, LOG_DATA,
-	     "pgn %6d(%3d):\n", pgn->pgn, session->driver.nmea2000.unit);
+	     "pgn %6d(%3d):\n", pgn->pgn, session->driver->nmea2000.unit);
 
-    session->driver.nmea2000.sid[2]           = bu[0];
+    session->driver->nmea2000.sid[2]           = bu[0];
     session->gpsdata.satellites_visible       = (int)bu[2];
 
     memset(session->gpsdata.skyview, '\0', sizeof(session->gpsdata.skyview));
@@ -395,7 +395,7 @@ static gps_mask_t hnd_129540(unsigned char *bu, int len, PGN *pgn, struct gps_de
 	    session->gpsdata.skyview[l1].used = true;
 	}
     }
-    session->driver.nmea2000.mode_valid |= 2;
+    session->driver->nmea2000.mode_valid |= 2;
     return  SATELLITE_SET | USED_IS;
 }
 
@@ -409,10 +409,10 @@ static gps_mask_t hnd_129029(unsigned char *bu, int len, PGN *pgn, struct gps_de
 
     print_data(session->context, bu, len, pgn);
     gpsd_log(&session->context->errout, LOG_DATA,
-	     "pgn %6d(%3d):\n", pgn->pgn, session->driver.nmea2000.unit);
+	     "pgn %6d(%3d):\n", pgn->pgn, session->driver->nmea2000.unit);
 
     mask                             = 0;
-    session->driver.nmea2000.sid[3]  = bu[0];
+    session->driver->nmea2000.sid[3]  = bu[0];
 
     session->newdata.time            = getleu16(bu,1) * 24*60*60 + getleu32(bu, 3)/1e4;
     mask                            |= TIME_SET;
@@ -469,7 +469,7 @@ static gps_mask_t hnd_129038(unsigned char *bu, int len, PGN *pgn, struct gps_de
     ais =  &session->gpsdata.ais;
     print_data(session->context, bu, len, pgn);
     gpsd_log(&session->context->errout, LOG_DATA,
-	     "pgn %6d(%3d):\n", pgn->pgn, session->driver.nmea2000.unit);
+	     "pgn %6d(%3d):\n", pgn->pgn, session->driver->nmea2000.unit);
 
     if (decode_ais_header(session->context, bu, len, ais, 0xffffffffU) != 0) {
         ais->type1.lon       = (int)          scale_int(getles32(bu, 5), (int64_t)(SHIFT32 *.06L));
@@ -502,7 +502,7 @@ static gps_mask_t hnd_129039(unsigned char *bu, int len, PGN *pgn, struct gps_de
     ais =  &session->gpsdata.ais;
     print_data(session->context, bu, len, pgn);
     gpsd_log(&session->context->errout, LOG_DATA,
-	     "pgn %6d(%3d):\n", pgn->pgn, session->driver.nmea2000.unit);
+	     "pgn %6d(%3d):\n", pgn->pgn, session->driver->nmea2000.unit);
 
     if (decode_ais_header(session->context, bu, len, ais, 0xffffffffU) != 0) {
         ais->type18.lon      = (int)          scale_int(getles32(bu, 5), (int64_t)(SHIFT32 *.06L));
@@ -541,7 +541,7 @@ static gps_mask_t hnd_129040(unsigned char *bu, int len, PGN *pgn, struct gps_de
     ais =  &session->gpsdata.ais;
     print_data(session->context, bu, len, pgn);
     gpsd_log(&session->context->errout, LOG_DATA,
-	     "pgn %6d(%3d):\n", pgn->pgn, session->driver.nmea2000.unit);
+	     "pgn %6d(%3d):\n", pgn->pgn, session->driver->nmea2000.unit);
 
     if (decode_ais_header(session->context, bu, len, ais, 0xffffffffU) != 0) {
         uint16_t length, beam, to_bow, to_starboard;
@@ -599,7 +599,7 @@ static gps_mask_t hnd_129793(unsigned char *bu, int len, PGN *pgn, struct gps_de
     ais =  &session->gpsdata.ais;
     print_data(session->context, bu, len, pgn);
     gpsd_log(&session->context->errout, LOG_DATA,
-	     "pgn %6d(%3d):\n", pgn->pgn, session->driver.nmea2000.unit);
+	     "pgn %6d(%3d):\n", pgn->pgn, session->driver->nmea2000.unit);
 
     if (decode_ais_header(session->context, bu, len, ais, 0xffffffffU) != 0) {
         uint32_t  time;
@@ -659,7 +659,7 @@ static gps_mask_t hnd_129794(unsigned char *bu, int len, PGN *pgn, struct gps_de
     ais =  &session->gpsdata.ais;
     print_data(session->context, bu, len, pgn);
     gpsd_log(&session->context->errout, LOG_DATA,
-	     "pgn %6d(%3d):\n", pgn->pgn, session->driver.nmea2000.unit);
+	     "pgn %6d(%3d):\n", pgn->pgn, session->driver->nmea2000.unit);
 
     if (decode_ais_header(session->context, bu, len, ais, 0xffffffffU) != 0) {
         uint16_t  length, beam, to_bow, to_starboard, date;
@@ -787,7 +787,7 @@ static gps_mask_t hnd_129798(unsigned char *bu, int len, PGN *pgn, struct gps_de
     ais =  &session->gpsdata.ais;
     print_data(session->context, bu, len, pgn);
     gpsd_log(&session->context->errout, LOG_DATA,
-	     "pgn %6d(%3d):\n", pgn->pgn, session->driver.nmea2000.unit);
+	     "pgn %6d(%3d):\n", pgn->pgn, session->driver->nmea2000.unit);
 
     if (decode_ais_header(session->context, bu, len, ais, 0xffffffffU) != 0) {
         ais->type9.lon       = (int)          scale_int(getles32(bu, 5), (int64_t)(SHIFT32 *.06L));
@@ -822,7 +822,7 @@ static gps_mask_t hnd_129802(unsigned char *bu, int len, PGN *pgn, struct gps_de
     ais =  &session->gpsdata.ais;
     print_data(session->context, bu, len, pgn);
     gpsd_log(&session->context->errout, LOG_DATA,
-	     "pgn %6d(%3d):\n", pgn->pgn, session->driver.nmea2000.unit);
+	     "pgn %6d(%3d):\n", pgn->pgn, session->driver->nmea2000.unit);
 
     if (decode_ais_header(session->context, bu, len, ais, 0x3fffffff) != 0) {
         int                   l;
@@ -850,12 +850,12 @@ static gps_mask_t hnd_129809(unsigned char *bu, int len, PGN *pgn, struct gps_de
     ais =  &session->gpsdata.ais;
     print_data(session->context, bu, len, pgn);
     gpsd_log(&session->context->errout, LOG_DATA,
-	     "pgn %6d(%3d):\n", pgn->pgn, session->driver.nmea2000.unit);
+	     "pgn %6d(%3d):\n", pgn->pgn, session->driver->nmea2000.unit);
 
     if (decode_ais_header(session->context, bu, len, ais, 0xffffffffU) != 0) {
         int                   l;
-	int                   index   = session->driver.aivdm.context[0].type24_queue.index;
-	struct ais_type24a_t *saveptr = &session->driver.aivdm.context[0].type24_queue.ships[index];
+	int                   index   = session->driver->aivdm.context[0].type24_queue.index;
+	struct ais_type24a_t *saveptr = &session->driver->aivdm.context[0].type24_queue.ships[index];
 
 	gpsd_log(&session->context->errout, LOG_PROG,
 		 "NMEA2000: AIS message 24A from %09u stashed.\n",
@@ -872,7 +872,7 @@ static gps_mask_t hnd_129809(unsigned char *bu, int len, PGN *pgn, struct gps_de
 
 	index += 1;
 	index %= MAX_TYPE24_INTERLEAVE;
-	session->driver.aivdm.context[0].type24_queue.index = index;
+	session->driver->aivdm.context[0].type24_queue.index = index;
 
 	decode_ais_channel_info(bu, len, 200, session);
 
@@ -893,7 +893,7 @@ static gps_mask_t hnd_129810(unsigned char *bu, int len, PGN *pgn, struct gps_de
     ais =  &session->gpsdata.ais;
     print_data(session->context, bu, len, pgn);
     gpsd_log(&session->context->errout, LOG_DATA,
-	     "pgn %6d(%3d):\n", pgn->pgn, session->driver.nmea2000.unit);
+	     "pgn %6d(%3d):\n", pgn->pgn, session->driver->nmea2000.unit);
 
     if (decode_ais_header(session->context, bu, len, ais, 0xffffffffU) != 0) {
         int l, i;
@@ -937,9 +937,9 @@ static gps_mask_t hnd_129810(unsigned char *bu, int len, PGN *pgn, struct gps_de
 	}
 
 	for (i = 0; i < MAX_TYPE24_INTERLEAVE; i++) {
-	    if (session->driver.aivdm.context[0].type24_queue.ships[i].mmsi == ais->mmsi) {
+	    if (session->driver->aivdm.context[0].type24_queue.ships[i].mmsi == ais->mmsi) {
 	        for (l=0;l<AIS_SHIPNAME_MAXLEN;l++) {
-		    ais->type24.shipname[l] = (char)(session->driver.aivdm.context[0].type24_queue.ships[i].shipname[l]);
+		    ais->type24.shipname[l] = (char)(session->driver->aivdm.context[0].type24_queue.ships[i].shipname[l]);
 		}
 		ais->type24.shipname[AIS_SHIPNAME_MAXLEN] = (char) 0;
 
@@ -947,7 +947,7 @@ static gps_mask_t hnd_129810(unsigned char *bu, int len, PGN *pgn, struct gps_de
 			 "NMEA2000: AIS 24B from %09u matches a 24A.\n",
 			    ais->mmsi);
 		/* prevent false match if a 24B is repeated */
-		session->driver.aivdm.context[0].type24_queue.ships[i].mmsi = 0;
+		session->driver->aivdm.context[0].type24_queue.ships[i].mmsi = 0;
 #if NMEA2000_DEBUG_AIS
 		printf("AIS: MMSI:  %09u\n", ais->mmsi);
 		printf("AIS: name:  %-20.20s v:%-8.8s c:%-8.8s b:%6u s:%6u p:%6u s:%6u\n",
@@ -990,7 +990,7 @@ static gps_mask_t hnd_127506(unsigned char *bu, int len, PGN *pgn, struct gps_de
 {
     print_data(session->context, bu, len, pgn);
     gpsd_log(&session->context->errout, LOG_DATA,
-	     "pgn %6d(%3d):\n", pgn->pgn, session->driver.nmea2000.unit);
+	     "pgn %6d(%3d):\n", pgn->pgn, session->driver->nmea2000.unit);
     return(0);
 }
 
@@ -1002,7 +1002,7 @@ static gps_mask_t hnd_127508(unsigned char *bu, int len, PGN *pgn, struct gps_de
 {
     print_data(session->context, bu, len, pgn);
     gpsd_log(&session->context->errout, LOG_DATA,
-	     "pgn %6d(%3d):\n", pgn->pgn, session->driver.nmea2000.unit);
+	     "pgn %6d(%3d):\n", pgn->pgn, session->driver->nmea2000.unit);
     return(0);
 }
 
@@ -1014,7 +1014,7 @@ static gps_mask_t hnd_127513(unsigned char *bu, int len, PGN *pgn, struct gps_de
 {
     print_data(session->context, bu, len, pgn);
     gpsd_log(&session->context->errout, LOG_DATA,
-	     "pgn %6d(%3d):\n", pgn->pgn, session->driver.nmea2000.unit);
+	     "pgn %6d(%3d):\n", pgn->pgn, session->driver->nmea2000.unit);
     return(0);
 }
 
@@ -1026,7 +1026,7 @@ static gps_mask_t hnd_127245(unsigned char *bu, int len, PGN *pgn, struct gps_de
 {
     print_data(session->context, bu, len, pgn);
     gpsd_log(&session->context->errout, LOG_DATA,
-	     "pgn %6d(%3d):\n", pgn->pgn, session->driver.nmea2000.unit);
+	     "pgn %6d(%3d):\n", pgn->pgn, session->driver->nmea2000.unit);
     return(0);
 }
 
@@ -1074,7 +1074,7 @@ static gps_mask_t hnd_127250(unsigned char *bu, int len, PGN *pgn, struct gps_de
     session->gpsdata.attitude.depth = NAN;
 
     gpsd_log(&session->context->errout, LOG_DATA,
-	     "pgn %6d(%3d):\n", pgn->pgn, session->driver.nmea2000.unit);
+	     "pgn %6d(%3d):\n", pgn->pgn, session->driver->nmea2000.unit);
     return(ONLINE_SET | ATTITUDE_SET);
 }
 
@@ -1086,7 +1086,7 @@ static gps_mask_t hnd_128259(unsigned char *bu, int len, PGN *pgn, struct gps_de
 {
     print_data(session->context, bu, len, pgn);
     gpsd_log(&session->context->errout, LOG_DATA,
-	     "pgn %6d(%3d):\n", pgn->pgn, session->driver.nmea2000.unit);
+	     "pgn %6d(%3d):\n", pgn->pgn, session->driver->nmea2000.unit);
     return(0);
 }
 
@@ -1120,7 +1120,7 @@ static gps_mask_t hnd_128267(unsigned char *bu, int len, PGN *pgn, struct gps_de
     session->gpsdata.attitude.depth = getleu32(bu, 1) *.01;
 
     gpsd_log(&session->context->errout, LOG_DATA,
-	     "pgn %6d(%3d):\n", pgn->pgn, session->driver.nmea2000.unit);
+	     "pgn %6d(%3d):\n", pgn->pgn, session->driver->nmea2000.unit);
     return(ONLINE_SET | ATTITUDE_SET);
 }
 
@@ -1132,7 +1132,7 @@ static gps_mask_t hnd_128275(unsigned char *bu, int len, PGN *pgn, struct gps_de
 {
     print_data(session->context, bu, len, pgn);
     gpsd_log(&session->context->errout, LOG_DATA,
-	     "pgn %6d(%3d):\n", pgn->pgn, session->driver.nmea2000.unit);
+	     "pgn %6d(%3d):\n", pgn->pgn, session->driver->nmea2000.unit);
     return(0);
 }
 
@@ -1144,7 +1144,7 @@ static gps_mask_t hnd_129283(unsigned char *bu, int len, PGN *pgn, struct gps_de
 {
     print_data(session->context, bu, len, pgn);
     gpsd_log(&session->context->errout, LOG_DATA,
-	     "pgn %6d(%3d):\n", pgn->pgn, session->driver.nmea2000.unit);
+	     "pgn %6d(%3d):\n", pgn->pgn, session->driver->nmea2000.unit);
     return(0);
 }
 
@@ -1156,7 +1156,7 @@ static gps_mask_t hnd_129284(unsigned char *bu, int len, PGN *pgn, struct gps_de
 {
     print_data(session->context, bu, len, pgn);
     gpsd_log(&session->context->errout, LOG_DATA,
-	     "pgn %6d(%3d):\n", pgn->pgn, session->driver.nmea2000.unit);
+	     "pgn %6d(%3d):\n", pgn->pgn, session->driver->nmea2000.unit);
     return(0);
 }
 
@@ -1168,7 +1168,7 @@ static gps_mask_t hnd_129285(unsigned char *bu, int len, PGN *pgn, struct gps_de
 {
     print_data(session->context, bu, len, pgn);
     gpsd_log(&session->context->errout, LOG_DATA,
-	     "pgn %6d(%3d):\n", pgn->pgn, session->driver.nmea2000.unit);
+	     "pgn %6d(%3d):\n", pgn->pgn, session->driver->nmea2000.unit);
     return(0);
 }
 
@@ -1180,7 +1180,7 @@ static gps_mask_t hnd_130306(unsigned char *bu, int len, PGN *pgn, struct gps_de
 {
     print_data(session->context, bu, len, pgn);
     gpsd_log(&session->context->errout, LOG_DATA,
-	     "pgn %6d(%3d):\n", pgn->pgn, session->driver.nmea2000.unit);
+	     "pgn %6d(%3d):\n", pgn->pgn, session->driver->nmea2000.unit);
     return(0);
 }
 
@@ -1192,7 +1192,7 @@ static gps_mask_t hnd_130310(unsigned char *bu, int len, PGN *pgn, struct gps_de
 {
     print_data(session->context, bu, len, pgn);
     gpsd_log(&session->context->errout, LOG_DATA,
-	     "pgn %6d(%3d):\n", pgn->pgn, session->driver.nmea2000.unit);
+	     "pgn %6d(%3d):\n", pgn->pgn, session->driver->nmea2000.unit);
     return(0);
 }
 
@@ -1204,7 +1204,7 @@ static gps_mask_t hnd_130311(unsigned char *bu, int len, PGN *pgn, struct gps_de
 {
     print_data(session->context, bu, len, pgn);
     gpsd_log(&session->context->errout, LOG_DATA,
-	     "pgn %6d(%3d):\n", pgn->pgn, session->driver.nmea2000.unit);
+	     "pgn %6d(%3d):\n", pgn->pgn, session->driver->nmea2000.unit);
     return(0);
 }
 
@@ -1342,8 +1342,8 @@ static void find_pgn(struct can_frame *frame, struct gps_device_t *session)
 {
     unsigned int can_net;
 
-    session->driver.nmea2000.workpgn = NULL;
-    can_net = session->driver.nmea2000.can_net;
+    session->driver->nmea2000.workpgn = NULL;
+    can_net = session->driver->nmea2000.can_net;
     if (can_net > (NMEA2000_NETS-1)) {
         gpsd_log(&session->context->errout, LOG_ERROR,
 		 "NMEA2000 find_pgn: Invalid can network %d.\n", can_net);
@@ -1379,7 +1379,7 @@ static void find_pgn(struct can_frame *frame, struct gps_device_t *session)
 	    fprintf(logFile, "\n");
 	}
 #endif /* of if LOG_FILE */
-	session->driver.nmea2000.can_msgcnt += 1;
+	session->driver->nmea2000.can_msgcnt += 1;
 	source_pgn = (frame->can_id >> 8) & 0x1ffff;
 #ifdef __UNUSED__
 	source_prio = (frame->can_id >> 26) & 0x7;
@@ -1397,31 +1397,31 @@ static void find_pgn(struct can_frame *frame, struct gps_device_t *session)
 #endif
 	}
 
-	if (!session->driver.nmea2000.unit_valid) {
+	if (!session->driver->nmea2000.unit_valid) {
 	    unsigned int l1, l2;
 
 	    for (l1=0;l1<NMEA2000_NETS;l1++) {
 	        for (l2=0;l2<NMEA2000_UNITS;l2++) {
 		    if (session == nmea2000_units[l1][l2]) {
-		        session->driver.nmea2000.unit = l2;
-		        session->driver.nmea2000.unit_valid = true;
-			session->driver.nmea2000.can_net = l1;
+		        session->driver->nmea2000.unit = l2;
+		        session->driver->nmea2000.unit_valid = true;
+			session->driver->nmea2000.can_net = l1;
 			can_net = l1;
 		    }
 		}
 	    }
 	}
 
-	if (!session->driver.nmea2000.unit_valid) {
-	    session->driver.nmea2000.unit = source_unit;
-	    session->driver.nmea2000.unit_valid = true;
+	if (!session->driver->nmea2000.unit_valid) {
+	    session->driver->nmea2000.unit = source_unit;
+	    session->driver->nmea2000.unit_valid = true;
 	    nmea2000_units[can_net][source_unit] = session;
 	}
 
-	if (source_unit == session->driver.nmea2000.unit) {
+	if (source_unit == session->driver->nmea2000.unit) {
 	    PGN *work;
-	    if (session->driver.nmea2000.pgnlist != NULL) {
-	        work = search_pgnlist(source_pgn, session->driver.nmea2000.pgnlist);
+	    if (session->driver->nmea2000.pgnlist != NULL) {
+	        work = search_pgnlist(source_pgn, session->driver->nmea2000.pgnlist);
 	    } else {
 	        PGN *pgnlist;
 
@@ -1440,7 +1440,7 @@ static void find_pgn(struct can_frame *frame, struct gps_device_t *session)
 		    work = search_pgnlist(source_pgn, pgnlist);
 		}
 		if ((work != NULL) && (work->type > 0)) {
-		    session->driver.nmea2000.pgnlist = pgnlist;
+		    session->driver->nmea2000.pgnlist = pgnlist;
 		}
 	    }
 	    if (work != NULL) {
@@ -1449,7 +1449,7 @@ static void find_pgn(struct can_frame *frame, struct gps_device_t *session)
 
 		    gpsd_log(&session->context->errout, LOG_DATA,
 			     "pgn %6d:%s \n", work->pgn, work->name);
-		    session->driver.nmea2000.workpgn = (void *) work;
+		    session->driver->nmea2000.workpgn = (void *) work;
 		    session->lexer.outbuflen =  frame->can_dlc & 0x0f;
 		    for (l2=0;l2<session->lexer.outbuflen;l2++) {
 		        session->lexer.outbuffer[l2]= frame->data[l2];
@@ -1457,57 +1457,57 @@ static void find_pgn(struct can_frame *frame, struct gps_device_t *session)
 		} else if ((frame->data[0] & 0x1f) == 0) {
 		    unsigned int l2;
 
-		    session->driver.nmea2000.fast_packet_len = frame->data[1];
-		    session->driver.nmea2000.idx = frame->data[0];
+		    session->driver->nmea2000.fast_packet_len = frame->data[1];
+		    session->driver->nmea2000.idx = frame->data[0];
 #if NMEA2000_FAST_DEBUG
 		    gpsd_log(&session->context->errout, LOG_ERROR,
 			     "Set idx    %2x    %2x %2x %6d\n",
 			     frame->data[0],
-			     session->driver.nmea2000.unit,
+			     session->driver->nmea2000.unit,
 			     frame->data[1],
 			     source_pgn);
 #endif /* of #if NMEA2000_FAST_DEBUG */
 		    session->lexer.inbuflen = 0;
-		    session->driver.nmea2000.idx += 1;
+		    session->driver->nmea2000.idx += 1;
 		    for (l2=2;l2<8;l2++) {
 		        session->lexer.inbuffer[session->lexer.inbuflen++] = frame->data[l2];
 		    }
 		    gpsd_log(&session->context->errout, LOG_DATA,
 			     "pgn %6d:%s \n", work->pgn, work->name);
-		} else if (frame->data[0] == session->driver.nmea2000.idx) {
+		} else if (frame->data[0] == session->driver->nmea2000.idx) {
 		    unsigned int l2;
 
 		    for (l2=1;l2<8;l2++) {
-		        if (session->driver.nmea2000.fast_packet_len > session->lexer.inbuflen) {
+		        if (session->driver->nmea2000.fast_packet_len > session->lexer.inbuflen) {
 			    session->lexer.inbuffer[session->lexer.inbuflen++] = frame->data[l2];
 			}
 		    }
-		    if (session->lexer.inbuflen == session->driver.nmea2000.fast_packet_len) {
+		    if (session->lexer.inbuflen == session->driver->nmea2000.fast_packet_len) {
 #if NMEA2000_FAST_DEBUG
 		        gpsd_log(&session->context->errout, LOG_ERROR,
 				 "Fast done  %2x %2x %2x %2x %6d\n",
-				 session->driver.nmea2000.idx,
+				 session->driver->nmea2000.idx,
 				                                                   frame->data[0],
-				                                                   session->driver.nmea2000.unit,
-				                                                   (unsigned int) session->driver.nmea2000.fast_packet_len,
+				                                                   session->driver->nmea2000.unit,
+				                                                   (unsigned int) session->driver->nmea2000.fast_packet_len,
 				                                                   source_pgn);
 #endif /* of #if  NMEA2000_FAST_DEBUG */
-			session->driver.nmea2000.workpgn = (void *) work;
-		        session->lexer.outbuflen = session->driver.nmea2000.fast_packet_len;
+			session->driver->nmea2000.workpgn = (void *) work;
+		        session->lexer.outbuflen = session->driver->nmea2000.fast_packet_len;
 			for(l2=0;l2 < (unsigned int)session->lexer.outbuflen; l2++) {
 			    session->lexer.outbuffer[l2] = session->lexer.inbuffer[l2];
 			}
-			session->driver.nmea2000.fast_packet_len = 0;
+			session->driver->nmea2000.fast_packet_len = 0;
 		    } else {
-		        session->driver.nmea2000.idx += 1;
+		        session->driver->nmea2000.idx += 1;
 		    }
 		} else {
 		    gpsd_log(&session->context->errout, LOG_ERROR,
 			     "Fast error %2x %2x %2x %2x %6d\n",
-			     session->driver.nmea2000.idx,
+			     session->driver->nmea2000.idx,
 			     frame->data[0],
-			     session->driver.nmea2000.unit,
-			     (unsigned int) session->driver.nmea2000.fast_packet_len,
+			     session->driver->nmea2000.unit,
+			     (unsigned int) session->driver->nmea2000.fast_packet_len,
 				                                               source_pgn);
 		}
 	    } else {
@@ -1559,11 +1559,11 @@ static gps_mask_t nmea2000_parse_input(struct gps_device_t *session)
 
 //  printf("NMEA2000 parse_input called\n");
     mask = 0;
-    work = (PGN *) session->driver.nmea2000.workpgn;
+    work = (PGN *) session->driver->nmea2000.workpgn;
 
     if (work != NULL) {
         mask = (work->func)(&session->lexer.outbuffer[0], (int)session->lexer.outbuflen, work, session);
-        session->driver.nmea2000.workpgn = NULL;
+        session->driver->nmea2000.workpgn = NULL;
     }
     session->lexer.outbuflen = 0;
 
@@ -1585,7 +1585,7 @@ int nmea2000_open(struct gps_device_t *session)
 
     INVALIDATE_SOCKET(session->gpsdata.gps_fd);
 
-    session->driver.nmea2000.can_net = 0;
+    session->driver->nmea2000.can_net = 0;
     can_net = -1;
 
     unit_number = -1;
@@ -1693,17 +1693,17 @@ int nmea2000_open(struct gps_device_t *session)
     session->gpsdata.gps_fd = sock;
     session->sourcetype = source_can;
     session->servicetype = service_sensor;
-    session->driver.nmea2000.can_net = can_net;
+    session->driver->nmea2000.can_net = can_net;
 
     if (unit_ptr != NULL) {
         nmea2000_units[can_net][unit_number] = session;
-	session->driver.nmea2000.unit = unit_number;
-	session->driver.nmea2000.unit_valid = true;
+	session->driver->nmea2000.unit = unit_number;
+	session->driver->nmea2000.unit_valid = true;
     } else {
         strncpy(can_interface_name[can_net],
 		interface_name,
 		MIN(sizeof(can_interface_name[0]), sizeof(interface_name)));
-	session->driver.nmea2000.unit_valid = false;
+	session->driver->nmea2000.unit_valid = false;
 	for (l=0;l<NMEA2000_UNITS;l++) {
 	    nmea2000_units[can_net][l] = NULL;
 	}
@@ -1724,15 +1724,15 @@ void nmea2000_close(struct gps_device_t *session)
 	(void)close(session->gpsdata.gps_fd);
 	INVALIDATE_SOCKET(session->gpsdata.gps_fd);
 
-	if (session->driver.nmea2000.unit_valid) {
+	if (session->driver->nmea2000.unit_valid) {
 	    unsigned int l1, l2;
 
 	    for (l1=0;l1<NMEA2000_NETS;l1++) {
 	        for (l2=0;l2<NMEA2000_UNITS;l2++) {
 		    if (session == nmea2000_units[l1][l2]) {
-		        session->driver.nmea2000.unit_valid = false;
-		        session->driver.nmea2000.unit = 0;
-			session->driver.nmea2000.can_net = 0;
+		        session->driver->nmea2000.unit_valid = false;
+		        session->driver->nmea2000.unit = 0;
+			session->driver->nmea2000.can_net = 0;
 			nmea2000_units[l1][l2] = NULL;
 		    }
 		}
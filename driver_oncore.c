@@ -159,12 +159,12 @@ oncore_msg_navsol(struct gps_device_t *session, unsigned char *buf,
 	if (sn) {
 	    session->gpsdata.skyview[st].PRN = (short)sv;
 	    session->gpsdata.skyview[st].ss = (double)sn;
-	    for (j = 0; (int)j < session->driver.oncore.visible; j++)
-		if (session->driver.oncore.PRN[j] == sv) {
+	    for (j = 0; (int)j < session->driver->oncore.visible; j++)
+		if (session->driver->oncore.PRN[j] == sv) {
 		    session->gpsdata.skyview[st].elevation =
-			(short)session->driver.oncore.elevation[j];
+			(short)session->driver->oncore.elevation[j];
 		    session->gpsdata.skyview[st].azimuth =
-			(short)session->driver.oncore.azimuth[j];
+			(short)session->driver->oncore.azimuth[j];
 		    Bbused |= 1 << j;
 		    break;
 		}
@@ -186,13 +186,13 @@ oncore_msg_navsol(struct gps_device_t *session, unsigned char *buf,
 	    st++;
 	}
     }
-    for (j = 0; (int)j < session->driver.oncore.visible; j++)
+    for (j = 0; (int)j < session->driver->oncore.visible; j++)
 	if (!(Bbused & (1 << j))) {
-	    session->gpsdata.skyview[st].PRN = (short)session->driver.oncore.PRN[j];
+	    session->gpsdata.skyview[st].PRN = (short)session->driver->oncore.PRN[j];
 	    session->gpsdata.skyview[st].elevation =
-		(short)session->driver.oncore.elevation[j];
+		(short)session->driver->oncore.elevation[j];
 	    session->gpsdata.skyview[st].azimuth =
-		(short)session->driver.oncore.azimuth[j];
+		(short)session->driver->oncore.azimuth[j];
 	    st++;
 	}
     session->gpsdata.skyview_time = session->newdata.time;
@@ -259,7 +259,7 @@ oncore_msg_pps_offset(struct gps_device_t *session, unsigned char *buf,
     gpsd_log(&session->context->errout, LOG_DATA, "oncore PPS offset\n");
     pps_offset_ns = (int)getbes32(buf, 4);
 
-    session->driver.oncore.pps_offset_ns = pps_offset_ns;
+    session->driver->oncore.pps_offset_ns = pps_offset_ns;
     return 0;
 }
 
@@ -284,7 +284,7 @@ oncore_msg_svinfo(struct gps_device_t *session, unsigned char *buf,
     /* Then we clamp the value to not read outside the table. */
     if (nchan > 12)
 	nchan = 12;
-    session->driver.oncore.visible = (int)nchan;
+    session->driver->oncore.visible = (int)nchan;
     for (i = 0; i < nchan; i++) {
 	/* get info for one channel/satellite */
 	unsigned int off = 5 + 7 * i;
@@ -297,9 +297,9 @@ oncore_msg_svinfo(struct gps_device_t *session, unsigned char *buf,
 		 "%2d %2d %2d %3d\n", i, sv, el, az);
 
 	/* Store for use when Ea messages come. */
-	session->driver.oncore.PRN[i] = sv;
-	session->driver.oncore.elevation[i] = el;
-	session->driver.oncore.azimuth[i] = az;
+	session->driver->oncore.PRN[i] = sv;
+	session->driver->oncore.elevation[i] = el;
+	session->driver->oncore.azimuth[i] = az;
 	/* If it has an entry in the satellite list, update it! */
 	for (j = 0; j < session->gpsdata.satellites_visible; j++)
 	    if (session->gpsdata.skyview[j].PRN == (short)sv) {
@@ -329,7 +329,7 @@ oncore_msg_time_raim(struct gps_device_t *session UNUSED,
     gpsd_log(&session->context->errout, LOG_DATA,
 	     "oncore PPS sawtooth: %d\n",sawtooth_ns);
 
-    /* session->driver.oncore.traim_sawtooth_ns = sawtooth_ns; */
+    /* session->driver->oncore.traim_sawtooth_ns = sawtooth_ns; */
 
     return 0;
 }
@@ -251,10 +251,10 @@ static bool sirf_write(struct gps_device_t *session, unsigned char *msg)
      * Add instrumentation to reveal when this may happen.
      */
     /* can also be false because ACK was received after last send */
-    if (session->driver.sirf.need_ack > 0) {
+    if (session->driver->sirf.need_ack > 0) {
 	gpsd_log(&session->context->errout, LOG_WARN,
 		 "SiRF: warning, write of control type %02x while awaiting ACK for %02x.\n",
-		 type, session->driver.sirf.need_ack);
+		 type, session->driver->sirf.need_ack);
     }
 
     len = (size_t) ((msg[2] << 8) | msg[3]);
@@ -273,7 +273,7 @@ static bool sirf_write(struct gps_device_t *session, unsigned char *msg)
 	     "SiRF: Writing control type %02x:\n", type);
     ok = (gpsd_write(session, (const char *)msg, len+8) == (ssize_t) (len+8));
 
-    session->driver.sirf.need_ack = type;
+    session->driver->sirf.need_ack = type;
     return (ok);
 }
 
@@ -414,6 +414,10 @@ static gps_mask_t sirf_msg_debug(struct gps_device_t *device,
     char msgbuf[MAX_PACKET_LENGTH * 3 + 2];
     int i;
 
+    /* everything below only feeds the log */
+    if (!gpsd_log_enabled(&device->context->errout, LOG_PROG))
+	return 0;
+
     bzero(msgbuf, (int)sizeof(msgbuf));
 
     if (0xe1 == buf[0]) {	/* Development statistics messages */
@@ -495,24 +499,24 @@ static gps_mask_t sirf_msg_swversion(struct gps_device_t *session,
 	continue;
     fv = safe_atof((const char *)cp);
     if (fv < 231) {
-	session->driver.sirf.driverstate |= SIRF_LT_231;
+	session->driver->sirf.driverstate |= SIRF_LT_231;
 #ifdef RECONFIGURE_ENABLE
 	if (fv > 200)
 	    sirfbin_mode(session, 0);
 #endif /* RECONFIGURE_ENABLE */
     } else if (fv < 232) {
-	session->driver.sirf.driverstate |= SIRF_EQ_231;
+	session->driver->sirf.driverstate |= SIRF_EQ_231;
     } else {
-	session->driver.sirf.driverstate |= SIRF_GE_232;
+	session->driver->sirf.driverstate |= SIRF_GE_232;
     }
     if (strstr((char *)(buf + 1), "ES"))
 	gpsd_log(&session->context->errout, LOG_INF,
 		 "SiRF: Firmware has XTrac capability\n");
     gpsd_log(&session->context->errout, LOG_PROG,
 	     "SiRF: fv: %0.2f, Driver state flags are: %0x\n",
-	     fv, session->driver.sirf.driverstate);
+	     fv, session->driver->sirf.driverstate);
 #ifdef TIMEHINT_ENABLE
-    session->driver.sirf.time_seen = 0;
+    session->driver->sirf.time_seen = 0;
 #endif /* TIMEHINT_ENABLE */
     gpsd_log(&session->context->errout, LOG_DATA,
 	     "SiRF: FV MID 0x06: subtype='%s' mask={DEVICEID}\n",
@@ -557,7 +561,7 @@ static gps_mask_t sirf_msg_navdata(struct gps_device_t *session,
 static gps_mask_t sirf_msg_svinfo(struct gps_device_t *session,
 				  unsigned char *buf, size_t len)
 {
-    int st, i, j, nsv;
+    int i, j, nsv, changed;
 
     if (len != 188)
 	return 0;
@@ -566,26 +570,21 @@ static gps_mask_t sirf_msg_svinfo(struct gps_device_t *session,
 	(unsigned short)getbes16(buf, 1),
 	(unsigned int)getbeu32(buf, 3) * 1e-2);
 
-    gpsd_zero_satellites(&session->gpsdata);
-    for (i = st = nsv = 0; i < SIRF_CHANNELS; i++) {
+    gpsd_skyview_begin(session);
+    for (i = nsv = 0; i < SIRF_CHANNELS; i++) {
 	int cn;
 	int off = 8 + 15 * i;
-	bool good;
+	struct satellite_t sat;
 	unsigned short stat = (unsigned short)getbeu16(buf, off + 3);
-	session->gpsdata.skyview[st].PRN = (short)getub(buf, off);
-	session->gpsdata.skyview[st].azimuth =
-	    (short)(((unsigned)getub(buf, off + 1) * 3) / 2.0);
-	session->gpsdata.skyview[st].elevation =
-	    (short)((unsigned)getub(buf, off + 2) / 2.0);
+	sat.PRN = (short)getub(buf, off);
+	sat.azimuth = (short)(((unsigned)getub(buf, off + 1) * 3) / 2.0);
+	sat.elevation = (short)((unsigned)getub(buf, off + 2) / 2.0);
 	cn = 0;
 	for (j = 0; j < 10; j++)
 	    cn += (int)getub(buf, off + 5 + j);
 
-	session->gpsdata.skyview[st].ss = (float)(cn / 10.0);
-	session->gpsdata.skyview[st].used = (bool)(stat & 0x01);
-	good = session->gpsdata.skyview[st].PRN != 0 &&
-	    session->gpsdata.skyview[st].azimuth != 0 &&
-	    session->gpsdata.skyview[st].elevation != 0;
+	sat.ss = (float)(cn / 10.0);
+	sat.used = (bool)(stat & 0x01);
 #ifdef __UNUSED__
 	gpsd_log(&session->context->errout, LOG_PROG,
 		 "SiRF: PRN=%2d El=%3.2f Az=%3.2f ss=%3d stat=%04x %c\n",
@@ -594,38 +593,36 @@ static gps_mask_t sirf_msg_svinfo(struct gps_device_t *session,
 		 (getub(buf, off + 1) * 3) / 2.0,
 		 cn / 10, stat, good ? '*' : ' ');
 #endif /* UNUSED */
-	if (good != 0) {
-	    st += 1;
-	    if (stat & 0x01)
-		nsv++;
-	}
-    }
-    session->gpsdata.satellites_visible = st;
-    session->gpsdata.satellites_used = nsv;
-    /* mark SBAS sats in use if SBAS was in use as of the last MID 27 */
-    for (i = 0; i < st; i++) {
-	int prn = session->gpsdata.skyview[i].PRN;
-	if (SBAS_PRN(prn) \
+	if (sat.PRN == 0 || sat.azimuth == 0 || sat.elevation == 0)
+	    continue;
+	if (sat.used)
+	    nsv++;
+	/* mark SBAS sats in use if SBAS was in use as of the last MID 27 */
+	if (SBAS_PRN(sat.PRN) \
 		&& session->gpsdata.status == STATUS_DGPS_FIX \
-		&& session->driver.sirf.dgps_source == SIRF_DGPS_SOURCE_SBAS)
-	    session->gpsdata.skyview[i].used = true;
+		&& session->driver->sirf.dgps_source == SIRF_DGPS_SOURCE_SBAS)
+	    sat.used = true;
+	(void)gpsd_skyview_merge(session, &sat);
     }
+    changed = gpsd_skyview_end(session);
+    session->gpsdata.satellites_used = nsv;
 #ifdef TIMEHINT_ENABLE
-    if (st < 3) {
+    if (session->gpsdata.satellites_visible < 3) {
 	gpsd_log(&session->context->errout, LOG_PROG,
-		 "SiRF: NTPD not enough satellites seen: %d\n", st);
+		 "SiRF: NTPD not enough satellites seen: %d\n",
+		 session->gpsdata.satellites_visible);
     } else {
 	/* SiRF says if 3 sats in view the time is good */
 	gpsd_log(&session->context->errout, LOG_PROG,
 		 "SiRF: NTPD valid time MID 0x04, seen=0x%02x, time:%.2lf, leap:%d\n",
-		 session->driver.sirf.time_seen,
+		 session->driver->sirf.time_seen,
 		 session->gpsdata.skyview_time,
 		 session->context->leap_seconds);
     }
 #endif /* TIMEHINT_ENABLE */
     gpsd_log(&session->context->errout, LOG_DATA,
-	     "SiRF: MTD 0x04: visible=%d mask={SATELLITE}\n",
-	     session->gpsdata.satellites_visible);
+	     "SiRF: MTD 0x04: visible=%d changed=%d mask={SATELLITE}\n",
+	     session->gpsdata.satellites_visible, changed);
     return SATELLITE_SET;
 }
 
@@ -636,28 +633,28 @@ static double sirf_time_offset(struct gps_device_t *session)
     double retval = NAN;
 
     /* we need to have seen UTC time with a valid leap-year offset */
-    if ((session->driver.sirf.time_seen & TIME_SEEN_UTC_2) != 0) {
+    if ((session->driver->sirf.time_seen & TIME_SEEN_UTC_2) != 0) {
 	retval = NAN;
     }
 
     /* the PPS time message */
-    else if (session->driver.sirf.lastid == (unsigned char)52) {
+    else if (session->driver->sirf.lastid == (unsigned char)52) {
 	retval = 0.3;
     }
 
     /* u-blox EMND message */
-    else if (session->driver.sirf.lastid == (unsigned char)98) {
+    else if (session->driver->sirf.lastid == (unsigned char)98) {
 	retval = 0.570;
     }
 #ifdef __UNUSED__
     /* geodetic-data message */
-    else if (session->driver.sirf.lastid == (unsigned char)41) {
+    else if (session->driver->sirf.lastid == (unsigned char)41) {
 	retval = 0.570;
     }
 #endif /* __UNUSED__ */
 
     /* the Navigation Solution message */
-    else if (session->driver.sirf.lastid == (unsigned char)2) {
+    else if (session->driver->sirf.lastid == (unsigned char)2) {
 	if (session->sourcetype == source_usb) {
 	    retval = 0.640;	/* USB, expect +/- 50mS jitter */
 	} else {
@@ -738,7 +735,7 @@ static gps_mask_t sirf_msg_navsol(struct gps_device_t *session,
     } else {
 	gpsd_log(&session->context->errout, LOG_PROG,
 		 "SiRF: NTPD valid time MID 0x02, seen=0x%02x, time;%.2lf, leap:%d\n",
-		 session->driver.sirf.time_seen,
+		 session->driver->sirf.time_seen,
 		 session->newdata.time, session->context->leap_seconds);
     }
 #endif /* TIMEHINT_ENABLE */
@@ -832,7 +829,7 @@ static gps_mask_t sirf_msg_geodetic(struct gps_device_t *session,
     //session->gpsdata.dop.hdop = (unsigned int)getub(buf, 89) * 0.2;
 
     if ((session->newdata.mode > MODE_NO_FIX)
-	&& (session->driver.sirf.driverstate & SIRF_GE_232)) {
+	&& (session->driver->sirf.driverstate & SIRF_GE_232)) {
 	struct tm unpacked_date;
 	double subseconds;
 	/*
@@ -892,7 +889,7 @@ static gps_mask_t sirf_msg_geodetic(struct gps_device_t *session,
 	} else {
 	    gpsd_log(&session->context->errout, LOG_PROG,
 		     "SiRF: NTPD valid time MID 0x29, seen=0x%02x\n",
-		     session->driver.sirf.time_seen);
+		     session->driver->sirf.time_seen);
 	}
 	if ( 3 <= session->gpsdata.satellites_visible ) {
 	    mask |= PPSTIME_IS;
@@ -932,14 +929,14 @@ static gps_mask_t sirf_msg_sysparam(struct gps_device_t *session,
 	return 0;
 
     /* save these to restore them in the revert method */
-    session->driver.sirf.nav_parameters_seen = true;
-    session->driver.sirf.altitude_hold_mode = (unsigned char)getub(buf, 5);
-    session->driver.sirf.altitude_hold_source = (unsigned char)getub(buf, 6);
-    session->driver.sirf.altitude_source_input = getbes16(buf, 7);
-    session->driver.sirf.degraded_mode = (unsigned char)getub(buf, 9);
-    session->driver.sirf.degraded_timeout = (unsigned char)getub(buf, 10);
-    session->driver.sirf.dr_timeout = (unsigned char)getub(buf, 11);
-    session->driver.sirf.track_smooth_mode = (unsigned char)getub(buf, 12);
+    session->driver->sirf.nav_parameters_seen = true;
+    session->driver->sirf.altitude_hold_mode = (unsigned char)getub(buf, 5);
+    session->driver->sirf.altitude_hold_source = (unsigned char)getub(buf, 6);
+    session->driver->sirf.altitude_source_input = getbes16(buf, 7);
+    session->driver->sirf.degraded_mode = (unsigned char)getub(buf, 9);
+    session->driver->sirf.degraded_timeout = (unsigned char)getub(buf, 10);
+    session->driver->sirf.dr_timeout = (unsigned char)getub(buf, 11);
+    session->driver->sirf.track_smooth_mode = (unsigned char)getub(buf, 12);
     return 0;
 }
 
@@ -947,7 +944,7 @@ static gps_mask_t sirf_msg_dgpsstatus(struct gps_device_t *session,
 				 unsigned char *buf, size_t len UNUSED)
 /* only documentented from prorocol version 1.7 (2005) onwards */
 {
-    session->driver.sirf.dgps_source = (unsigned int)getub(buf, 1);
+    session->driver->sirf.dgps_source = (unsigned int)getub(buf, 1);
     return 0;
 }
 
@@ -1007,14 +1004,14 @@ static gps_mask_t sirf_msg_ublox(struct gps_device_t *session,
 	subseconds = ((unsigned short)getbeu16(buf, 32)) * 1e-3;
 	session->newdata.time = (timestamp_t)mkgmtime(&unpacked_date) + subseconds;
 #ifdef TIMEHINT_ENABLE
-	if (0 == (session->driver.sirf.time_seen & TIME_SEEN_UTC_2)) {
+	if (0 == (session->driver->sirf.time_seen & TIME_SEEN_UTC_2)) {
 	    gpsd_log(&session->context->errout, LOG_RAW,
 		     "SiRF: NTPD just SEEN_UTC_2\n");
 	}
 	gpsd_log(&session->context->errout, LOG_PROG,
 		 "SiRF: NTPD valid time MID 0x62, seen=0x%02x\n",
-		 session->driver.sirf.time_seen);
-	session->driver.sirf.time_seen |= TIME_SEEN_UTC_2;
+		 session->driver->sirf.time_seen);
+	session->driver->sirf.time_seen |= TIME_SEEN_UTC_2;
 #endif /* TIMEHINT_ENABLE */
 	session->context->valid |= LEAP_SECOND_VALID;
     }
@@ -1024,7 +1021,7 @@ static gps_mask_t sirf_msg_ublox(struct gps_device_t *session,
     session->gpsdata.dop.hdop = (int)getub(buf, 36) / 5.0;
     session->gpsdata.dop.vdop = (int)getub(buf, 37) / 5.0;
     session->gpsdata.dop.tdop = (int)getub(buf, 38) / 5.0;
-    session->driver.sirf.driverstate |= UBLOX;
+    session->driver->sirf.driverstate |= UBLOX;
     gpsd_log(&session->context->errout, LOG_DATA,
 	     "SiRF: EMD 0x62: time=%.2f lat=%.2f lon=%.2f alt=%.f speed=%.2f track=%.2f climb=%.2f mode=%d status=%d gdop=%.2f pdop=%.2f hdop=%.2f vdop=%.2f tdop=%.2f\n",
 	     session->newdata.time, session->newdata.latitude,
@@ -1061,15 +1058,15 @@ static gps_mask_t sirf_msg_ppstime(struct gps_device_t *session,
 	session->context->leap_seconds = (int)getbeu16(buf, 8);
 	session->context->valid |= LEAP_SECOND_VALID;
 #ifdef TIMEHINT_ENABLE
-	if (0 == (session->driver.sirf.time_seen & TIME_SEEN_UTC_2)) {
+	if (0 == (session->driver->sirf.time_seen & TIME_SEEN_UTC_2)) {
 	    gpsd_log(&session->context->errout, LOG_RAW,
 		     "SiRF: NTPD just SEEN_UTC_2\n");
 	}
 	gpsd_log(&session->context->errout, LOG_PROG,
 		 "SiRF: NTPD valid time MID 0x34, seen=0x%02x, leap=%d\n",
-		 session->driver.sirf.time_seen,
+		 session->driver->sirf.time_seen,
 		 session->context->leap_seconds);
-	session->driver.sirf.time_seen |= TIME_SEEN_UTC_2;
+	session->driver->sirf.time_seen |= TIME_SEEN_UTC_2;
 #endif /* TIMEHINT_ENABLE */
 	mask |= TIME_SET;
 	if ( 3 <= session->gpsdata.satellites_visible ) {
@@ -1174,14 +1171,16 @@ gps_mask_t sirf_parse(struct gps_device_t * session, unsigned char *buf,
     len -= 8;
     gpsd_log(&session->context->errout, LOG_RAW,
 	     "SiRF: Raw packet type 0x%02x\n", buf[0]);
-    session->driver.sirf.lastid = buf[0];
+    GPSD_TRACE(LOG_DATA, "SiRF: packet type 0x%02lx length %ld\n",
+	       buf[0], len, 0, 0);
+    session->driver->sirf.lastid = buf[0];
 
     /* could change if the set of messages we enable does */
     session->cycle_end_reliable = true;
 
     switch (buf[0]) {
     case 0x02:			/* Measure Navigation Data Out MID 2 */
-	if ((session->driver.sirf.driverstate & UBLOX) == 0)
+	if ((session->driver->sirf.driverstate & UBLOX) == 0)
 	    return sirf_msg_navsol(session, buf,
 				   len) | (CLEAR_IS | REPORT_IS);
 	else {
@@ -1231,14 +1230,14 @@ gps_mask_t sirf_parse(struct gps_device_t * session, unsigned char *buf,
     case 0x0b:			/* Command Acknowledgement MID 11 */
 	gpsd_log(&session->context->errout, LOG_PROG,
 		 "SiRF: ACK 0x0b: %02x\n", getub(buf, 1));
-	session->driver.sirf.need_ack = 0;
+	session->driver->sirf.need_ack = 0;
 	return 0;
 
     case 0x0c:			/* Command NAcknowledgement MID 12 */
 	gpsd_log(&session->context->errout, LOG_PROG,
 		 "SiRF: NAK 0x0c: %02x\n", getub(buf, 1));
 	/* ugh -- there's no alternative but silent failure here */
-	session->driver.sirf.need_ack = 0;
+	session->driver->sirf.need_ack = 0;
 	return 0;
 
     case 0x0d:			/* Visible List MID 13 */
@@ -1400,11 +1399,11 @@ static void sirfbin_event_hook(struct gps_device_t *session, event_t event)
     if (event == event_configure) {
 #ifdef __UNUSED__
 	/* might not be time for the next init string yet */
-	if (session->driver.sirf.need_ack > 0)
+	if (session->driver->sirf.need_ack > 0)
 	    return;
 #endif /* UNUSED */
 
-	switch (session->driver.sirf.cfg_stage++) {
+	switch (session->driver->sirf.cfg_stage++) {
 	case 0:
 	    /* this slot used by event_identified */
 	    return;
@@ -1451,9 +1450,11 @@ static void sirfbin_event_hook(struct gps_device_t *session, event_t event)
 	    break;
 
 	case 6:
-	    gpsd_log(&session->context->errout, LOG_PROG,
-		     "SiRF: Requesting periodic tracker reports.\n");
-	    (void)sirf_write(session, requesttracker);
+	    if ((session->pruned & SATELLITE_SET) == 0) {
+		gpsd_log(&session->context->errout, LOG_PROG,
+			 "SiRF: Requesting periodic tracker reports.\n");
+		(void)sirf_write(session, requesttracker);
+	    }
 	    break;
 
 	case 7:
@@ -1475,8 +1476,13 @@ static void sirfbin_event_hook(struct gps_device_t *session, event_t event)
 	    break;
 
 	case 10:
-	    /* SiRF recommends at least 57600 for SiRF IV nav data */
-	    if (session->gpsdata.dev.baudrate >= 57600) {
+	    /*
+	     * SiRF recommends at least 57600 for SiRF IV nav data.
+	     * This is an initialize-data-source message, so we only
+	     * consult subscribers here rather than toggling it later.
+	     */
+	    if (session->gpsdata.dev.baudrate >= 57600
+		&& (session->pruned & SUBFRAME_SET) == 0) {
 		/* fast enough, turn on nav data */
 		gpsd_log(&session->context->errout, LOG_PROG,
 			 "SiRF: Enabling subframe transmission.\n");
@@ -1507,6 +1513,23 @@ static void sirfbin_event_hook(struct gps_device_t *session, event_t event)
 	}
     }
 
+#ifdef RECONFIGURE_ENABLE
+    if (event == event_subscription && session->lexer.type == SIRF_PACKET) {
+	/* MID 4 only feeds sky views; stop it if nobody looks */
+	if ((session->pruned & SATELLITE_SET) != 0) {
+	    gpsd_log(&session->context->errout, LOG_PROG,
+		     "SiRF: unset MID 4.\n");
+	    putbyte(unsetmidXX, 5, 0x00);
+	    putbyte(unsetmidXX, 6, 0x04);
+	    (void)sirf_write(session, unsetmidXX);
+	} else {
+	    gpsd_log(&session->context->errout, LOG_PROG,
+		     "SiRF: Requesting periodic tracker reports.\n");
+	    (void)sirf_write(session, requesttracker);
+	}
+    }
+#endif /* RECONFIGURE_ENABLE */
+
     if (event == event_deactivate) {
 
 	static unsigned char moderevert[] = { 0xa0, 0xa2, 0x00, 0x0e,
@@ -1523,13 +1546,13 @@ static void sirfbin_event_hook(struct gps_device_t *session, event_t event)
 	    0x00,		/* track smoothing */
 	    0x00, 0x00, 0xb0, 0xb3
 	};
-	putbyte(moderevert, 7, session->driver.sirf.degraded_mode);
-	putbe16(moderevert, 10, session->driver.sirf.altitude_source_input);
-	putbyte(moderevert, 12, session->driver.sirf.altitude_hold_mode);
-	putbyte(moderevert, 13, session->driver.sirf.altitude_hold_source);
-	putbyte(moderevert, 15, session->driver.sirf.degraded_timeout);
-	putbyte(moderevert, 16, session->driver.sirf.dr_timeout);
-	putbyte(moderevert, 17, session->driver.sirf.track_smooth_mode);
+	putbyte(moderevert, 7, session->driver->sirf.degraded_mode);
+	putbe16(moderevert, 10, session->driver->sirf.altitude_source_input);
+	putbyte(moderevert, 12, session->driver->sirf.altitude_hold_mode);
+	putbyte(moderevert, 13, session->driver->sirf.altitude_hold_source);
+	putbyte(moderevert, 15, session->driver->sirf.degraded_timeout);
+	putbyte(moderevert, 16, session->driver->sirf.dr_timeout);
+	putbyte(moderevert, 17, session->driver->sirf.track_smooth_mode);
 	gpsd_log(&session->context->errout, LOG_PROG,
 		 "SiRF: Reverting navigation parameters...\n");
 	(void)sirf_write(session, moderevert);
@@ -334,7 +334,7 @@ superstar2_msg_iono_utc(struct gps_device_t *session, unsigned char *buf,
     gpsd_log(&session->context->errout, LOG_PROG,
 	     "superstar2 #75 - ionospheric & utc data: iono %s utc %s\n",
 	     i ? "ok" : "bad", u ? "ok" : "bad");
-    session->driver.superstar2.last_iono = time(NULL);
+    session->driver->superstar2.last_iono = time(NULL);
 
     return 0;
 }
@@ -353,7 +353,7 @@ superstar2_msg_ephemeris(struct gps_device_t *session, unsigned char *buf,
 	     "superstar2 #22 - ephemeris data - prn %u\n", prn);
 
     /* ephemeris data updates fairly slowly, but when it does, poll UTC */
-    if ((time(NULL) - session->driver.superstar2.last_iono) > 60)
+    if ((time(NULL) - session->driver->superstar2.last_iono) > 60)
 	(void)superstar2_write(session, (char *)iono_utc_msg,
 			       sizeof(iono_utc_msg));
 
@@ -454,7 +454,7 @@ static void superstar2_event_hook(struct gps_device_t *session, event_t event)
 			       sizeof(ephemeris_msg));
 	(void)superstar2_write(session, (char *)iono_utc_msg,
 			       sizeof(iono_utc_msg));
-	session->driver.superstar2.last_iono = time(NULL);
+	session->driver->superstar2.last_iono = time(NULL);
     }
 }
 
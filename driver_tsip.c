@@ -126,7 +126,7 @@ static gps_mask_t tsip_parse_input(struct gps_device_t *session)
     float f1, f2, f3, f4, f5;
     double d1, d2, d3, d4, d5;
     time_t now;
-    unsigned char buf[BUFSIZ];
+    unsigned char buf[sizeof(session->lexer.outbuffer)];
     char buf2[BUFSIZ];
 
     if (session->lexer.type != TSIP_PACKET) {
@@ -140,22 +140,25 @@ static gps_mask_t tsip_parse_input(struct gps_device_t *session)
 	return 0;
 
     /* remove DLE stuffing and put data part of message in buf */
-
-    memset(buf, 0, sizeof(buf));
-    buf2[len = 0] = '\0';
+    len = 0;
     for (i = 2; i < (int)session->lexer.outbuflen; i++) {
-	if (session->lexer.outbuffer[i] == 0x10)
-	    if (session->lexer.outbuffer[++i] == 0x03)
-		break;
-
-	str_appendf(buf2, sizeof(buf2),
-		       "%02x", buf[len++] = session->lexer.outbuffer[i]);
+	if (session->lexer.outbuffer[i] == 0x10
+	    && i + 1 < (int)session->lexer.outbuflen
+	    && session->lexer.outbuffer[++i] == 0x03)
+	    break;
+	buf[len++] = session->lexer.outbuffer[i];
     }
+    /* some decoders read fixed offsets without a length check */
+    memset(buf + len, 0, sizeof(buf) - len);
 
     id = (unsigned)session->lexer.outbuffer[1];
-    gpsd_log(&session->context->errout, LOG_DATA,
-	     "TSIP packet id 0x%02x length %d: %s\n",
-	     id, len, buf2);
+    GPSD_TRACE(LOG_DATA, "TSIP: packet id 0x%02lx length %ld\n", id, len, 0, 0);
+    /* guard keeps the hex dump from being rendered when nobody reads it */
+    if (gpsd_log_enabled(&session->context->errout, LOG_DATA))
+	gpsd_log(&session->context->errout, LOG_DATA,
+		 "TSIP packet id 0x%02x length %d: %s\n",
+		 id, len,
+		 gpsd_hexdump(buf2, sizeof(buf2), (char *)buf, (size_t)len));
     (void)time(&now);
 
     session->cycle_end_reliable = true;
@@ -232,7 +235,7 @@ static gps_mask_t tsip_parse_input(struct gps_device_t *session)
 		if (s2 == 3001) {
 			gpsd_log(&session->context->errout, LOG_INF,
 				 "This device is Accutime Gold\n");
-			session->driver.tsip.subtype = TSIP_ACCUTIME_GOLD;
+			session->driver->tsip.subtype = TSIP_ACCUTIME_GOLD;
 			configuration_packets_accutime_gold(session);
 		}
 		else {
@@ -244,7 +247,7 @@ static gps_mask_t tsip_parse_input(struct gps_device_t *session)
     case 0x41:			/* GPS Time */
 	if (len != 10)
 	    break;
-	session->driver.tsip.last_41 = now;	/* keep timestamp for request */
+	session->driver->tsip.last_41 = now;	/* keep timestamp for request */
 	f1 = getbef32((char *)buf, 0);	/* gpstime */
 	s1 = getbes16(buf, 4);	/* week */
 	f2 = getbef32((char *)buf, 6);	/* leap seconds */
@@ -302,7 +305,7 @@ static gps_mask_t tsip_parse_input(struct gps_device_t *session)
     case 0x46:			/* Health of Receiver */
 	if (len != 2)
 	    break;
-	session->driver.tsip.last_46 = now;
+	session->driver->tsip.last_46 = now;
 	u1 = getub(buf, 0);	/* Status code */
 	u2 = getub(buf, 1);	/* Antenna/Battery */
 	if (u1 != (uint8_t) 0) {
@@ -332,7 +335,8 @@ static gps_mask_t tsip_parse_input(struct gps_device_t *session)
 		    session->gpsdata.skyview[j].ss = f1;
 		    break;
 		}
-	    str_appendf(buf2, sizeof(buf2), " %d=%.1f", (int)u1, f1);
+	    if (gpsd_log_enabled(&session->context->errout, LOG_PROG))
+		str_appendf(buf2, sizeof(buf2), " %d=%.1f", (int)u1, f1);
 	}
 	gpsd_log(&session->context->errout, LOG_PROG,
 		 "Signal Levels (%d):%s\n", count, buf2);
@@ -377,7 +381,7 @@ static gps_mask_t tsip_parse_input(struct gps_device_t *session)
 	gpsd_log(&session->context->errout, LOG_INF,
 		 "Machine ID %02x %02x %02x\n", u1, u2, u3);
 #if USE_SUPERPACKET
-	if ((u3 & 0x01) != (uint8_t) 0 && !session->driver.tsip.superpkt) {
+	if ((u3 & 0x01) != (uint8_t) 0 && !session->driver->tsip.superpkt) {
 	    gpsd_log(&session->context->errout, LOG_PROG,
 		     "Switching to Super Packet mode\n");
 
@@ -387,7 +391,7 @@ static gps_mask_t tsip_parse_input(struct gps_device_t *session)
 	    putbyte(buf, 2, 0x00);	/* Time: GPS */
 	    putbyte(buf, 3, 0x08);	/* Aux: dBHz */
 	    (void)tsip_write(session, 0x35, buf, 4);
-	    session->driver.tsip.superpkt = true;
+	    session->driver->tsip.superpkt = true;
 	}
 #endif /* USE_SUPERPACKET */
 	break;
@@ -415,7 +419,7 @@ static gps_mask_t tsip_parse_input(struct gps_device_t *session)
 	    putbyte(buf, 0, 0x23);
 	    putbyte(buf, 1, 0x01);	/* enabled */
 	    (void)tsip_write(session, 0x8e, buf, 2);
-	    session->driver.tsip.req_compact = now;
+	    session->driver->tsip.req_compact = now;
 	}
 #endif /* USE_SUPERPACKET */
 	break;
@@ -494,7 +498,7 @@ static gps_mask_t tsip_parse_input(struct gps_device_t *session)
 		session->gpsdata.skyview[i].azimuth = (short)round(d2);
 		session->gpsdata.skyview[i].used = false;
 		for (j = 0; j < session->gpsdata.satellites_used; j++)
-		    if (session->gpsdata.skyview[i].PRN != 0 && session->driver.tsip.sats_used[j] != 0)
+		    if (session->gpsdata.skyview[i].PRN != 0 && session->driver->tsip.sats_used[j] != 0)
 			session->gpsdata.skyview[i].used = true;
 	    } else {
 		session->gpsdata.skyview[i].PRN =
@@ -518,7 +522,7 @@ static gps_mask_t tsip_parse_input(struct gps_device_t *session)
 	count = (int)((u1 >> 4) & 0x0f);
 	if (len != (17 + count))
 	    break;
-	session->driver.tsip.last_6d = now;	/* keep timestamp for request */
+	session->driver->tsip.last_6d = now;	/* keep timestamp for request */
 #ifdef __UNUSED__
 	/*
 	 * This looks right, but it sets a spurious mode value when
@@ -553,22 +557,26 @@ static gps_mask_t tsip_parse_input(struct gps_device_t *session)
 	    sqrt(pow(session->gpsdata.dop.pdop, 2) +
 		 pow(session->gpsdata.dop.tdop, 2));
 
-	memset(session->driver.tsip.sats_used, 0, sizeof(session->driver.tsip.sats_used));
+	memset(session->driver->tsip.sats_used, 0, sizeof(session->driver->tsip.sats_used));
 	buf2[0] = '\0';
-	for (i = 0; i < count; i++)
-	    str_appendf(buf2, sizeof(buf2),
-			   " %d", session->driver.tsip.sats_used[i] =
-			   (short)getub(buf, 17 + i));
+	for (i = 0; i < count; i++) {
+	    session->driver->tsip.sats_used[i] = (short)getub(buf, 17 + i);
+	    if (gpsd_log_enabled(&session->context->errout, LOG_DATA))
+		str_appendf(buf2, sizeof(buf2),
+			    " %d", session->driver->tsip.sats_used[i]);
+	}
 	gpsd_log(&session->context->errout, LOG_DATA,
 		 "AIVSS: 0x6d status=%d used=%d "
-		 "pdop=%.1f hdop=%.1f vdop=%.1f tdop=%.1f gdup=%.1f\n",
+		 "pdop=%.1f hdop=%.1f vdop=%.1f tdop=%.1f gdup=%.1f"
+		 " sats:%s\n",
 		 session->gpsdata.status,
 		 session->gpsdata.satellites_used,
 		 session->gpsdata.dop.pdop,
 		 session->gpsdata.dop.hdop,
 		 session->gpsdata.dop.vdop,
 		 session->gpsdata.dop.tdop,
-		 session->gpsdata.dop.gdop);
+		 session->gpsdata.dop.gdop,
+		 buf2);
 	mask |= DOP_SET | STATUS_SET | USED_IS;
 	break;
     case 0x6e:			/* Synchronized Measurements */
@@ -726,7 +734,7 @@ static gps_mask_t tsip_parse_input(struct gps_device_t *session)
 		     session->newdata.mode, session->gpsdata.status);
 	    break;
 	case 0x23:		/* Compact Super Packet */
-	    session->driver.tsip.req_compact = 0;
+	    session->driver->tsip.req_compact = 0;
 	    /* CSK sez "i don't trust this to not be oversized either." */
 	    if (len < 29)
 		break;
@@ -800,7 +808,7 @@ static gps_mask_t tsip_parse_input(struct gps_device_t *session)
 		gpsd_log(&session->context->errout, 4, "pkt 0xab len=%d\n", len);
 		break;
 	    }
-	    session->driver.tsip.last_41 = now;	/* keep timestamp for request */
+	    session->driver->tsip.last_41 = now;	/* keep timestamp for request */
 	    ul1 = getbeu32(buf, 1);	/* gpstime */
 	    s1 = (int16_t)getbeu16(buf, 5);	/* week */
 	    s2 = getbes16(buf, 7);	/* leap seconds */
@@ -928,41 +936,41 @@ static gps_mask_t tsip_parse_input(struct gps_device_t *session)
     /* see if it is time to send some request packets for reports that */
     /* the receiver won't send at fixed intervals */
 
-    if ((now - session->driver.tsip.last_41) > 5) {
+    if ((now - session->driver->tsip.last_41) > 5) {
 	/* Request Current Time */
 	(void)tsip_write(session, 0x21, buf, 0);
-	session->driver.tsip.last_41 = now;
+	session->driver->tsip.last_41 = now;
     }
 
-    if ((now - session->driver.tsip.last_6d) > 5) {
+    if ((now - session->driver->tsip.last_6d) > 5) {
 	/* Request GPS Receiver Position Fix Mode */
 	(void)tsip_write(session, 0x24, buf, 0);
-	session->driver.tsip.last_6d = now;
+	session->driver->tsip.last_6d = now;
     }
 
-    if ((now - session->driver.tsip.last_48) > 60) {
+    if ((now - session->driver->tsip.last_48) > 60) {
 	/* Request GPS System Message */
 	(void)tsip_write(session, 0x28, buf, 0);
-	session->driver.tsip.last_48 = now;
+	session->driver->tsip.last_48 = now;
     }
 
-    if ((now - session->driver.tsip.last_5c) >= 5) {
+    if ((now - session->driver->tsip.last_5c) >= 5) {
 	/* Request Current Satellite Tracking Status */
 	putbyte(buf, 0, 0x00);	/* All satellites */
 	(void)tsip_write(session, 0x3c, buf, 1);
-	session->driver.tsip.last_5c = now;
+	session->driver->tsip.last_5c = now;
     }
 
-    if ((now - session->driver.tsip.last_46) > 5) {
+    if ((now - session->driver->tsip.last_46) > 5) {
 	/* Request Health of Receiver */
 	(void)tsip_write(session, 0x26, buf, 0);
-	session->driver.tsip.last_46 = now;
+	session->driver->tsip.last_46 = now;
     }
 #if USE_SUPERPACKET
-    if ((session->driver.tsip.req_compact > 0) &&
-	((now - session->driver.tsip.req_compact) > 5)) {
+    if ((session->driver->tsip.req_compact > 0) &&
+	((now - session->driver->tsip.req_compact) > 5)) {
 	/* Compact Superpacket requested but no response */
-	session->driver.tsip.req_compact = 0;
+	session->driver->tsip.req_compact = 0;
 	gpsd_log(&session->context->errout, LOG_WARN,
 		 "No Compact Super Packet, use LFwEI\n");
 
@@ -1025,8 +1033,8 @@ static void tsip_event_hook(struct gps_device_t *session, event_t event)
 	 * fragile wire format.  We must divine a clever
 	 * heuristic to decide if the parity change is required.
 	 */
-	session->driver.tsip.parity = session->gpsdata.dev.parity;
-	session->driver.tsip.stopbits =
+	session->driver->tsip.parity = session->gpsdata.dev.parity;
+	session->driver->tsip.stopbits =
 	    (uint) session->gpsdata.dev.stopbits;
 	// gpsd_set_speed(session, session->gpsdata.dev.baudrate, 'O', 1);
     }
@@ -1034,8 +1042,8 @@ static void tsip_event_hook(struct gps_device_t *session, event_t event)
 	/* restore saved parity and stopbits when leaving TSIP mode */
 	gpsd_set_speed(session,
 		       session->gpsdata.dev.baudrate,
-		       session->driver.tsip.parity,
-		       session->driver.tsip.stopbits);
+		       session->driver->tsip.parity,
+		       session->driver->tsip.stopbits);
     }
 }
 
@@ -31,6 +31,7 @@
 #include "driver_ubx.h"
 
 #include "bits.h"
+#include "strfuncs.h"
 
 /*
  * A ubx packet looks like this:
@@ -61,18 +62,20 @@ static gps_mask_t ubx_parse(struct gps_device_t *session, unsigned char *buf,
 			    size_t len);
 static gps_mask_t ubx_msg_nav_dop(struct gps_device_t *session,
 				  unsigned char *buf, size_t data_len);
-static void ubx_msg_inf(struct gps_device_t *session, unsigned char *buf, size_t data_len);
+static gps_mask_t ubx_msg_inf(struct gps_device_t *session, unsigned char *buf,
+			      size_t data_len, int loglevel, const char *label);
 static gps_mask_t ubx_msg_nav_pvt(struct gps_device_t *session,
 				  unsigned char *buf, size_t data_len);
-static void ubx_msg_sbas(struct gps_device_t *session, unsigned char *buf);
+static gps_mask_t ubx_msg_sbas(struct gps_device_t *session,
+			       unsigned char *buf, size_t data_len);
 static gps_mask_t ubx_msg_nav_sol(struct gps_device_t *session,
 				  unsigned char *buf, size_t data_len);
 static gps_mask_t ubx_msg_nav_svinfo(struct gps_device_t *session,
 				     unsigned char *buf, size_t data_len);
 static gps_mask_t ubx_msg_nav_timegps(struct gps_device_t *session,
 				      unsigned char *buf, size_t data_len);
-static void ubx_msg_mon_ver(struct gps_device_t *session,
-				      unsigned char *buf, size_t data_len);
+static gps_mask_t ubx_msg_mon_ver(struct gps_device_t *session,
+				  unsigned char *buf, size_t data_len);
 #ifdef RECONFIGURE_ENABLE
 static void ubx_mode(struct gps_device_t *session, int mode);
 #endif /* RECONFIGURE_ENABLE */
@@ -84,31 +87,25 @@ static void ubx_mode(struct gps_device_t *session, int mode);
  * sadly more info than fits in session->swtype for now.
  * so squish the data hard, max is maybe 100?
  */
-static void
+static gps_mask_t
 ubx_msg_mon_ver(struct gps_device_t *session, unsigned char *buf,
 		size_t data_len)
 {
     size_t n = 0;	/* extended info counter */
     char obuf[128];     /* temp version string buffer */
 
-    if ( 44 > data_len ) {
-	/* incomplete message */
-        return;
-    }
-
     /* save SW and HW Version as subtype */
     (void)snprintf(obuf, sizeof(obuf),
 		   "SW %.30s,HW %.10s",
-		   (char *)&buf[UBX_MESSAGE_DATA_OFFSET + 0],
-		   (char *)&buf[UBX_MESSAGE_DATA_OFFSET + 30]);
+		   (char *)&buf[0],
+		   (char *)&buf[30]);
 
     /* get n number of Extended info strings.  what is max n? */
     for ( n = 0; ; n++ ) {
-        size_t start_of_str = UBX_MESSAGE_DATA_OFFSET + 40 + (30 * n);
+        size_t start_of_str = 40 + (30 * n);
 
-        if ( (start_of_str + 2 ) > data_len ) {
-	    /* last one can be shorter than 30 */
-            /* no more data */
+        if ( (start_of_str + 30) > data_len ) {
+	    /* no more data */
             break;
         }
 	(void)strlcat(obuf, ",", sizeof(obuf));
@@ -121,6 +118,7 @@ ubx_msg_mon_ver(struct gps_device_t *session, unsigned char *buf,
     gpsd_log(&session->context->errout, LOG_INF,
 	     "UBX_MON_VER: %.*s\n",
              (int)sizeof(obuf), obuf);
+    return 0;
 }
 
 /**
@@ -128,14 +126,11 @@ ubx_msg_mon_ver(struct gps_device_t *session, unsigned char *buf,
  */
 static gps_mask_t
 ubx_msg_nav_pvt(struct gps_device_t *session, unsigned char *buf,
-		size_t data_len)
+		size_t data_len UNUSED)
 {
     unsigned int flags;
     gps_mask_t mask = 0;
 
-    if (data_len != 92)
-	return 0;
-
     flags = (unsigned int)getub(buf, 21);
 
     /* TODO: finish decoding UBX_MON_PVT
@@ -151,16 +146,13 @@ ubx_msg_nav_pvt(struct gps_device_t *session, unsigned char *buf,
  */
 static gps_mask_t
 ubx_msg_nav_sol(struct gps_device_t *session, unsigned char *buf,
-		size_t data_len)
+		size_t data_len UNUSED)
 {
     unsigned int flags;
     double epx, epy, epz, evx, evy, evz;
     unsigned char navmode;
     gps_mask_t mask;
 
-    if (data_len != 52)
-	return 0;
-
     flags = (unsigned int)getub(buf, 11);
     mask = 0;
     if ((flags & (UBX_SOL_VALID_WEEK | UBX_SOL_VALID_TIME)) != 0) {
@@ -182,16 +174,16 @@ ubx_msg_nav_sol(struct gps_device_t *session, unsigned char *buf,
 		     epx, epy, epz, evx, evy, evz);
     mask |= LATLON_SET | ALTITUDE_SET | SPEED_SET | TRACK_SET | CLIMB_SET;
 
-    if (session->driver.ubx.last_herr > 0.0) {
-	session->newdata.epx = session->newdata.epy = session->driver.ubx.last_herr;
+    if (session->driver->ubx.last_herr > 0.0) {
+	session->newdata.epx = session->newdata.epy = session->driver->ubx.last_herr;
 	mask |= HERR_SET;
-	session->driver.ubx.last_herr = 0.0;
+	session->driver->ubx.last_herr = 0.0;
     }
 
-    if (session->driver.ubx.last_verr > 0.0) {
-	session->newdata.epv = session->driver.ubx.last_verr;
+    if (session->driver->ubx.last_verr > 0.0) {
+	session->newdata.epv = session->driver->ubx.last_verr;
 	mask |= VERR_SET;
-	session->driver.ubx.last_verr = 0.0;
+	session->driver->ubx.last_verr = 0.0;
     }
 
     session->newdata.eps = (double)(getles32(buf, 40) / 100.0);
@@ -234,7 +226,8 @@ ubx_msg_nav_sol(struct gps_device_t *session, unsigned char *buf,
 	     session->newdata.mode,
 	     session->gpsdata.status,
 	     session->gpsdata.satellites_used);
-    return mask;
+    /* UBX-NAV-SOL deprecated, use UBX-NAV-PVT instead */
+    return mask | CLEAR_IS | REPORT_IS;
 }
 
  /**
@@ -244,8 +237,8 @@ static gps_mask_t
 ubx_msg_nav_posllh(struct gps_device_t *session, unsigned char *buf,
 		   size_t data_len UNUSED)
 {
-    session->driver.ubx.last_herr = (double)(getleu32(buf, 20) / 1000.0);
-    session->driver.ubx.last_verr = (double)(getleu32(buf, 24) / 1000.0);
+    session->driver->ubx.last_herr = (double)(getleu32(buf, 20) / 1000.0);
+    session->driver->ubx.last_verr = (double)(getleu32(buf, 24) / 1000.0);
     return 0;
 }
 
@@ -254,11 +247,8 @@ ubx_msg_nav_posllh(struct gps_device_t *session, unsigned char *buf,
  */
 static gps_mask_t
 ubx_msg_nav_dop(struct gps_device_t *session, unsigned char *buf,
-		size_t data_len)
+		size_t data_len UNUSED)
 {
-    if (data_len != 18)
-	return 0;
-
     /*
      * We make a deliberate choice not to clear DOPs from the
      * last skyview here, but rather to treat this as a supplement
@@ -285,13 +275,10 @@ ubx_msg_nav_dop(struct gps_device_t *session, unsigned char *buf,
  */
 static gps_mask_t
 ubx_msg_nav_timegps(struct gps_device_t *session, unsigned char *buf,
-		    size_t data_len)
+		    size_t data_len UNUSED)
 {
     unsigned int gw, tow, flags;
 
-    if (data_len != 16)
-	return 0;
-
     tow = (unsigned int)getleu32(buf, 0);
     gw = (unsigned int)getles16(buf, 8);
     flags = (unsigned int)getub(buf, 11);
@@ -314,55 +301,63 @@ static gps_mask_t
 ubx_msg_nav_svinfo(struct gps_device_t *session, unsigned char *buf,
 		   size_t data_len)
 {
-    unsigned int i, nchan, nsv, st;
+    unsigned int i, nchan, nsv;
+    int changed;
 
-    if (data_len < 152) {
-	gpsd_log(&session->context->errout, LOG_PROG,
-		 "runt svinfo (datalen=%zd)\n", data_len);
-	return 0;
-    }
+    /* the dispatch table guarantees the 8-byte header */
     nchan = (unsigned int)getub(buf, 4);
-    if (nchan > MAXCHANNELS) {
+    if (nchan > MAXCHANNELS || 8 + 12 * nchan > data_len) {
 	gpsd_log(&session->context->errout, LOG_WARN,
 		 "Invalid NAV SVINFO message, >%d reported visible",
 		 MAXCHANNELS);
 	return 0;
     }
-    gpsd_zero_satellites(&session->gpsdata);
+    gpsd_skyview_begin(session);
     nsv = 0;
-    for (i = st = 0; i < nchan; i++) {
+    for (i = 0; i < nchan; i++) {
 	unsigned int off = 8 + 12 * i;
-	bool used = (bool)(getub(buf, off + 2) & 0x01);
+	struct satellite_t sat;
+
 	if ((int)getub(buf, off + 4) == 0)
 	    continue;		/* LEA-5H seems to have a bug reporting sats it does not see or hear */
-	session->gpsdata.skyview[st].PRN = (short)getub(buf, off + 1);
-	session->gpsdata.skyview[st].ss = (float)getub(buf, off + 4);
-	session->gpsdata.skyview[st].elevation = (short)getsb(buf, off + 5);
-	session->gpsdata.skyview[st].azimuth = (short)getles16(buf, off + 6);
-	session->gpsdata.skyview[st].used = used;
-	if (session->gpsdata.skyview[st].PRN == 0)
+	sat.PRN = (short)getub(buf, off + 1);
+	if (sat.PRN == 0)
 	    continue;
-	if (used || session->gpsdata.skyview[st].PRN == (short)session->driver.ubx.sbas_in_use) {
+	sat.ss = (float)getub(buf, off + 4);
+	sat.elevation = (short)getsb(buf, off + 5);
+	sat.azimuth = (short)getles16(buf, off + 6);
+	sat.used = (getub(buf, off + 2) & 0x01) != 0
+	    || sat.PRN == (short)session->driver->ubx.sbas_in_use;
+	if (!gpsd_skyview_merge(session, &sat))
+	    break;
+	if (sat.used)
 	    nsv++;
-	    session->gpsdata.skyview[st].used = true;
-	}
-	st++;
     }
+    changed = gpsd_skyview_end(session);
 
     session->gpsdata.skyview_time = NAN;
-    session->gpsdata.satellites_visible = (int)st;
     session->gpsdata.satellites_used = (int)nsv;
     gpsd_log(&session->context->errout, LOG_DATA,
-	     "SVINFO: visible=%d used=%d mask={SATELLITE|USED}\n",
+	     "SVINFO: visible=%d used=%d changed=%d mask={SATELLITE|USED}\n",
 	     session->gpsdata.satellites_visible,
-	     session->gpsdata.satellites_used);
+	     session->gpsdata.satellites_used, changed);
+
+    /* this is a hack to move some initialization until after we
+     * get some u-blox message so we know the GPS is alive */
+    if ('\0' == session->subtype[0]) {
+	/* one time only */
+	(void)strlcpy(session->subtype, "Unknown", 8);
+	/* request SW and HW Versions */
+	(void)ubx_write(session, UBX_CLASS_MON, 0x04, NULL, 0);
+    }
     return SATELLITE_SET | USED_IS;
 }
 
 /*
  * SBAS Info
  */
-static void ubx_msg_sbas(struct gps_device_t *session, unsigned char *buf)
+static gps_mask_t ubx_msg_sbas(struct gps_device_t *session,
+			       unsigned char *buf, size_t data_len UNUSED)
 {
 #ifdef __UNUSED_DEBUG__
     unsigned int i, nsv;
@@ -381,13 +376,15 @@ static void ubx_msg_sbas(struct gps_device_t *session, unsigned char *buf)
 #endif /* __UNUSED_DEBUG__ */
 /* really 'in_use' depends on the sats info, EGNOS is still in test */
 /* In WAAS areas one might also check for the type of corrections indicated */
-    session->driver.ubx.sbas_in_use = (unsigned char)getub(buf, 4);
+    session->driver->ubx.sbas_in_use = (unsigned char)getub(buf, 4);
+    return 0;
 }
 
 /*
  * Raw Subframes
  */
-static gps_mask_t ubx_msg_sfrb(struct gps_device_t *session, unsigned char *buf)
+static gps_mask_t ubx_msg_sfrb(struct gps_device_t *session,
+			       unsigned char *buf, size_t data_len UNUSED)
 {
     unsigned int i, chan, svid;
     uint32_t words[10];
@@ -405,229 +402,279 @@ static gps_mask_t ubx_msg_sfrb(struct gps_device_t *session, unsigned char *buf)
     return gpsd_interpret_subframe(session, svid, words);
 }
 
-static void ubx_msg_inf(struct gps_device_t *session, unsigned char *buf, size_t data_len)
+static gps_mask_t ubx_msg_inf(struct gps_device_t *session, unsigned char *buf,
+			      size_t data_len, int loglevel, const char *label)
 {
-    unsigned short msgid;
     static char txtbuf[MAX_PACKET_LENGTH];
 
-    msgid = (unsigned short)((buf[2] << 8) | buf[3]);
+    if (!gpsd_log_enabled(&session->context->errout, loglevel))
+	return 0;
     if (data_len > MAX_PACKET_LENGTH - 1)
 	data_len = MAX_PACKET_LENGTH - 1;
 
-    (void)strlcpy(txtbuf, (char *)buf + UBX_PREFIX_LEN, sizeof(txtbuf));
+    (void)memcpy(txtbuf, buf, data_len);
     txtbuf[data_len] = '\0';
-    switch (msgid) {
-    case UBX_INF_DEBUG:
-	gpsd_log(&session->context->errout, LOG_PROG, "UBX_INF_DEBUG: %s\n", txtbuf);
-	break;
-    case UBX_INF_TEST:
-	gpsd_log(&session->context->errout, LOG_PROG, "UBX_INF_TEST: %s\n", txtbuf);
-	break;
-    case UBX_INF_NOTICE:
-	gpsd_log(&session->context->errout, LOG_INF, "UBX_INF_NOTICE: %s\n", txtbuf);
-	break;
-    case UBX_INF_WARNING:
-	gpsd_log(&session->context->errout, LOG_WARN, "UBX_INF_WARNING: %s\n", txtbuf);
-	break;
-    case UBX_INF_ERROR:
-	gpsd_log(&session->context->errout, LOG_WARN, "UBX_INF_ERROR: %s\n", txtbuf);
-	break;
-    default:
-	break;
+    gpsd_log(&session->context->errout, loglevel, "%s: %s\n", label, txtbuf);
+    return 0;
+}
+
+static gps_mask_t ubx_msg_inf_debug(struct gps_device_t *session,
+				    unsigned char *buf, size_t data_len)
+{
+    return ubx_msg_inf(session, buf, data_len, LOG_PROG, "UBX_INF_DEBUG");
+}
+
+static gps_mask_t ubx_msg_inf_test(struct gps_device_t *session,
+				   unsigned char *buf, size_t data_len)
+{
+    return ubx_msg_inf(session, buf, data_len, LOG_PROG, "UBX_INF_TEST");
+}
+
+static gps_mask_t ubx_msg_inf_notice(struct gps_device_t *session,
+				     unsigned char *buf, size_t data_len)
+{
+    return ubx_msg_inf(session, buf, data_len, LOG_INF, "UBX_INF_NOTICE");
+}
+
+static gps_mask_t ubx_msg_inf_warning(struct gps_device_t *session,
+				      unsigned char *buf, size_t data_len)
+{
+    return ubx_msg_inf(session, buf, data_len, LOG_WARN, "UBX_INF_WARNING");
+}
+
+static gps_mask_t ubx_msg_inf_error(struct gps_device_t *session,
+				    unsigned char *buf, size_t data_len)
+{
+    return ubx_msg_inf(session, buf, data_len, LOG_WARN, "UBX_INF_ERROR");
+}
+
+/*
+ * Port configuration, as answered to our CFG-PRT poll
+ */
+static gps_mask_t ubx_msg_cfg_prt(struct gps_device_t *session,
+				  unsigned char *buf, size_t data_len UNUSED)
+{
+    session->driver->ubx.port_id = (unsigned char)getub(buf, 0);
+    gpsd_log(&session->context->errout, LOG_INF, "UBX_CFG_PRT: port %d\n",
+	     session->driver->ubx.port_id);
+    return 0;
+}
+
+/*
+ * Acknowledgements; the payload names the message being (n)acked
+ */
+static gps_mask_t ubx_msg_ack_nak(struct gps_device_t *session,
+				  unsigned char *buf, size_t data_len UNUSED)
+{
+    gpsd_log(&session->context->errout, LOG_WARN,
+	     "UBX_ACK_NAK, class: %02x, id: %02x\n",
+	     getub(buf, 0), getub(buf, 1));
+    return 0;
+}
+
+static gps_mask_t ubx_msg_ack_ack(struct gps_device_t *session,
+				  unsigned char *buf, size_t data_len UNUSED)
+{
+    gpsd_log(&session->context->errout, LOG_DATA,
+	     "UBX_ACK_ACK, class: %02x, id: %02x\n",
+	     getub(buf, 0), getub(buf, 1));
+    return 0;
+}
+
+/*
+ * Message dispatch table.  Each known class/id pair has an entry giving
+ * the level at which its arrival is traced, the payload lengths we
+ * accept, and the decoder, if any.  Messages without a decoder are only
+ * counted.  Per-message statistics live in session->driver->ubx.msgstats,
+ * indexed by table position; the slot just past the end of the table
+ * accumulates messages we don't recognize.
+ */
+typedef gps_mask_t (*ubx_decoder_t)(struct gps_device_t *,
+				    unsigned char *, size_t);
+
+#define UBX_VARLEN	0xffff	/* no upper bound on payload length */
+
+struct ubx_msgtab_t {
+    ubx_message_t msgid;
+    const char *name;
+    int loglevel;		/* trace level for message arrival */
+    size_t minlen, maxlen;	/* acceptable payload length */
+    ubx_decoder_t decoder;	/* NULL if we only count it */
+};
+
+/* *INDENT-OFF* */
+static const struct ubx_msgtab_t ubx_msgtab[] = {
+    {UBX_NAV_POSECEF,	"UBX_NAV_POSECEF",  LOG_DATA, 0, UBX_VARLEN, NULL},
+    {UBX_NAV_POSLLH,	"UBX_NAV_POSLLH",   LOG_DATA, 28, 28, ubx_msg_nav_posllh},
+    {UBX_NAV_STATUS,	"UBX_NAV_STATUS",   LOG_DATA, 0, UBX_VARLEN, NULL},
+    {UBX_NAV_DOP,	"UBX_NAV_DOP",      LOG_PROG, 18, 18, ubx_msg_nav_dop},
+    {UBX_NAV_SOL,	"UBX_NAV_SOL",      LOG_PROG, 52, 52, ubx_msg_nav_sol},
+    {UBX_NAV_PVT,	"UBX_NAV_PVT",      LOG_PROG, 92, 92, ubx_msg_nav_pvt},
+    {UBX_NAV_POSUTM,	"UBX_NAV_POSUTM",   LOG_DATA, 0, UBX_VARLEN, NULL},
+    {UBX_NAV_VELECEF,	"UBX_NAV_VELECEF",  LOG_DATA, 0, UBX_VARLEN, NULL},
+    {UBX_NAV_VELNED,	"UBX_NAV_VELNED",   LOG_DATA, 0, UBX_VARLEN, NULL},
+    {UBX_NAV_TIMEGPS,	"UBX_NAV_TIMEGPS",  LOG_PROG, 16, 16, ubx_msg_nav_timegps},
+    {UBX_NAV_TIMEUTC,	"UBX_NAV_TIMEUTC",  LOG_DATA, 0, UBX_VARLEN, NULL},
+    {UBX_NAV_CLOCK,	"UBX_NAV_CLOCK",    LOG_DATA, 0, UBX_VARLEN, NULL},
+    {UBX_NAV_SVINFO,	"UBX_NAV_SVINFO",   LOG_PROG, 8, UBX_VARLEN, ubx_msg_nav_svinfo},
+    {UBX_NAV_DGPS,	"UBX_NAV_DGPS",     LOG_DATA, 0, UBX_VARLEN, NULL},
+    {UBX_NAV_SBAS,	"UBX_NAV_SBAS",     LOG_DATA, 12, UBX_VARLEN, ubx_msg_sbas},
+    {UBX_NAV_EKFSTATUS,	"UBX_NAV_EKFSTATUS", LOG_DATA, 0, UBX_VARLEN, NULL},
+
+    {UBX_RXM_RAW,	"UBX_RXM_RAW",      LOG_DATA, 0, UBX_VARLEN, NULL},
+    {UBX_RXM_SFRB,	"UBX_RXM_SFRB",     LOG_DATA, 42, 42, ubx_msg_sfrb},
+    {UBX_RXM_SVSI,	"UBX_RXM_SVSI",     LOG_PROG, 0, UBX_VARLEN, NULL},
+    {UBX_RXM_ALM,	"UBX_RXM_ALM",      LOG_DATA, 0, UBX_VARLEN, NULL},
+    {UBX_RXM_EPH,	"UBX_RXM_EPH",      LOG_DATA, 0, UBX_VARLEN, NULL},
+    {UBX_RXM_POSREQ,	"UBX_RXM_POSREQ",   LOG_DATA, 0, UBX_VARLEN, NULL},
+
+    {UBX_MON_SCHED,	"UBX_MON_SCHED",    LOG_DATA, 0, UBX_VARLEN, NULL},
+    {UBX_MON_IO,	"UBX_MON_IO",       LOG_DATA, 0, UBX_VARLEN, NULL},
+    {UBX_MON_IPC,	"UBX_MON_IPC",      LOG_DATA, 0, UBX_VARLEN, NULL},
+    {UBX_MON_VER,	"UBX_MON_VER",      LOG_DATA, 40, UBX_VARLEN, ubx_msg_mon_ver},
+    {UBX_MON_EXCEPT,	"UBX_MON_EXCEPT",   LOG_DATA, 0, UBX_VARLEN, NULL},
+    {UBX_MON_MSGPP,	"UBX_MON_MSGPP",    LOG_DATA, 0, UBX_VARLEN, NULL},
+    {UBX_MON_RXBUF,	"UBX_MON_RXBUF",    LOG_DATA, 0, UBX_VARLEN, NULL},
+    {UBX_MON_TXBUF,	"UBX_MON_TXBUF",    LOG_DATA, 0, UBX_VARLEN, NULL},
+    {UBX_MON_HW,	"UBX_MON_HW",       LOG_DATA, 0, UBX_VARLEN, NULL},
+    {UBX_MON_USB,	"UBX_MON_USB",      LOG_DATA, 0, UBX_VARLEN, NULL},
+
+    {UBX_INF_DEBUG,	"UBX_INF_DEBUG",    LOG_RAW, 0, UBX_VARLEN, ubx_msg_inf_debug},
+    {UBX_INF_TEST,	"UBX_INF_TEST",     LOG_RAW, 0, UBX_VARLEN, ubx_msg_inf_test},
+    {UBX_INF_NOTICE,	"UBX_INF_NOTICE",   LOG_RAW, 0, UBX_VARLEN, ubx_msg_inf_notice},
+    {UBX_INF_WARNING,	"UBX_INF_WARNING",  LOG_RAW, 0, UBX_VARLEN, ubx_msg_inf_warning},
+    {UBX_INF_ERROR,	"UBX_INF_ERROR",    LOG_RAW, 0, UBX_VARLEN, ubx_msg_inf_error},
+
+    {UBX_CFG_PRT,	"UBX_CFG_PRT",      LOG_DATA, 1, UBX_VARLEN, ubx_msg_cfg_prt},
+
+    {UBX_TIM_TP,	"UBX_TIM_TP",       LOG_DATA, 0, UBX_VARLEN, NULL},
+    {UBX_TIM_TM,	"UBX_TIM_TM",       LOG_DATA, 0, UBX_VARLEN, NULL},
+    {UBX_TIM_TM2,	"UBX_TIM_TM2",      LOG_DATA, 0, UBX_VARLEN, NULL},
+    {UBX_TIM_SVIN,	"UBX_TIM_SVIN",     LOG_DATA, 0, UBX_VARLEN, NULL},
+
+    {UBX_ACK_NAK,	"UBX_ACK_NAK",      LOG_RAW, 2, 2, ubx_msg_ack_nak},
+    {UBX_ACK_ACK,	"UBX_ACK_ACK",      LOG_RAW, 2, 2, ubx_msg_ack_ack},
+};
+/* *INDENT-ON* */
+
+/*
+ * Class/id to table-position lookup, filled on first use.  Zero means
+ * unknown, otherwise the entry is at ubx_msgtab[index - 1].
+ */
+#define UBX_INDEXED_CLASSES	(UBX_CLASS_TIM + 1)
+static unsigned char ubx_msgindex[UBX_INDEXED_CLASSES][256];
+
+static void ubx_msgindex_init(void)
+{
+    static bool initialized = false;
+    int i;
+
+    if (initialized)
+	return;
+    assert(NITEMS(ubx_msgtab) < UBX_MSGSTATS);
+    for (i = 0; i < NITEMS(ubx_msgtab); i++) {
+	unsigned int cls = (unsigned int)ubx_msgtab[i].msgid >> 8;
+	unsigned int id = (unsigned int)ubx_msgtab[i].msgid & 0xff;
+
+	assert(cls < UBX_INDEXED_CLASSES);
+	ubx_msgindex[cls][id] = (unsigned char)(i + 1);
     }
-    return;
+    initialized = true;
 }
 
 gps_mask_t ubx_parse(struct gps_device_t * session, unsigned char *buf,
 		     size_t len)
 {
     size_t data_len;
-    unsigned short msgid;
+    unsigned int cls, idx;
+    const struct ubx_msgtab_t *mp;
+    struct ubx_msgstat_t *sp;
     gps_mask_t mask = 0;
+#ifdef TIMING_ENABLE
+    timestamp_t start;
+#endif /* TIMING_ENABLE */
 
     /* the packet at least contains a head long enough for an empty message */
     if (len < UBX_PREFIX_LEN)
 	return 0;
 
     session->cycle_end_reliable = true;
+    ubx_msgindex_init();
 
     /* extract message id and length */
-    msgid = (buf[2] << 8) | buf[3];
+    cls = (unsigned int)buf[UBX_CLASS_OFFSET];
     data_len = (size_t) getles16(buf, 4);
-    switch (msgid) {
-    case UBX_NAV_POSECEF:
-	gpsd_log(&session->context->errout, LOG_DATA, "UBX_NAV_POSECEF\n");
-	break;
-    case UBX_NAV_POSLLH:
-	gpsd_log(&session->context->errout, LOG_DATA, "UBX_NAV_POSLLH\n");
-	mask = ubx_msg_nav_posllh(session, &buf[UBX_PREFIX_LEN], data_len);
-	break;
-    case UBX_NAV_STATUS:
-	gpsd_log(&session->context->errout, LOG_DATA, "UBX_NAV_STATUS\n");
-	break;
-    case UBX_NAV_DOP:
-	gpsd_log(&session->context->errout, LOG_PROG, "UBX_NAV_DOP\n");
-	mask = ubx_msg_nav_dop(session, &buf[UBX_PREFIX_LEN], data_len);
-	break;
-    case UBX_NAV_SOL:
-        /* UBX-NAV-SOL deprecated, use UBX-NAV-PVT instead */
-	gpsd_log(&session->context->errout, LOG_PROG, "UBX_NAV_SOL\n");
-	mask =
-	    ubx_msg_nav_sol(session, &buf[UBX_PREFIX_LEN],
-			    data_len) | (CLEAR_IS | REPORT_IS);
-	break;
-    case UBX_NAV_PVT:
-	gpsd_log(&session->context->errout, LOG_PROG, "UBX_NAV_PVT\n");
-	mask = ubx_msg_nav_pvt(session, &buf[UBX_PREFIX_LEN], data_len);
-        break;
-    case UBX_NAV_POSUTM:
-	gpsd_log(&session->context->errout, LOG_DATA, "UBX_NAV_POSUTM\n");
-	break;
-    case UBX_NAV_VELECEF:
-	gpsd_log(&session->context->errout, LOG_DATA, "UBX_NAV_VELECEF\n");
-	break;
-    case UBX_NAV_VELNED:
-	gpsd_log(&session->context->errout, LOG_DATA, "UBX_NAV_VELNED\n");
-	break;
-    case UBX_NAV_TIMEGPS:
-	gpsd_log(&session->context->errout, LOG_PROG, "UBX_NAV_TIMEGPS\n");
-	mask = ubx_msg_nav_timegps(session, &buf[UBX_PREFIX_LEN], data_len);
-	break;
-    case UBX_NAV_TIMEUTC:
-	gpsd_log(&session->context->errout, LOG_DATA, "UBX_NAV_TIMEUTC\n");
-	break;
-    case UBX_NAV_CLOCK:
-	gpsd_log(&session->context->errout, LOG_DATA, "UBX_NAV_CLOCK\n");
-	break;
-    case UBX_NAV_SVINFO:
-	gpsd_log(&session->context->errout, LOG_PROG, "UBX_NAV_SVINFO\n");
-	mask = ubx_msg_nav_svinfo(session, &buf[UBX_PREFIX_LEN], data_len);
-
-	/* this is a hack to move some initialization until after we
-	 * get some u-blox message so we know the GPS is alive */
-	if ('\0' == session->subtype[0]) {
-	    /* one time only */
-	    (void)strlcpy(session->subtype, "Unknown", 8);
-	    /* request SW and HW Versions */
-	    (void)ubx_write(session, UBX_CLASS_MON, 0x04, NULL, 0);
-	}
-
-	break;
-    case UBX_NAV_DGPS:
-	gpsd_log(&session->context->errout, LOG_DATA, "UBX_NAV_DGPS\n");
-	break;
-    case UBX_NAV_SBAS:
-	gpsd_log(&session->context->errout, LOG_DATA, "UBX_NAV_SBAS\n");
-	ubx_msg_sbas(session, &buf[6]);
-	break;
-    case UBX_NAV_EKFSTATUS:
-	gpsd_log(&session->context->errout, LOG_DATA, "UBX_NAV_EKFSTATUS\n");
-	break;
-
-    case UBX_RXM_RAW:
-	gpsd_log(&session->context->errout, LOG_DATA, "UBX_RXM_RAW\n");
-	break;
-    case UBX_RXM_SFRB:
-	mask = ubx_msg_sfrb(session, &buf[UBX_PREFIX_LEN]);
-	break;
-    case UBX_RXM_SVSI:
-	gpsd_log(&session->context->errout, LOG_PROG, "UBX_RXM_SVSI\n");
-	break;
-    case UBX_RXM_ALM:
-	gpsd_log(&session->context->errout, LOG_DATA, "UBX_RXM_ALM\n");
-	break;
-    case UBX_RXM_EPH:
-	gpsd_log(&session->context->errout, LOG_DATA, "UBX_RXM_EPH\n");
-	break;
-    case UBX_RXM_POSREQ:
-	gpsd_log(&session->context->errout, LOG_DATA, "UBX_RXM_POSREQ\n");
-	break;
+    idx = 0;
+    if (cls < UBX_INDEXED_CLASSES)
+	idx = ubx_msgindex[cls][buf[UBX_TYPE_OFFSET]];
+    if (idx == 0) {
+	sp = &session->driver->ubx.msgstats[NITEMS(ubx_msgtab)];
+	sp->received++;
+	sp->bytes += data_len;
+	gpsd_log(&session->context->errout, LOG_WARN,
+		 "UBX: unknown packet id 0x%02x%02x (length %zd)\n",
+		 buf[UBX_CLASS_OFFSET], buf[UBX_TYPE_OFFSET], len);
+	return ONLINE_SET;
+    }
 
-    case UBX_MON_SCHED:
-	gpsd_log(&session->context->errout, LOG_DATA, "UBX_MON_SCHED\n");
-	break;
-    case UBX_MON_IO:
-	gpsd_log(&session->context->errout, LOG_DATA, "UBX_MON_IO\n");
-	break;
-    case UBX_MON_IPC:
-	gpsd_log(&session->context->errout, LOG_DATA, "UBX_MON_IPC\n");
-	break;
-    case UBX_MON_VER:
-	gpsd_log(&session->context->errout, LOG_DATA, "UBX_MON_VER\n");
-	ubx_msg_mon_ver(session, buf, data_len);
-	break;
-    case UBX_MON_EXCEPT:
-	gpsd_log(&session->context->errout, LOG_DATA, "UBX_MON_EXCEPT\n");
-	break;
-    case UBX_MON_MSGPP:
-	gpsd_log(&session->context->errout, LOG_DATA, "UBX_MON_MSGPP\n");
-	break;
-    case UBX_MON_RXBUF:
-	gpsd_log(&session->context->errout, LOG_DATA, "UBX_MON_RXBUF\n");
-	break;
-    case UBX_MON_TXBUF:
-	gpsd_log(&session->context->errout, LOG_DATA, "UBX_MON_TXBUF\n");
-	break;
-    case UBX_MON_HW:
-	gpsd_log(&session->context->errout, LOG_DATA, "UBX_MON_HW\n");
-	break;
-    case UBX_MON_USB:
-	gpsd_log(&session->context->errout, LOG_DATA, "UBX_MON_USB\n");
-	break;
+    mp = &ubx_msgtab[idx - 1];
+    sp = &session->driver->ubx.msgstats[idx - 1];
+    sp->received++;
+    sp->bytes += data_len;
+    gpsd_log(&session->context->errout, mp->loglevel, "%s\n", mp->name);
 
-    case UBX_INF_DEBUG:
-	/* FALLTHROUGH */
-    case UBX_INF_TEST:
-	/* FALLTHROUGH */
-    case UBX_INF_NOTICE:
-	/* FALLTHROUGH */
-    case UBX_INF_WARNING:
-	/* FALLTHROUGH */
-    case UBX_INF_ERROR:
-	ubx_msg_inf(session, buf, data_len);
-	break;
+    if (data_len < mp->minlen || data_len > mp->maxlen) {
+	sp->errors++;
+	gpsd_log(&session->context->errout, LOG_PROG,
+		 "%s: unexpected payload length %zd\n", mp->name, data_len);
+	return ONLINE_SET;
+    }
+    if (mp->decoder == NULL)
+	return ONLINE_SET;
+
+#ifdef TIMING_ENABLE
+    start = timestamp();
+#endif /* TIMING_ENABLE */
+    mask = mp->decoder(session, &buf[UBX_PREFIX_LEN], data_len);
+#ifdef TIMING_ENABLE
+    sp->elapsed += timestamp() - start;
+#endif /* TIMING_ENABLE */
+    GPSD_TRACE(LOG_DATA, "UBX: msgid 0x%04lx length %ld mask 0x%lx\n",
+	       mp->msgid, data_len, mask, 0);
+    return mask | ONLINE_SET;
+}
 
-    case UBX_CFG_PRT:
-	session->driver.ubx.port_id = (unsigned char)buf[UBX_MESSAGE_DATA_OFFSET + 0];
-	gpsd_log(&session->context->errout, LOG_INF, "UBX_CFG_PRT: port %d\n",
-		 session->driver.ubx.port_id);
-	break;
+void ubx_msgstats_dump(const struct gps_device_t *session,
+		       char *buf, size_t buflen)
+/* report per-message statistics, one line for each message type seen */
+{
+    int i;
 
-    case UBX_TIM_TP:
-	gpsd_log(&session->context->errout, LOG_DATA, "UBX_TIM_TP\n");
-	break;
-    case UBX_TIM_TM:
-	gpsd_log(&session->context->errout, LOG_DATA, "UBX_TIM_TM\n");
-	break;
-    case UBX_TIM_TM2:
-	gpsd_log(&session->context->errout, LOG_DATA, "UBX_TIM_TM2\n");
-	break;
-    case UBX_TIM_SVIN:
-	gpsd_log(&session->context->errout, LOG_DATA, "UBX_TIM_SVIN\n");
-	break;
+    buf[0] = '\0';
+    if (session->device_type == NULL
+	|| session->device_type->packet_type != UBX_PACKET)
+	return;
 
-    case UBX_ACK_NAK:
-	gpsd_log(&session->context->errout, LOG_WARN,
-		 "UBX_ACK_NAK, class: %02x, id: %02x\n",
-		 buf[UBX_CLASS_OFFSET],
-		 buf[UBX_TYPE_OFFSET]);
-	break;
-    case UBX_ACK_ACK:
-	gpsd_log(&session->context->errout, LOG_DATA,
-		 "UBX_ACK_ACK, class: %02x, id: %02x\n",
-		 buf[UBX_CLASS_OFFSET],
-		 buf[UBX_TYPE_OFFSET]);
-	break;
+    for (i = 0; i <= NITEMS(ubx_msgtab); i++) {
+	const struct ubx_msgstat_t *sp = &session->driver->ubx.msgstats[i];
+	const char *name = "UBX_UNKNOWN";
+	unsigned int msgid = 0;
 
-    default:
-	gpsd_log(&session->context->errout, LOG_WARN,
-		 "UBX: unknown packet id 0x%04hx (length %zd)\n",
-		 msgid, len);
+	if (sp->received == 0)
+	    continue;
+	if (i < NITEMS(ubx_msgtab)) {
+	    name = ubx_msgtab[i].name;
+	    msgid = (unsigned int)ubx_msgtab[i].msgid;
+	}
+	str_appendf(buf, buflen,
+		    "%s %s %02x/%02x received=%lu bytes=%lu errors=%lu usec=%.0f\n",
+		    session->gpsdata.dev.path, name,
+		    msgid >> 8, msgid & 0xff,
+		    sp->received, sp->bytes, sp->errors,
+		    sp->elapsed * 1e6);
     }
-    return mask | ONLINE_SET;
 }
 
-
 static gps_mask_t parse_input(struct gps_device_t *session)
 {
     if (session->lexer.type == UBX_PACKET) {
@@ -705,6 +752,24 @@ static void ubx_init_query(struct gps_device_t *session)
     (void)ubx_write(session, UBX_CLASS_MON, 0x04, NULL, 0);
 }
 
+#ifdef RECONFIGURE_ENABLE
+static void ubx_msg_rate(struct gps_device_t *session, unsigned int msgid,
+			 unsigned char rate)
+/* set how often the receiver emits a message, in navigation cycles */
+{
+    unsigned char msg[3];
+
+    msg[0] = (unsigned char)(msgid >> 8);	/* class */
+    msg[1] = (unsigned char)(msgid & 0xff);	/* msg id */
+    msg[2] = rate;
+    (void)ubx_write(session, UBX_CLASS_CFG, 0x01, msg, 3);	/* CFG-MSG */
+}
+
+/* NAV-SVINFO and NAV-SBAS only feed sky views; skip them if nobody looks */
+#define UBX_SKY_RATE(session) \
+	(((session)->pruned & SATELLITE_SET) != 0 ? 0x00 : 0x0a)
+#endif /* RECONFIGURE_ENABLE */
+
 static void ubx_event_hook(struct gps_device_t *session, event_t event)
 {
     if (session->context->readonly)
@@ -743,6 +808,17 @@ static void ubx_event_hook(struct gps_device_t *session, event_t event)
 
 	/* Reverting all in one fast and reliable reset */
 	(void)ubx_write(session, 0x06, 0x04, msg, 4);	/* CFG-RST */
+#ifdef RECONFIGURE_ENABLE
+    } else if (event == event_subscription) {
+	/* only in binary mode; NMEA output is configured separately */
+	if (session->lexer.type == UBX_PACKET) {
+	    gpsd_log(&session->context->errout, LOG_PROG,
+		     "UBX: %s sky view messages\n",
+		     UBX_SKY_RATE(session) == 0 ? "disabling" : "enabling");
+	    ubx_msg_rate(session, UBX_NAV_SVINFO, UBX_SKY_RATE(session));
+	    ubx_msg_rate(session, UBX_NAV_SBAS, UBX_SKY_RATE(session));
+	}
+#endif /* RECONFIGURE_ENABLE */
     }
 }
 
@@ -761,8 +837,8 @@ static void ubx_cfg_prt(struct gps_device_t *session,
      * When this is called from gpsd, the initial probe for UBX should
      * have picked up the device's port number from the CFG_PRT response.
      */
-    if (session->driver.ubx.port_id != 0)
-	buf[0] = session->driver.ubx.port_id;
+    if (session->driver->ubx.port_id != 0)
+	buf[0] = session->driver->ubx.port_id;
     /*
      * This default can be hit if we haven't sent a CFG_PRT query yet,
      * which can happen in gpsmon because it doesn't autoprobe.
@@ -955,14 +1031,8 @@ static void ubx_cfg_prt(struct gps_device_t *session,
 	msg[1] = 0x20;		/* msg id  = UBX_NAV_TIMEGPS */
 	msg[2] = 0x01;		/* rate */
 	(void)ubx_write(session, 0x06u, 0x01, msg, 3);
-	msg[0] = 0x01;		/* class */
-	msg[1] = 0x30;		/* msg id  = NAV-SVINFO */
-	msg[2] = 0x0a;		/* rate */
-	(void)ubx_write(session, 0x06u, 0x01, msg, 3);
-	msg[0] = 0x01;		/* class */
-	msg[1] = 0x32;		/* msg id  = NAV-SBAS */
-	msg[2] = 0x0a;		/* rate */
-	(void)ubx_write(session, 0x06u, 0x01, msg, 3);
+	ubx_msg_rate(session, UBX_NAV_SVINFO, UBX_SKY_RATE(session));
+	ubx_msg_rate(session, UBX_NAV_SBAS, UBX_SKY_RATE(session));
 
 
 #ifdef __UNUSED__
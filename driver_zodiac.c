@@ -108,11 +108,11 @@ static void send_rtcm(struct gps_device_t *session,
     unsigned short data[34];
     int n = 1 + (int)(rtcmbytes / 2 + rtcmbytes % 2);
 
-    if (session->driver.zodiac.sn++ > 32767)
-	session->driver.zodiac.sn = 0;
+    if (session->driver->zodiac.sn++ > 32767)
+	session->driver->zodiac.sn = 0;
 
     memset(data, 0, sizeof(data));
-    data[0] = session->driver.zodiac.sn;	/* sequence number */
+    data[0] = session->driver->zodiac.sn;	/* sequence number */
     memcpy(&data[1], rtcmbuf, rtcmbytes);
     data[n] = zodiac_checksum(data, n);
 
@@ -222,8 +222,8 @@ static gps_mask_t handle1002(struct gps_device_t *session)
     session->gpsdata.satellites_used = 0;
     for (i = 0; i < ZODIAC_CHANNELS; i++) {
 	int status, prn;
-	session->driver.zodiac.Zv[i] = status = (int)getzword(15 + (3 * i));
-	session->driver.zodiac.Zs[i] = prn = (int)getzword(16 + (3 * i));
+	session->driver->zodiac.Zv[i] = status = (int)getzword(15 + (3 * i));
+	session->driver->zodiac.Zs[i] = prn = (int)getzword(16 + (3 * i));
 
 	if (status & 1)
 	    session->gpsdata.satellites_used++;
@@ -346,7 +346,7 @@ static gps_mask_t zodiac_analyze(struct gps_device_t *session)
      * gpsd_packetdump() function from being called even when the debug
      * level does not actually require it.
      */
-    if (session->context->errout.debug >= LOG_RAW)
+    if (gpsd_log_enabled(&session->context->errout, LOG_RAW))
 	gpsd_log(&session->context->errout, LOG_RAW,
 		 "Raw Zodiac packet type %d length %zd: %s\n",
 		 id, session->lexer.outbuflen, gpsd_prettydump(session));
@@ -406,8 +406,8 @@ static bool zodiac_speed_switch(struct gps_device_t *session,
 {
     unsigned short data[15];
 
-    if (session->driver.zodiac.sn++ > 32767)
-	session->driver.zodiac.sn = 0;
+    if (session->driver->zodiac.sn++ > 32767)
+	session->driver->zodiac.sn = 0;
 
     switch (parity) {
     case 'E':
@@ -427,7 +427,7 @@ static bool zodiac_speed_switch(struct gps_device_t *session,
 
     memset(data, 0, sizeof(data));
     /* data is the part of the message starting at word 6 */
-    data[0] = session->driver.zodiac.sn;	/* sequence number */
+    data[0] = session->driver->zodiac.sn;	/* sequence number */
     data[1] = 1;		/* port 1 data valid */
     data[2] = (unsigned short)parity;	/* port 1 character width (8 bits) */
     data[3] = (unsigned short)(stopbits - 1);	/* port 1 stop bits (1 stopbit) */
@@ -9,6 +9,7 @@
 #include <stdarg.h>
 #include <assert.h>
 #include <ctype.h>
+#include <limits.h>
 #include <unistd.h>
 
 #include "gpsd.h"
@@ -20,6 +21,99 @@ ssize_t generic_get(struct gps_device_t *session)
     return packet_get(session->gpsdata.gps_fd, &session->lexer);
 }
 
+#ifdef NMEA0183_ENABLE
+/*
+ * Driver trigger strings, compiled on first use into a trie whose top
+ * level is a jump table on the first character of the sentence.
+ * Matching a sentence takes one step per character it shares with
+ * some trigger, however many drivers are compiled in; the common
+ * $GP and $GN sentences fall off after two.
+ */
+#define TRIGGER_NODES	256
+
+static struct trigger_node_t {
+    char ch;
+    short child, sibling;	/* node indices, -1 for none */
+    short driver;		/* gpsd_drivers index of a trigger ending here */
+} trigger_node[TRIGGER_NODES];
+static short trigger_root[UCHAR_MAX + 1];
+static int trigger_nodes = -1;	/* -1 until compiled, 0 if it didn't fit */
+
+static void trigger_compile(void)
+{
+    const struct gps_type_t **dp;
+    int i;
+
+    for (i = 0; i <= UCHAR_MAX; i++)
+	trigger_root[i] = -1;
+    trigger_nodes = 0;
+    for (dp = gpsd_drivers; *dp; dp++) {
+	const char *cp = (*dp)->trigger;
+	short *link, n = -1;
+
+	if (cp == NULL || *cp == '\0')
+	    continue;
+	for (link = &trigger_root[(unsigned char)*cp]; *cp != '\0'; cp++) {
+	    for (n = *link; n != -1; n = trigger_node[n].sibling)
+		if (trigger_node[n].ch == *cp)
+		    break;
+	    if (n == -1) {
+		if (trigger_nodes == TRIGGER_NODES) {
+		    /* fall back on trying every driver */
+		    trigger_nodes = 0;
+		    return;
+		}
+		n = (short)trigger_nodes++;
+		trigger_node[n].ch = *cp;
+		trigger_node[n].child = trigger_node[n].driver = -1;
+		trigger_node[n].sibling = *link;
+		*link = n;
+	    }
+	    link = &trigger_node[n].child;
+	}
+	/* of two identical triggers the later driver would have won anyway */
+	trigger_node[n].driver = (short)(dp - gpsd_drivers);
+    }
+}
+
+static int trigger_match(const char *sentence, short *found, int max)
+/*
+ * Collect the gpsd_drivers indices of the triggers sentence starts
+ * with, in table order; returns how many.
+ */
+{
+    const char *cp;
+    short n;
+    int count = 0, i;
+
+    if (trigger_nodes == -1)
+	trigger_compile();
+    if (trigger_nodes == 0) {
+	const struct gps_type_t **dp;
+
+	for (dp = gpsd_drivers; *dp && count < max; dp++)
+	    if ((*dp)->trigger != NULL
+		&& str_starts_with(sentence, (*dp)->trigger))
+		found[count++] = (short)(dp - gpsd_drivers);
+	return count;
+    }
+    for (cp = sentence, n = trigger_root[(unsigned char)*cp];
+	 n != -1 && *cp != '\0'; cp++, n = trigger_node[n].child) {
+	while (n != -1 && trigger_node[n].ch != *cp)
+	    n = trigger_node[n].sibling;
+	if (n == -1)
+	    break;
+	if (trigger_node[n].driver != -1 && count < max) {
+	    /* shorter triggers come first; keep table order */
+	    for (i = count++; i > 0 && found[i - 1] > trigger_node[n].driver; i--)
+		found[i] = found[i - 1];
+	    found[i] = trigger_node[n].driver;
+	}
+    }
+    return count;
+}
+#endif /* NMEA0183_ENABLE */
+
 gps_mask_t generic_parse_input(struct gps_device_t *session)
 {
     if (session->lexer.type == BAD_PACKET)
@@ -32,6 +126,8 @@ gps_mask_t generic_parse_input(struct gps_device_t *session)
 	const struct gps_type_t **dp;
 	gps_mask_t st = 0;
 	char *sentence = (char *)session->lexer.outbuffer;
+	short found[4];
+	int nfound, i;
 
 	if (sentence[strlen(sentence)-1] != '\n')
 	    gpsd_log(&session->context->errout, LOG_IO,
@@ -44,20 +140,25 @@ gps_mask_t generic_parse_input(struct gps_device_t *session)
 	    gpsd_log(&session->context->errout, LOG_WARN,
 		     "unknown sentence: \"%s\"\n",	sentence);
 	}
-	for (dp = gpsd_drivers; *dp; dp++) {
-	    char *trigger = (*dp)->trigger;
-
-	    if (trigger!=NULL && str_starts_with(sentence, trigger)) {
-		gpsd_log(&session->context->errout, LOG_PROG,
-			 "found trigger string %s.\n", trigger);
-		if (*dp != session->device_type) {
-		    (void)gpsd_switch_driver(session, (*dp)->type_name);
-		    if (session->device_type != NULL
-			&& session->device_type->event_hook != NULL)
-			session->device_type->event_hook(session,
-							 event_triggermatch);
-		    st |= DEVICEID_SET;
-		}
+	/*
+	 * Once a sticky driver has been recognized by its trigger there
+	 * is nothing left to autodetect.
+	 */
+	if (STICKY(session->device_type)
+	    && session->device_type->trigger != NULL)
+	    return st;
+	nfound = trigger_match(sentence, found, (int)NITEMS(found));
+	for (i = 0; i < nfound; i++) {
+	    dp = &gpsd_drivers[found[i]];
+	    gpsd_log(&session->context->errout, LOG_PROG,
+		     "found trigger string %s.\n", (*dp)->trigger);
+	    if (*dp != session->device_type) {
+		(void)gpsd_switch_driver(session, (*dp)->type_name);
+		if (session->device_type != NULL
+		    && session->device_type->event_hook != NULL)
+		    session->device_type->event_hook(session,
+						     event_triggermatch);
+		st |= DEVICEID_SET;
 	    }
 	}
 	return st;
@@ -70,6 +171,256 @@ gps_mask_t generic_parse_input(struct gps_device_t *session)
     }
 }
 
+/*
+ * Incremental skyview maintenance, for drivers that get a complete sky
+ * view every epoch.  Rather than zeroing gpsdata.skyview and rebuilding
+ * it, call gpsd_skyview_begin(), then gpsd_skyview_merge() for each
+ * satellite reported, then gpsd_skyview_end().  Entries are updated in
+ * place and flagged in session->sky.changed when their contents differ.
+ * Satellites stay in the order they were first seen: new ones are
+ * appended, and when one drops out the entries behind it move up (and
+ * count as changed).  Unlike a rebuild, this is not necessarily the
+ * receiver's channel order.
+ */
+
+static int skyview_find(const struct gps_device_t *session, short prn)
+/* return the skyview index of a PRN, or -1 if it is not in view */
+{
+    const struct gps_data_t *sp = &session->gpsdata;
+    int i;
+
+    if (prn > 0 && prn < SKY_PRN_MAX) {
+	i = (int)session->sky.slot[prn] - 1;
+	/* the map can go stale if someone else zeroed the skyview */
+	if (i >= 0 && i < sp->satellites_visible && sp->skyview[i].PRN == prn)
+	    return i;
+	return -1;
+    }
+    for (i = 0; i < sp->satellites_visible; i++)
+	if (sp->skyview[i].PRN == prn)
+	    return i;
+    return -1;
+}
+
+static void skyview_map(struct gps_device_t *session, int i)
+/* record the slot of skyview entry i in the PRN map */
+{
+    short prn = session->gpsdata.skyview[i].PRN;
+
+    if (prn > 0 && prn < SKY_PRN_MAX)
+	session->sky.slot[prn] = (unsigned char)(i + 1);
+}
+
+void gpsd_skyview_begin(struct gps_device_t *session)
+/* start merging a new sky view */
+{
+    (void)memset(session->sky.seen, '\0', sizeof(session->sky.seen));
+    (void)memset(session->sky.changed, '\0', sizeof(session->sky.changed));
+    session->sky.nchanged = 0;
+}
+
+bool gpsd_skyview_merge(struct gps_device_t *session,
+			const struct satellite_t *sat)
+/* update or add one satellite; false if the skyview is full */
+{
+    struct gps_data_t *sp = &session->gpsdata;
+    struct satellite_t *tp;
+    int i = skyview_find(session, sat->PRN);
+
+    if (i < 0) {
+	if (sp->satellites_visible >= MAXCHANNELS)
+	    return false;
+	i = sp->satellites_visible++;
+	sp->skyview[i].PRN = 0;		/* guarantee a mismatch below */
+    }
+    tp = &sp->skyview[i];
+    session->sky.seen[i] = true;
+    if (tp->PRN != sat->PRN || tp->elevation != sat->elevation
+	|| tp->azimuth != sat->azimuth || tp->ss != sat->ss
+	|| tp->used != sat->used) {
+	*tp = *sat;
+	skyview_map(session, i);
+	if (!session->sky.changed[i]) {
+	    session->sky.changed[i] = true;
+	    session->sky.nchanged++;
+	}
+    }
+    return true;
+}
+
+int gpsd_skyview_end(struct gps_device_t *session)
+/* drop satellites not seen this epoch; return count of changed entries */
+{
+    struct gps_data_t *sp = &session->gpsdata;
+    int i, n;
+
+    /* close the gaps in order, so the survivors keep their sequence */
+    for (i = n = 0; i < sp->satellites_visible; i++) {
+	if (!session->sky.seen[i]) {
+	    if (sp->skyview[i].PRN > 0 && sp->skyview[i].PRN < SKY_PRN_MAX)
+		session->sky.slot[sp->skyview[i].PRN] = 0;
+	    continue;
+	}
+	if (n != i) {
+	    sp->skyview[n] = sp->skyview[i];
+	    session->sky.seen[n] = true;
+	    session->sky.changed[n] = true;
+	    skyview_map(session, n);
+	}
+	n++;
+    }
+    for (i = n; i < sp->satellites_visible; i++) {
+	(void)memset(&sp->skyview[i], '\0', sizeof(sp->skyview[i]));
+	session->sky.seen[i] = false;
+	session->sky.changed[i] = false;
+    }
+    sp->satellites_visible = n;
+    for (i = session->sky.nchanged = 0; i < n; i++)
+	if (session->sky.changed[i])
+	    session->sky.nchanged++;
+    return session->sky.nchanged;
+}
+
+/*
+ * Struct-of-arrays skyview.  The occupancy and used bitmaps let callers
+ * count and walk satellites without touching the arrays at all; the
+ * stale bitmap marks the entries whose JSON has to be formatted again
+ * (see json_sky_format()).
+ */
+
+static void skyview_soa_set(struct skyview_soa_t *soa, int i,
+			    const struct satellite_t *sat)
+/* copy one skyview entry into the mirror and mark it stale */
+{
+    uint64_t bit = (uint64_t)1 << (i % 64);
+
+    soa->PRN[i] = sat->PRN;
+    soa->elevation[i] = sat->elevation;
+    soa->azimuth[i] = sat->azimuth;
+    soa->ss[i] = sat->ss;
+    soa->occupied[i / 64] &= ~bit;
+    soa->used[i / 64] &= ~bit;
+    if (sat->PRN != 0) {
+	soa->occupied[i / 64] |= bit;
+	if (sat->used)
+	    soa->used[i / 64] |= bit;
+    }
+    soa->stale[i / 64] |= bit;
+}
+
+static bool skyview_soa_same(const struct skyview_soa_t *soa, int i,
+			     const struct satellite_t *sat)
+/* does mirror entry i already hold this satellite? */
+{
+    bool used = (soa->used[i / 64] >> (i % 64)) & 1;
+
+    return soa->PRN[i] == sat->PRN && soa->elevation[i] == sat->elevation
+	&& soa->azimuth[i] == sat->azimuth && soa->ss[i] == sat->ss
+	&& used == (sat->PRN != 0 && sat->used);
+}
+
+static int skyview_count(const struct gps_data_t *sp)
+/* satellites_visible, clamped to the array */
+{
+    int n = sp->satellites_visible;
+
+    if (n < 0)
+	return 0;
+    return n > MAXCHANNELS ? MAXCHANNELS : n;
+}
+
+void gpsd_skyview_soa(struct skyview_soa_t *soa, const struct gps_data_t *sp)
+/* rebuild the struct-of-arrays copy of a skyview */
+{
+    int i;
+
+    soa->nsats = skyview_count(sp);
+    (void)memset(soa->occupied, '\0', sizeof(soa->occupied));
+    (void)memset(soa->used, '\0', sizeof(soa->used));
+    (void)memset(soa->stale, '\0', sizeof(soa->stale));
+    for (i = 0; i < soa->nsats; i++)
+	skyview_soa_set(soa, i, &sp->skyview[i]);
+}
+
+void gpsd_skyview_update(struct gps_device_t *session)
+/*
+ * Bring session->skysoa up to date with gpsdata.skyview, copying (and
+ * marking stale) only the entries that differ from the mirror.  The
+ * comparison is cheap next to formatting, and unlike the merge flags it
+ * also catches drivers that rebuild the skyview from scratch.  Calling
+ * this again with nothing new marks nothing stale.
+ */
+{
+    struct skyview_soa_t *soa = &session->skysoa;
+    const struct gps_data_t *sp = &session->gpsdata;
+    int i, n;
+
+    n = skyview_count(sp);
+    /* entries that fell off the end */
+    for (i = n; i < soa->nsats; i++) {
+	uint64_t bit = (uint64_t)1 << (i % 64);
+
+	soa->occupied[i / 64] &= ~bit;
+	soa->used[i / 64] &= ~bit;
+	soa->stale[i / 64] &= ~bit;
+    }
+    for (i = 0; i < n; i++)
+	if (i >= soa->nsats || !skyview_soa_same(soa, i, &sp->skyview[i]))
+	    skyview_soa_set(soa, i, &sp->skyview[i]);
+    soa->nsats = n;
+}
+
+void gpsd_skyview_reset(struct gps_device_t *session)
+/* forget merge state and mirror, as for a new device */
+{
+    char (*json)[SKY_JSON_MAX] = session->skysoa.json;
+
+    (void)memset(&session->sky, '\0', sizeof(session->sky));
+    (void)memset(&session->skysoa, '\0', sizeof(session->skysoa));
+    /* keep the JSON cache, if any; every entry is stale now anyway */
+    session->skysoa.json = json;
+}
+
+bool gpsd_device_storage(struct gps_device_t *session)
+/* attach zeroed driver-private storage and send buffer; false if out of memory */
+{
+    /* one block per device, kept across reuse of the slot */
+    struct device_storage_t {
+	union gps_driver_t driver;
+	char msgbuf[GPS_MSGBUF_MAX];
+    } *store = (struct device_storage_t *)session->driver;
+
+    if (store == NULL) {
+	store = (struct device_storage_t *)calloc(1, sizeof(*store));
+	if (store == NULL)
+	    return false;
+    } else
+	(void)memset(store, '\0', sizeof(*store));
+    session->driver = &store->driver;
+    session->msgbuf = store->msgbuf;
+    session->msgbuflen = 0;
+    return true;
+}
+
+int gpsd_sky_next(const uint64_t *words, int i)
+/* index of the first satellite at or after i in a bitmap, or -1 */
+{
+    for (; i < SKY_WORDS * 64; i++) {
+	uint64_t w = words[i / 64] >> (i % 64);
+
+	if (w == 0) {
+	    i |= 63;		/* nothing more in this word */
+	    continue;
+	}
+	while ((w & 1) == 0) {
+	    w >>= 1;
+	    i++;
+	}
+	return i < MAXCHANNELS ? i : -1;
+    }
+    return -1;
+}
+
 /**************************************************************************
  *
  * Generic driver -- make no assumptions about the device type
@@ -926,13 +1277,13 @@ static gps_mask_t rtcm104v2_analyze(struct gps_device_t *session)
 {
     rtcm2_unpack(&session->gpsdata.rtcm2, (char *)session->lexer.isgps.buf);
     /* extra guard prevents expensive hexdump calls */
-    if (session->context->errout.debug >= LOG_RAW)
+    if (gpsd_log_enabled(&session->context->errout, LOG_RAW))
 	gpsd_log(&session->context->errout, LOG_RAW,
 		 "RTCM 2.x packet type 0x%02x length %d words from %zd bytes: %s\n",
 		 session->gpsdata.rtcm2.type,
 		 session->gpsdata.rtcm2.length + 2,
 		 session->lexer.isgps.buflen,
-		 gpsd_hexdump(session->msgbuf, sizeof(session->msgbuf),
+		 gpsd_hexdump(session->msgbuf, GPS_MSGBUF_MAX,
 				 (char *)session->lexer.isgps.buf,
 				 (session->gpsdata.rtcm2.length +
 				  2) * sizeof(isgps30bits_t)));
@@ -1242,8 +1593,8 @@ static bool aivdm_decode(const char *buf, size_t buflen,
 	if (!str_starts_with((const char *)field[0], "!AIVDO"))
 	    gpsd_log(&session->context->errout, LOG_INF,
 		     "invalid empty AIS channel. Assuming 'A'\n");
-	ais_context = &session->driver.aivdm.context[0];
-	session->driver.aivdm.ais_channel ='A';
+	ais_context = &session->driver->aivdm.context[0];
+	session->driver->aivdm.ais_channel ='A';
 	break;
     case '1':
 	if (strcmp((char *)field[4], (char *)"12") == 0) {
@@ -1252,13 +1603,13 @@ static bool aivdm_decode(const char *buf, size_t buflen,
 	    return false;
 	}
     case 'A':
-	ais_context = &session->driver.aivdm.context[0];
-	session->driver.aivdm.ais_channel ='A';
+	ais_context = &session->driver->aivdm.context[0];
+	session->driver->aivdm.ais_channel ='A';
 	break;
     case '2':
     case 'B':
-	ais_context = &session->driver.aivdm.context[1];
-	session->driver.aivdm.ais_channel ='B';
+	ais_context = &session->driver->aivdm.context[1];
+	session->driver->aivdm.ais_channel ='B';
 	break;
     case 'C':
         gpsd_log(&session->context->errout, LOG_INF,
@@ -1332,7 +1683,7 @@ static bool aivdm_decode(const char *buf, size_t buflen,
 	    gpsd_log(&session->context->errout, LOG_INF,
 		     "AIVDM payload is %zd bits, %zd chars: %s\n",
 		     ais_context->bitlen, clen,
-		     gpsd_hexdump(session->msgbuf, sizeof(session->msgbuf),
+		     gpsd_hexdump(session->msgbuf, GPS_MSGBUF_MAX,
 				     (char *)ais_context->bits, clen));
 	}
 
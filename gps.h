@@ -2081,6 +2081,9 @@ extern double earth_distance_and_bearings(double, double, double, double,
 					  double *,
 					  double *);
 extern double wgs84_separation(double, double);
+extern void wgs84_separation_batch(const double *, const double *,
+				   double *, size_t);
+extern bool wgs84_geoid_load(const char *);
 
 /* some multipliers for interpreting GPS output */
 #define METERS_TO_FEET	3.2808399	/* Meters to U.S./British feet */
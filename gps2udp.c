@@ -12,6 +12,9 @@
  *
  */
 
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE	/* for sendmmsg() */
+#endif /* _GNU_SOURCE */
 #include <time.h>
 #include "gpsd_config.h"
 
@@ -19,6 +22,7 @@
 #include <stdlib.h>
 #include <stdbool.h>
 #include <errno.h>
+#include <ctype.h>
 #include <string.h>
 #include <strings.h>
 #include <fcntl.h>
@@ -30,11 +34,13 @@
 #include <sys/select.h>
 #include <unistd.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
 #include <netinet/in.h>
 #include <arpa/inet.h>
 #include <netdb.h>
 
 #include "gpsd.h"
+#include "aisdedup.h"
 #include "gpsdclient.h"
 #include "revision.h"
 #include "strfuncs.h"
@@ -46,15 +52,72 @@ static struct gps_data_t gpsdata;
 
 /* UDP socket variables */
 #define MAX_UDP_DEST 5
-static struct sockaddr_in remote[MAX_UDP_DEST];
-static int sock[MAX_UDP_DEST];
+#define MAX_UDP_BATCH	64
+/*
+ * sendmmsg() is not in POSIX.  glibc has it from 2.14; the other C
+ * libraries that have it also define MSG_WAITFORONE.  A build can
+ * still decide for itself by defining HAVE_SENDMMSG.
+ */
+#ifndef HAVE_SENDMMSG
+#if defined(__GLIBC__)
+#if __GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 14)
+#define HAVE_SENDMMSG 1
+#endif
+#elif defined(MSG_WAITFORONE)
+#define HAVE_SENDMMSG 1
+#endif
+#endif /* HAVE_SENDMMSG */
+#ifndef HAVE_SENDMMSG
+/* just enough of it for the sendmsg() loop in flush_udp() */
+struct mmsghdr {
+    struct msghdr msg_hdr;
+    unsigned int msg_len;
+};
+#endif /* HAVE_SENDMMSG */
+
+/* when a destination last got a position report from a vessel */
+struct mmsi_seen_t {
+    unsigned int key;		/* MMSI + 1, 0 if the slot is free */
+    time_t last;
+};
+
+struct udp_dest_t {
+    char *name;			/* host:port, for messages */
+    int sock;			/* connected, non-blocking */
+    /* filter */
+    bool aisonly;		/* AIS sentences only */
+    bool mmsi_filter;		/* AIS from mmsi_lo..mmsi_hi only */
+    unsigned int mmsi_lo, mmsi_hi;
+    int rate;			/* min seconds between positions per MMSI */
+    struct mmsi_seen_t *seen;	/* hash table for rate, open addressing */
+    unsigned int seen_size, seen_used;
+    signed char fragment[11];	/* verdict on multipart AIS, by seqid */
+    /* sentences queued for it, pointing into outiov */
+    struct mmsghdr out[MAX_UDP_BATCH];
+    int queued;
+    unsigned long dropped;
+};
+static struct udp_dest_t dest[MAX_UDP_DEST];
 static int udpchannel;
 
+/*
+ * Sentences waiting to go out.  They point straight into the input
+ * buffer, so they must be flushed before it is refilled.
+ */
+static struct iovec outiov[MAX_UDP_BATCH][2];
+static int outcount;		/* sentences queued */
+
+/* gpsd input, framed into sentences in place */
+static char inbuf[65536];
+static size_t inlen;		/* bytes in inbuf */
+static size_t inpos;		/* start of the first unconsumed byte */
+
 /* gpsclient source */
 static struct fixsource_t gpsd_source;
 static unsigned int flags;
 static int debug = 0;
 static bool aisonly = false;
+static struct ais_dedup_t dedup;	/* table is NULL unless -r */
 
 static char* time2string(void)
 /* return local time hh:mm:ss */
@@ -75,98 +138,377 @@ static char* time2string(void)
    return (buffer);
 }
 
-static int send_udp (char *nmeastring, size_t ind)
+static unsigned char AISto6bit(unsigned char c)
+/* 6 bits decoding of AIS payload */
 {
-    char message [255];
-    char *buffer;
-    int  channel;
-
-    /* if string length is unknow make a copy and compute it */
-    if (ind == 0) {
-	/* compute message size and add 0x0a 0x0d */
-	for (ind=0; nmeastring [ind] != '\0'; ind ++) {
-	    if (ind >= sizeof(message) - 3) {
-		fprintf(stderr, "gps2udp: too big [%s] \n", nmeastring);
-		return -1;
+    unsigned char cp = c;
+
+    if(c < (unsigned char)0x30)
+        return (unsigned char)-1;
+    if(c > (unsigned char)0x77)
+        return (unsigned char)-1;
+    if(((unsigned char)0x57 < c) && (c < (unsigned char)0x60))
+        return (unsigned char)-1;
+
+    cp += (unsigned char)0x28;
+
+    if(cp > (unsigned char)0x80)
+        cp += (unsigned char)0x20;
+    else
+        cp += (unsigned char)0x28;
+    return (unsigned char)(cp & (unsigned char)0x3f);
+}
+
+static unsigned int AISGetInt(unsigned char *bitbytes, unsigned int sp, unsigned int len)
+/* get MMSI from AIS bit string */
+{
+    unsigned int acc = 0;
+    unsigned int s0p = sp-1;                          // to zero base
+    unsigned int i;
+
+    for(i=0 ; i<len ; i++)
+    {
+	unsigned int cp, cx, c0;
+        acc  = acc << 1;
+        cp = (s0p + i) / 6;
+        cx = (unsigned int)bitbytes[cp];      // what if cp >= byte_length?
+        c0 = (cx >> (5 - ((s0p + i) % 6))) & 1;
+        acc |= c0;
+    }
+
+    return acc;
+}
+
+/* what the filters need to know about an AIS sentence */
+struct ais_header_t {
+    int count;			/* fragments in the message */
+    int number;			/* which one this is */
+    int seqid;			/* sequential message id, -1 if none */
+    char channel;		/* radio channel, '\0' if none */
+    const char *payload;	/* armored data, up to the next comma */
+    int fill;			/* pad bits at the end of it */
+    bool decoded;		/* type and mmsi are valid (first fragment) */
+    unsigned int type;
+    unsigned int mmsi;
+};
+
+static bool ais_header(const char *sentence, struct ais_header_t *ais)
+/* pick apart the envelope of an !xxVDM/!xxVDO sentence */
+{
+    const char *field[6];
+    unsigned char bitstrings[7];
+    int i;
+
+    if (sentence[0] != '!' || strncmp(sentence + 3, "VD", 2) != 0)
+	return false;
+    field[0] = sentence;
+    for (i = 1; i < 6; i++) {
+	field[i] = strchr(field[i - 1], ',');
+	if (field[i] == NULL)
+	    return false;
+	field[i]++;
+    }
+    ais->count = atoi(field[1]);
+    ais->number = atoi(field[2]);
+    ais->seqid = isdigit((unsigned char)field[3][0]) ? field[3][0] - '0' : -1;
+    ais->channel = (field[4][0] == ',') ? '\0' : field[4][0];
+    ais->payload = field[5];
+    ais->fill = 0;
+    if (strchr(field[5], ',') != NULL
+	&& isdigit((unsigned char)strchr(field[5], ',')[1]))
+	ais->fill = strchr(field[5], ',')[1] - '0';
+    ais->decoded = false;
+    if (ais->number == 1) {
+	/* type and MMSI sit in the first 38 bits */
+	for (i = 0; i < (int)sizeof(bitstrings); i++) {
+	    bitstrings[i] = AISto6bit((unsigned char)field[5][i]);
+	    if (bitstrings[i] == (unsigned char)-1)
+		return true;
+	}
+	ais->type = AISGetInt(bitstrings, 1, 6);
+	ais->mmsi = AISGetInt(bitstrings, 9, 30);
+	ais->decoded = true;
+    }
+    return true;
+}
+
+static bool rate_ok(struct udp_dest_t *d, unsigned int mmsi, time_t now)
+/* has this destination gone without a position from mmsi long enough? */
+{
+    unsigned int key = mmsi + 1, mask, i;
+
+    if (d->seen_used * 2 >= d->seen_size) {
+	/* rehash, forgetting vessels whose interval has run out anyway */
+	struct mmsi_seen_t *old = d->seen, *new;
+	unsigned int oldsize = d->seen_size, live = 0, size = 64;
+
+	for (i = 0; i < oldsize; i++)
+	    if (old[i].key != 0 && now - old[i].last < d->rate)
+		live++;
+	while (size < live * 4)
+	    size *= 2;
+	new = (struct mmsi_seen_t *)calloc(size, sizeof(struct mmsi_seen_t));
+	if (new == NULL)
+	    return true;	/* better to send too much than nothing */
+	d->seen = new;
+	d->seen_size = size;
+	d->seen_used = 0;
+	for (i = 0; i < oldsize; i++)
+	    if (old[i].key != 0 && now - old[i].last < d->rate) {
+		unsigned int j = (old[i].key * 2654435761u) & (size - 1);
+
+		while (new[j].key != 0)
+		    j = (j + 1) & (size - 1);
+		new[j] = old[i];
+		d->seen_used++;
 	    }
-	    message[ind] = nmeastring[ind];
+	free(old);
+    }
+
+    mask = d->seen_size - 1;
+    for (i = (key * 2654435761u) & mask; d->seen[i].key != 0; i = (i + 1) & mask)
+	if (d->seen[i].key == key) {
+	    if (now - d->seen[i].last < d->rate)
+		return false;
+	    d->seen[i].last = now;
+	    return true;
 	}
-	buffer = message;
-    } else {
-	/* use directly nmeastring but change terminition */
-	buffer = nmeastring;
-	ind = ind-1;
+    d->seen[i].key = key;
+    d->seen[i].last = now;
+    d->seen_used++;
+    return true;
+}
+
+static bool dest_wants(struct udp_dest_t *d,
+		       const struct ais_header_t *ais, time_t now)
+/* apply one destination's filter to a sentence */
+{
+    int slot;
+    bool pass;
+
+    if (ais == NULL)
+	return !d->aisonly && !d->mmsi_filter;
+
+    slot = (ais->seqid < 0) ? 10 : ais->seqid;
+    if (ais->number > 1)
+	/* later fragments go wherever the first one went */
+	return d->fragment[slot] != 0;
+
+    if (!ais->decoded)
+	pass = !d->mmsi_filter;
+    else {
+	pass = !d->mmsi_filter ||
+	    (ais->mmsi >= d->mmsi_lo && ais->mmsi <= d->mmsi_hi);
+	/* position reports: class A, class B, extended class B, long range */
+	if (pass && d->rate > 0 && ais->count == 1 &&
+	    ((ais->type >= 1 && ais->type <= 3) || ais->type == 18 ||
+	     ais->type == 19 || ais->type == 27))
+	    pass = rate_ok(d, ais->mmsi, now);
     }
-    /* Add termination to NMEA feed for AISHUB */
-    buffer[ind] = '\r'; ind++;
-    buffer[ind] = '\n'; ind++;
-    buffer[ind] = '\0';
+    if (ais->count > 1)
+	d->fragment[slot] = (signed char)pass;
+    return pass;
+}
+
+static void flush_udp(void)
+/*
+ * Send everything queued, a batch per destination.  The sockets do not
+ * block; whatever a destination cannot take right now is dropped for it
+ * alone.
+ */
+{
+    int channel;
+
+    for (channel = 0; channel < udpchannel; channel++) {
+	struct udp_dest_t *d = &dest[channel];
+	int sent = 0;
+
+	while (sent < d->queued) {
+#ifdef HAVE_SENDMMSG
+	    int status = sendmmsg(d->sock, d->out + sent,
+				  (unsigned int)(d->queued - sent), 0);
+#else
+	    int status = (sendmsg(d->sock, &d->out[sent].msg_hdr, 0) < 0) ? -1 : 1;
+#endif /* HAVE_SENDMMSG */
+
+	    if (status > 0)
+		sent += status;
+	    else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+		d->dropped += (unsigned long)(d->queued - sent);
+		if (debug > 0)
+		    (void)fprintf(stdout,
+				  "gps2udp [%s] %s busy, %lu sentences dropped\n",
+				  time2string(), d->name, d->dropped);
+		break;
+	    } else {
+		/* e.g. ECONNREFUSED from an earlier ICMP; skip just this one */
+		if (errno != ECONNREFUSED)
+		    (void)fprintf(stderr, "gps2udp: failed to send to %s: %s\n",
+				  d->name, strerror(errno));
+		d->dropped++;
+		sent++;
+	    }
+	}
+	d->queued = 0;
+    }
+    outcount = 0;
+}
 
-    if ((flags & WATCH_JSON)==0 && buffer[0] == '{') {
+static bool ais_duplicate(const struct ais_header_t *ais)
+/*
+ * Was this AIS sentence already heard through another receiver?  Each
+ * fragment's fingerprint is chained onto the one before it, so the
+ * fragments of one message are judged as a whole and a bland trailing
+ * fragment is never taken for another ship's.
+ */
+{
+    /* running fingerprint by channel (A, B) and sequential id */
+    static uint64_t chain[2][11];
+    unsigned char bits[128];
+    size_t bitlen;
+    uint64_t *link, fingerprint;
+    char channel = ais->channel;
+
+    link = &chain[channel == 'B' || channel == '2'][(ais->seqid < 0) ? 10 : ais->seqid];
+    if (ais->number <= 1)
+	*link = AIS_DEDUP_SEED;
+    bitlen = ais_dedup_unarmor(ais->payload, ais->fill, bits, sizeof(bits));
+    fingerprint = ais_dedup_hash(*link, bits, bitlen, channel);
+    if (ais->count > 1)
+	*link = fingerprint;
+    return ais_dedup_seen(&dedup, fingerprint, (timestamp_t)time(NULL));
+}
+
+static void send_udp(char *nmeastring, size_t len,
+		     const struct ais_header_t *ais)
+/* queue a sentence for every destination that wants it */
+{
+    static char crlf[] = "\r\n";
+    struct iovec *iov;
+    time_t now;
+    int channel;
+
+    if ((flags & WATCH_JSON)==0 && nmeastring[0] == '{') {
 	/* do not send JSON when not configured to do so */
-	return 0;
+	return;
     }
 
-    /* send message on udp channel */
+    /* Add termination to NMEA feed for AISHUB */
+    iov = outiov[outcount];
+    iov[0].iov_base = nmeastring;
+    iov[0].iov_len = len;
+    iov[1].iov_base = crlf;
+    iov[1].iov_len = 2;
+
+    now = time(NULL);
     for (channel=0; channel < udpchannel; channel ++) {
-	ssize_t status = sendto(sock[channel],
-				buffer,
-				ind,
-				0,
-				(const struct sockaddr *)&remote[channel],
-				(int)sizeof(remote));
-	if (status < (ssize_t)ind) {
-	    (void)fprintf(stderr, "gps2udp: failed to send [%s] \n", nmeastring);
+	struct udp_dest_t *d = &dest[channel];
+	struct msghdr *msg;
+
+	if (!dest_wants(d, ais, now))
+	    continue;
+	msg = &d->out[d->queued++].msg_hdr;
+	memset(msg, '\0', sizeof(*msg));
+	msg->msg_iov = iov;
+	msg->msg_iovlen = 2;
+    }
+    if (++outcount == MAX_UDP_BATCH)
+	flush_udp();
+}
+
+static int parse_filter(struct udp_dest_t *d, char *filter)
+/* grok ais,mmsi=LO[-HI],rate=SECONDS */
+{
+    char *term;
+
+    while ((term = strsep(&filter, ",")) != NULL) {
+	char *endptr;
+
+	if (term[0] == '\0')
+	    continue;
+	else if (strcmp(term, "ais") == 0)
+	    d->aisonly = true;
+	else if (str_starts_with(term, "mmsi=")) {
+	    d->mmsi_filter = true;
+	    d->mmsi_lo = d->mmsi_hi = (unsigned int)strtoul(term + 5, &endptr, 10);
+	    if (*endptr == '-')
+		d->mmsi_hi = (unsigned int)strtoul(endptr + 1, &endptr, 10);
+	    if (*endptr != '\0' || endptr == term + 5 || d->mmsi_hi < d->mmsi_lo)
+		return -1;
+	} else if (str_starts_with(term, "rate=")) {
+	    d->rate = (int)strtol(term + 5, &endptr, 10);
+	    if (*endptr != '\0' || endptr == term + 5 || d->rate < 0)
+		return -1;
+	} else
 	    return -1;
-	}
     }
     return 0;
 }
 
-
 static int open_udp(char **hostport)
-/* Open and bind udp socket to host */
+/* Open and connect a udp socket to each host */
 {
    int channel;
 
    for (channel=0; channel <udpchannel; channel ++)
    {
+       struct udp_dest_t *d = &dest[channel];
        char *hostname = NULL;
        char *portname = NULL;
        char *endptr = NULL;
        int  portnum;
        struct hostent *hp;
+       struct sockaddr_in remote;
 
        /* parse argument */
+       d->name = strdup(hostport[channel]);
        hostname = strsep(&hostport[channel], ":");
        portname = strsep(&hostport[channel], ":");
        if ((hostname == NULL) || (portname == NULL)) {
-	   (void)fprintf(stderr, "gps2udp: syntax is [-u hostname:port]\n");
+	   (void)fprintf(stderr, "gps2udp: syntax is [-u hostname:port[:filter]]\n");
 	   return (-1);
        }
 
        errno = 0;
        portnum = (int)strtol(portname, &endptr, 10);
        if (1 > portnum || 65535 < portnum || '\0' != *endptr || 0 != errno) {
-	   (void)fprintf(stderr, "gps2udp: syntax is [-u hostname:port] [%s] is not a valid port number\n",portname);
+	   (void)fprintf(stderr, "gps2udp: syntax is [-u hostname:port[:filter]] [%s] is not a valid port number\n",portname);
 	   return (-1);
        }
 
-       sock[channel]= socket(AF_INET, SOCK_DGRAM, 0);
-       if (sock[channel] < 0) {
-	   fprintf(stderr, "gps2udp: error creating UDP socket\n");
+       /* whatever follows the port is the filter */
+       if (hostport[channel] != NULL
+	   && parse_filter(d, hostport[channel]) != 0) {
+	   (void)fprintf(stderr, "gps2udp: filter is [ais][,mmsi=first[-last]][,rate=seconds] [%s] is not valid\n", d->name);
 	   return (-1);
        }
 
-       remote[channel].sin_family = (sa_family_t)AF_INET;
+       memset(&remote, '\0', sizeof(remote));
+       remote.sin_family = (sa_family_t)AF_INET;
        hp = gethostbyname(hostname);
        if (hp==NULL) {
-	   fprintf(stderr, "gps2udp: syntax is [-u hostname:port] [%s] is not a valid hostname\n",hostname);
+	   fprintf(stderr, "gps2udp: syntax is [-u hostname:port[:filter]] [%s] is not a valid hostname\n",hostname);
 	   return (-1);
        }
 
-       bcopy((char *)hp->h_addr, (char *)&remote[channel].sin_addr, hp->h_length);
-       remote[channel].sin_port = htons((in_port_t)portnum);
+       bcopy((char *)hp->h_addr, (char *)&remote.sin_addr, hp->h_length);
+       remote.sin_port = htons((in_port_t)portnum);
+
+       /*
+	* One socket each, so that a destination that is slow or
+	* unreachable only ever costs itself sentences.
+	*/
+       d->sock = socket(AF_INET, SOCK_DGRAM, 0);
+       if (d->sock < 0) {
+	   fprintf(stderr, "gps2udp: error creating UDP socket\n");
+	   return (-1);
+       }
+       if (fcntl(d->sock, F_SETFL, fcntl(d->sock, F_GETFL) | O_NONBLOCK) < 0
+	   || connect(d->sock, (struct sockaddr *)&remote, sizeof(remote)) < 0) {
+	   fprintf(stderr, "gps2udp: cannot set up UDP socket for %s: %s\n",
+		   d->name, strerror(errno));
+	   return (-1);
+       }
    }
 return (0);
 }
@@ -176,10 +518,12 @@ static void usage(void)
     (void)fprintf(stderr,
 		  "Usage: gps2udp [OPTIONS] [server[:port[:device]]]\n\n"
 		  "-h Show this help.\n"
-                  "-u Send UDP NMEA/JASON feed to host:port [multiple -u host:port accepted\n"
+                  "-u Send UDP NMEA/JASON feed to host:port[:filter] [multiple -u host:port accepted\n"
+		  "   filter: ais,mmsi=first[-last],rate=seconds\n"
 		  "-n Feed NMEA.\n"
 		  "-j Feed Jason.\n"
 		  "-a Select !AISDM message only.\n"
+		  "-r [seconds] drop AIS messages repeated within seconds.\n"
 		  "-c [count] exit after count packets.\n"
 		  "-b Run in background as a daemon.\n"
 		  "-d [0-2] 1 display sent packets, 2 ignored packets.\n"
@@ -221,13 +565,15 @@ static void connect2gpsd(bool restart)
 
 }
 
-static ssize_t read_gpsd(char *message, size_t len)
-/* get data from gpsd */
+static ssize_t read_gpsd(char **message)
+/*
+ * Get a sentence from gpsd, reading as much as is available at a time.
+ * *message is pointed at the sentence, NUL-terminated in place in the
+ * input buffer, and its length returned.
+ */
 {
     struct timeval tv;
     fd_set fds,master;
-    int ind;
-    char c;
     int retry=0;
 
     // prepare select structure */
@@ -235,51 +581,73 @@ static ssize_t read_gpsd(char *message, size_t len)
     FD_SET(gpsdata.gps_fd, &master);
 
     /* loop until we get some data or an error */
-    for (ind = 0; ind < (int)len;) {
-	int result;
+    for (;;) {
+	char *start = inbuf + inpos, *end = inbuf + inlen, *eol;
+	ssize_t result;
+
+	/* hand out the next complete sentence, if we have one */
+	for (eol = start; eol < end && *eol != '\n' && *eol != '\r'; eol++)
+	    continue;
+	if (eol < end) {
+	    size_t ind = (size_t)(eol - start);
+
+	    *eol = '\0';
+	    inpos += ind + 1;
+	    if (ind == 0)
+		continue;	/* the \n of a \r\n */
+	    if (retry > 0) {
+		if (debug ==1)
+		    (void)fprintf (stdout,"\r");
+		if (debug > 1)
+		    (void)fprintf(stdout,
+				  " [%s] No Data for: %ds\n",
+				  time2string(), retry*10);
+	    }
+	    if (aisonly && start[0] != '!') {
+		if (debug >1)
+		    (void)fprintf(stdout,
+				  ".... [%s %d] %s\n", time2string(),
+				  (int)ind, start);
+		return(0);
+	    }
+	    *message = start;
+	    return ((ssize_t)ind);
+	}
+
+	/* queued sentences point into inbuf; send them before it moves */
+	if (outcount > 0)
+	    flush_udp();
+
+	/* keep the partial sentence, at the front, and read more */
+	if (inpos > 0) {
+	    inlen -= inpos;
+	    memmove(inbuf, inbuf + inpos, inlen);
+	    inpos = 0;
+	}
+	if (inlen == sizeof(inbuf)) {
+	    inbuf[sizeof(inbuf) - 1] = '\0';
+	    (void)fprintf (stderr,"\n gps2udp: message too big [%s]\n", inbuf);
+	    inlen = 0;
+	    return(-1);
+	}
+
         /* prepare for a blocking read with a 10s timeout */
         tv.tv_sec =  10;
         tv.tv_usec = 0;
         fds = master;
-        result = select(gpsdata.gps_fd+1, &fds, NULL, NULL, &tv);
-
-        switch (result)
+        switch (select(gpsdata.gps_fd+1, &fds, NULL, NULL, &tv))
 	{
         case 1: /* we have data waiting, let's process them */
-	    result = (int)read(gpsdata.gps_fd, &c, 1);
+	    result = read(gpsdata.gps_fd, inbuf + inlen, sizeof(inbuf) - inlen);
 
 	    /* If we lost gpsd connection reset it */
-	    if (result != 1) {
+	    if (result <= 0) {
 		connect2gpsd (true);
-	    }
-
-	    if ((c == '\n') || (c == '\r')){
-		message[ind]='\0';
-
-		if (ind > 0) {
-		    if (retry > 0) {
-			if (debug ==1)
-			    (void)fprintf (stdout,"\r");
-			if (debug > 1)
-			    (void)fprintf(stdout,
-					  " [%s] No Data for: %ds\n",
-					  time2string(), retry*10);
-		    }
-
-		    if (aisonly && message[0] != '!') {
-			if (debug >1)
-			    (void)fprintf(stdout,
-					  ".... [%s %d] %s\n", time2string(),
-					  ind, message);
-			return(0);
-		    }
-		}
-
-		return ((ssize_t)ind+1);
-	    } else {
-		message[ind]= c;
-		ind++;
-	    }
+		FD_ZERO(&master);
+		FD_SET(gpsdata.gps_fd, &master);
+		inlen = 0;
+	    } else
+		inlen += (size_t)result;
 	    break;
 
         case 0:	/* no data fail in timeout */
@@ -288,6 +656,9 @@ static ssize_t read_gpsd(char *message, size_t len)
 	    if (retry > MAX_GPSD_RETRY)
 	    {
 		connect2gpsd(true);
+		FD_ZERO(&master);
+		FD_SET(gpsdata.gps_fd, &master);
+		inlen = 0;
 		retry = 0;
 	    }
 	    if (debug > 0)
@@ -296,53 +667,12 @@ static ssize_t read_gpsd(char *message, size_t len)
 
         default:	/* we lost connection with gpsd */
 	    connect2gpsd(true);
+	    FD_ZERO(&master);
+	    FD_SET(gpsdata.gps_fd, &master);
+	    inlen = 0;
 	    break;
         }
     }
-    message[ind] = '\0';
-    (void)fprintf (stderr,"\n gps2udp: message too big [%s]\n", message);
-    return(-1);
-}
-
-static unsigned char AISto6bit(unsigned char c)
-/* 6 bits decoding of AIS payload */
-{
-    unsigned char cp = c;
-
-    if(c < (unsigned char)0x30)
-        return (unsigned char)-1;
-    if(c > (unsigned char)0x77)
-        return (unsigned char)-1;
-    if(((unsigned char)0x57 < c) && (c < (unsigned char)0x60))
-        return (unsigned char)-1;
-
-    cp += (unsigned char)0x28;
-
-    if(cp > (unsigned char)0x80)
-        cp += (unsigned char)0x20;
-    else
-        cp += (unsigned char)0x28;
-    return (unsigned char)(cp & (unsigned char)0x3f);
-}
-
-static unsigned int AISGetInt(unsigned char *bitbytes, unsigned int sp, unsigned int len)
-/* get MMSI from AIS bit string */
-{
-    unsigned int acc = 0;
-    unsigned int s0p = sp-1;                          // to zero base
-    unsigned int i;
-
-    for(i=0 ; i<len ; i++)
-    {
-	unsigned int cp, cx, c0;
-        acc  = acc << 1;
-        cp = (s0p + i) / 6;
-        cx = (unsigned int)bitbytes[cp];      // what if cp >= byte_length?
-        c0 = (cx >> (5 - ((s0p + i) % 6))) & 1;
-        acc |= c0;
-    }
-
-    return acc;
 }
 
 int main(int argc, char **argv)
@@ -353,7 +683,7 @@ int main(int argc, char **argv)
     char *udphostport[MAX_UDP_DEST];
 
     flags = WATCH_ENABLE;
-    while ((option = getopt(argc, argv, "?habnjvc:l:u:d:")) != -1)
+    while ((option = getopt(argc, argv, "?habnjvc:l:r:u:d:")) != -1)
     {
 	switch (option) {
 	case 'd':
@@ -379,6 +709,12 @@ int main(int argc, char **argv)
 	case 'c':
 	    count = atol(optarg);
 	    break;
+	case 'r':
+	    if (atof(optarg) <= 0 || !ais_dedup_init(&dedup, atof(optarg))) {
+		usage();
+		exit(1);
+	    }
+	    break;
 	case 'b':
 	    daemonize = true;
 	    break;
@@ -432,61 +768,52 @@ int main(int argc, char **argv)
     /* infinite loop to get data from gpsd and push them to aggregators */
     for (;;)
     {
-	char buffer[512];
+	char *buffer;
 	ssize_t  len;
 
-	len = read_gpsd(buffer, sizeof(buffer));
+	len = read_gpsd(&buffer);
 
 	/* ignore empty message */
-	if (len > 3)
+	if (len > 2)
 	{
+	    struct ais_header_t ais;
+	    bool isais = ais_header(buffer, &ais);
+
+	    // drop copies other receivers already delivered
+	    if (isais && dedup.table != NULL && ais_duplicate(&ais)) {
+		if (debug > 1)
+		    (void)fprintf(stdout,
+				  ".... [%s] duplicate %s\n", time2string(),
+				  buffer);
+		continue;
+	    }
+
 	    if (debug > 0)
 	    {
 		(void)fprintf (stdout,"---> [%s] -- %s",time2string(),buffer);
 
 		// Try to extract MMSI from AIS payload
-		if (str_starts_with(buffer, "!AIVDM"))
-		{
-#define MAX_INFO 6
-		    int  i,j;
-		    unsigned char packet[512];
-		    unsigned char *adrpkt = packet;
-		    unsigned char *info[MAX_INFO];
-		    unsigned int  mmsi;
-		    unsigned char bitstrings [255];
-
-		    // strtok break original string
-		    (void)strlcpy((char *)packet, buffer, sizeof(packet));
-		    for (j=0; j<MAX_INFO; j++) {
-			info[j] = (unsigned char *)strsep((char **)&adrpkt, ",");
-		    }
-
-		    for(i=0 ; i < (int)strlen((char *)info[5]); i++)  {
-			if (i > (int) sizeof (bitstrings)) break;
-			bitstrings[i] = AISto6bit(info[5][i]);
-		    }
-
-		    mmsi = AISGetInt(bitstrings, 9, 30);
-		    (void)fprintf(stdout," MMSI=%9u", mmsi);
-
-		}
+		if (isais && ais.decoded)
+		    (void)fprintf(stdout," MMSI=%9u", ais.mmsi);
 		fprintf(stdout,"\n");
 	    }
 
 	    // send to all UDP destinations
 	    if (udpchannel > 0)
-		(void)send_udp(buffer, (size_t)len);
+		send_udp(buffer, (size_t)len, isais ? &ais : NULL);
 
 	    // if we count messages check it now
 	    if (count >= 0) {
 		if (count-- == 0) {
 		    /* completed count */
+		    if (outcount > 0)
+			flush_udp();
 		    (void)fprintf(stderr,
 				  "gpsd2udp: normal exit after counted packets\n");
 		    exit (0);
 		}
 	    }  // end count
-        } // end len > 3
+        } // end len > 2
     } // end for (;;)
 
     // This is an infinite loop, should never be here
@@ -14,14 +14,16 @@
 extern "C" {
 #endif
 void json_data_report(const gps_mask_t,
-		      const struct gps_device_t *,
+		      struct gps_device_t *,
 		      const struct policy_t *,
 		      char *, size_t);
 char *json_stringify(char *, size_t, const char *);
 void json_tpv_dump(const struct gps_device_t *,
 		   const struct policy_t *, char *, size_t);
 void json_noise_dump(const struct gps_data_t *, char *, size_t);
-void json_sky_dump(const struct gps_data_t *, char *, size_t);
+bool json_sky_format(struct skyview_soa_t *);
+void json_sky_dump(const struct gps_data_t *, const struct skyview_soa_t *,
+		   char *, size_t);
 void json_att_dump(const struct gps_data_t *, char *, size_t);
 void json_subframe_dump(const struct gps_data_t *, char buf[], size_t);
 void json_device_dump(const struct gps_device_t *, char *, size_t);
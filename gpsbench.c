@@ -0,0 +1,740 @@
+/*
+ * gpsbench - load generator and end-to-end latency benchmark for gpsd
+ *
+ * Synthetic receivers speaking NMEA, UBX or AIVDM, each at its own
+ * message rate, are fed to gpsd through virtual devices while
+ * synthetic clients watch it in JSON, NMEA or raw mode.  Every message
+ * carries a sequence number the daemon passes through to all of its
+ * output forms: the fix time of NMEA and UBX messages, which advances
+ * BENCH_STEP seconds per message, or the MMSI of AIS messages.  Each
+ * client read is matched with the instant the message was written to
+ * the pty, so the latency covers the lexer, the driver, all_reports()
+ * and throttled_write() up to the client's socket read.
+ *
+ * The generator runs in its own thread on absolute deadlines; the
+ * main thread reads the clients.  Only messages sent after the warmup
+ * (during which gpsd identifies the devices) are counted.  The
+ * daemon's CPU use over the measured window comes from /proc, so it
+ * is reported on Linux only.
+ *
+ * This file is Copyright (c) 2010 by the GPSD project
+ * BSD terms apply: see the file COPYING in the distribution root for details.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <errno.h>
+#include <string.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+
+#include "gpsd.h"
+#include "bits.h"
+#include "vdev.h"
+#include "revision.h"
+#include "strfuncs.h"
+
+#define BENCH_EPOCH	1451606400	/* 2016-01-01T00:00:00Z, fix time of message 0 */
+#define BENCH_STEP	64	/* fix seconds per message; absorbs the leap-second offset */
+#define BENCH_LEAP	18	/* GPS-UTC offset written into UBX times */
+#define BENCH_MMSI	100000000	/* MMSI of AIS message 0 */
+#define SEQ_RING	(1 << 20)	/* messages in flight we can match */
+#define HIST_MAX	1000000	/* latency histogram range, us */
+#define MAX_SOURCES	64
+#define MAX_WATCHERS	256
+#define DRAIN_INTERVAL	100000000LL	/* ns between reads of gpsd's probes */
+
+enum proto {nmea, ubx, ais};
+static const char *proto_names[] = {"nmea", "ubx", "ais"};
+enum watch {json, nmeawatch, raw};
+static const char *watch_names[] = {"json", "nmea", "raw"};
+static const char *watch_commands[] = {
+    "?WATCH={\"enable\":true,\"json\":true}\n",
+    "?WATCH={\"enable\":true,\"nmea\":true}\n",
+    "?WATCH={\"enable\":true,\"raw\":1}\n",
+};
+
+struct source_t {
+    struct vdev_t dev;
+    enum proto proto;
+    double rate;		/* messages/s */
+    int64_t next;		/* ns the next message is due */
+    unsigned long sent;
+};
+
+struct watcher_t {
+    int fd;
+    enum watch mode;
+    char buf[65536];
+    size_t len;
+    long long last[MAX_SOURCES];	/* newest sequence heard per source */
+    unsigned long matched;
+    unsigned long long bytes;
+};
+
+/* when each message in flight went out, and from where */
+static struct {
+    volatile long long seq;
+    int64_t at;
+    int source;
+} sent[SEQ_RING];
+
+static struct source_t sources[MAX_SOURCES];
+static int nsources;
+static struct watcher_t *watchers;
+static int nwatchers;
+static volatile sig_atomic_t stopping = 0;
+
+/* set by main before the generator starts */
+static int64_t window_start, window_end;
+
+/* generator results */
+static unsigned long long counted;	/* messages sent in the window */
+static unsigned long stalls;
+static int64_t late_max, late_total;
+
+/* latency histogram, 1 us buckets */
+static uint32_t *hist;
+static unsigned long long hist_over, samples;
+static int64_t lat_max;
+
+static int64_t now_ns(void)
+{
+    struct timespec ts;
+
+    (void)clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static void onsig(int sig UNUSED)
+{
+    stopping = 1;
+}
+
+/* message synthesis */
+
+static size_t nmea_checksum(char *buf)
+/* append checksum and CR-LF to the sentence in buf */
+{
+    unsigned char sum = 0;
+    char *p;
+
+    for (p = buf + 1; *p != '\0'; p++)
+	sum ^= (unsigned char)*p;
+    return strlen(buf) + (size_t)sprintf(buf + strlen(buf), "*%02X\r\n", sum);
+}
+
+static size_t make_nmea(char *buf, long long seq)
+{
+    time_t t = (time_t)(BENCH_EPOCH + seq * BENCH_STEP);
+    struct tm tm;
+
+    (void)gmtime_r(&t, &tm);
+    (void)sprintf(buf,
+		  "$GPRMC,%02d%02d%02d.00,A,4807.038,N,01131.000,E,0.0,0.0,"
+		  "%02d%02d%02d,,,A",
+		  tm.tm_hour, tm.tm_min, tm.tm_sec,
+		  tm.tm_mday, tm.tm_mon + 1, tm.tm_year % 100);
+    return nmea_checksum(buf);
+}
+
+static size_t make_ubx(unsigned char *buf, long long seq)
+/* a NAV-SOL with a 3D fix */
+{
+    long long gps = BENCH_EPOCH + seq * BENCH_STEP + BENCH_LEAP - GPS_EPOCH;
+    unsigned char *p = buf + 6;
+    unsigned char ck_a = 0, ck_b = 0;
+    int i;
+
+    buf[0] = 0xb5;
+    buf[1] = 0x62;
+    buf[2] = 0x01;
+    buf[3] = 0x06;
+    putle16(buf, 4, 52);
+    memset(p, '\0', 52);
+    putle32(p, 0, (uint32_t)((gps % 604800) * 1000));	/* iTOW */
+    putle16(p, 8, (uint16_t)(gps / 604800));		/* week */
+    p[10] = 3;			/* 3D */
+    p[11] = 0x0d;		/* fix OK, week and TOW valid */
+    putle32(p, 12, (uint32_t)416400000);	/* ECEF cm, near 48N 11E */
+    putle32(p, 16, (uint32_t)80900000);
+    putle32(p, 20, (uint32_t)471500000);
+    putle32(p, 24, 500);	/* pAcc */
+    putle32(p, 40, 50);		/* sAcc */
+    putle16(p, 44, 150);	/* pDOP */
+    p[47] = 9;			/* numSV */
+    for (i = 2; i < 6 + 52; i++) {
+	ck_a += buf[i];
+	ck_b += ck_a;
+    }
+    buf[6 + 52] = ck_a;
+    buf[6 + 52 + 1] = ck_b;
+    return 6 + 52 + 2;
+}
+
+static size_t make_ais(char *buf, long long seq)
+/* a type 1 position report with nothing but an MMSI to say */
+{
+    unsigned char bits[21];
+    char payload[29];
+    unsigned long mmsi = (unsigned long)(BENCH_MMSI + seq % 800000000);
+    int i;
+
+    memset(bits, '\0', sizeof(bits));
+#define PUT(start, width, value) do { \
+	int _b; \
+	for (_b = 0; _b < (width); _b++) \
+	    if (((unsigned long)(value) >> ((width) - 1 - _b)) & 1) \
+		bits[((start) + _b) / 8] |= 0x80 >> (((start) + _b) % 8); \
+    } while (0)
+    PUT(0, 6, 1);		/* type */
+    PUT(8, 30, mmsi);
+    PUT(38, 4, 15);		/* status not defined */
+    PUT(42, 8, 0x80);		/* turn not available */
+    PUT(50, 10, 1023);		/* speed not available */
+    PUT(61, 28, 181 * 600000);	/* lon not available */
+    PUT(89, 27, 91 * 600000);	/* lat not available */
+    PUT(116, 12, 3600);		/* course not available */
+    PUT(128, 9, 511);		/* heading not available */
+    PUT(137, 6, 60);		/* second not available */
+#undef PUT
+    for (i = 0; i < 28; i++) {
+	int v = 0, b;
+
+	for (b = 0; b < 6; b++)
+	    v = (v << 1) | ((bits[(i * 6 + b) / 8] >> (7 - (i * 6 + b) % 8)) & 1);
+	payload[i] = (char)(v < 40 ? v + 48 : v + 56);
+    }
+    payload[28] = '\0';
+    (void)sprintf(buf, "!AIVDM,1,1,,A,%s,0", payload);
+    return nmea_checksum(buf);
+}
+
+static void *generate(void *arg UNUSED)
+/* write every source's messages at their deadlines until the window ends */
+{
+    unsigned char buf[128];
+    long long seq = 0;
+    int64_t next_drain = 0;
+
+    while (!stopping) {
+	struct source_t *sp = &sources[0];
+	struct timespec at;
+	int64_t now;
+	size_t len = 0;
+	int i;
+
+	for (i = 1; i < nsources; i++)
+	    if (sources[i].next < sp->next)
+		sp = &sources[i];
+	if (sp->next >= window_end)
+	    break;
+	at.tv_sec = (time_t)(sp->next / 1000000000LL);
+	at.tv_nsec = (long)(sp->next % 1000000000LL);
+	while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &at, NULL)
+	       == EINTR && !stopping)
+	    continue;
+	now = now_ns();
+	if (sp->next >= window_start) {
+	    counted++;
+	    late_total += now - sp->next;
+	    if (now - sp->next > late_max)
+		late_max = now - sp->next;
+	}
+
+	switch (sp->proto) {
+	case nmea:
+	    len = make_nmea((char *)buf, seq);
+	    break;
+	case ubx:
+	    len = make_ubx(buf, seq);
+	    break;
+	case ais:
+	    len = make_ais((char *)buf, seq);
+	    break;
+	}
+	/* messages sent in the warmup are never matched */
+	sent[seq % SEQ_RING].at = sp->next >= window_start ? now : 0;
+	sent[seq % SEQ_RING].source = (int)(sp - sources);
+	__sync_synchronize();
+	sent[seq % SEQ_RING].seq = seq;
+	if (!vdev_write(&sp->dev, buf, len, &stalls, &stopping))
+	    break;
+	seq++;
+	sp->sent++;
+	sp->next += (int64_t)(1e9 / sp->rate);
+
+	if (now >= next_drain) {
+	    for (i = 0; i < nsources; i++)
+		vdev_drain(&sources[i].dev);
+	    next_drain = now + DRAIN_INTERVAL;
+	}
+    }
+    return NULL;
+}
+
+/* client side */
+
+static long long time_seq(long long t)
+/* sequence number of a fix time, or -1 */
+{
+    long long d = t - BENCH_EPOCH + BENCH_STEP / 2;
+
+    return d < 0 ? -1 : d / BENCH_STEP;
+}
+
+static long long mmsi_seq(unsigned long mmsi)
+{
+    return mmsi < BENCH_MMSI ? -1 : (long long)(mmsi - BENCH_MMSI);
+}
+
+static long long line_seq(const char *line)
+/* the sequence number a line of gpsd output carries, or -1 */
+{
+    const char *p;
+
+    if (line[0] == '{') {
+	if (strstr(line, "\"class\":\"TPV\"") != NULL
+	    && (p = strstr(line, "\"time\":\"")) != NULL) {
+	    struct tm tm;
+
+	    memset(&tm, '\0', sizeof(tm));
+	    if (sscanf(p + 8, "%4d-%2d-%2dT%2d:%2d:%2d", &tm.tm_year,
+		       &tm.tm_mon, &tm.tm_mday, &tm.tm_hour, &tm.tm_min,
+		       &tm.tm_sec) != 6)
+		return -1;
+	    tm.tm_year -= 1900;
+	    tm.tm_mon -= 1;
+	    return time_seq((long long)mkgmtime(&tm));
+	}
+	if (strstr(line, "\"class\":\"AIS\"") != NULL
+	    && (p = strstr(line, "\"mmsi\":")) != NULL)
+	    return mmsi_seq(strtoul(p + 7, NULL, 10));
+	return -1;
+    }
+    if (line[0] == '$' && strlen(line) > 7 && strncmp(line + 3, "RMC,", 4) == 0) {
+	int hh, mm, ss, dd, mo, yy, field;
+	struct tm tm;
+
+	if (sscanf(line + 7, "%2d%2d%2d", &hh, &mm, &ss) != 3)
+	    return -1;
+	/* date is field 9 */
+	for (p = line, field = 0; *p != '\0' && field < 9; p++)
+	    if (*p == ',')
+		field++;
+	if (field < 9 || sscanf(p, "%2d%2d%2d", &dd, &mo, &yy) != 3)
+	    return -1;
+	memset(&tm, '\0', sizeof(tm));
+	tm.tm_year = yy + 100;
+	tm.tm_mon = mo - 1;
+	tm.tm_mday = dd;
+	tm.tm_hour = hh;
+	tm.tm_min = mm;
+	tm.tm_sec = ss;
+	return time_seq((long long)mkgmtime(&tm));
+    }
+    if (line[0] == '!' && strlen(line) > 7 && strncmp(line + 3, "VDM,", 4) == 0) {
+	unsigned long long acc = 0;
+	int field, i;
+
+	/* payload is field 5; its first 38 bits are type, repeat, MMSI */
+	for (p = line, field = 0; *p != '\0' && field < 5; p++)
+	    if (*p == ',')
+		field++;
+	for (i = 0; i < 7; i++) {
+	    int v = (unsigned char)p[i] - 48;
+
+	    if (p[i] == '\0' || p[i] == ',')
+		return -1;
+	    acc = (acc << 6) | (unsigned)(v >= 40 ? v - 8 : v);
+	}
+	return mmsi_seq((unsigned long)((acc >> 4) & 0x3fffffff));
+    }
+    if (str_starts_with(line, "b5620106") && strlen(line) >= 32) {
+	/* hexdumped NAV-SOL: iTOW at byte 6, week at byte 14 */
+	unsigned int b[16];
+	int i;
+
+	for (i = 0; i < 16; i++)
+	    if (sscanf(line + 2 * i, "%2x", &b[i]) != 1)
+		return -1;
+	return time_seq(GPS_EPOCH - BENCH_LEAP
+			+ (long long)(b[14] | b[15] << 8) * 604800
+			+ (long long)(b[6] | b[7] << 8 | b[8] << 16
+				      | (unsigned long)b[9] << 24) / 1000);
+    }
+    return -1;
+}
+
+static void sample(struct watcher_t *wp, const char *line, int64_t now)
+/* match a line against the message that caused it */
+{
+    long long seq = line_seq(line);
+    int64_t us;
+    int src;
+
+    if (seq < 0 || sent[seq % SEQ_RING].seq != seq)
+	return;
+    src = sent[seq % SEQ_RING].source;
+    /* pseudo-NMEA and repeated reports say the same thing twice */
+    if (seq <= wp->last[src])
+	return;
+    wp->last[src] = seq;
+    if (sent[seq % SEQ_RING].at == 0)
+	return;
+    wp->matched++;
+    samples++;
+    us = (now - sent[seq % SEQ_RING].at) / 1000;
+    if (us > lat_max)
+	lat_max = us;
+    if (us < HIST_MAX)
+	hist[us < 0 ? 0 : us]++;
+    else
+	hist_over++;
+}
+
+static void watcher_read(struct watcher_t *wp)
+{
+    ssize_t n = read(wp->fd, wp->buf + wp->len, sizeof(wp->buf) - 1 - wp->len);
+    int64_t now = now_ns();
+    char *line, *nl;
+
+    if (n <= 0)
+	return;
+    wp->bytes += (unsigned long long)n;
+    wp->len += (size_t)n;
+    wp->buf[wp->len] = '\0';
+    for (line = wp->buf; (nl = strchr(line, '\n')) != NULL; line = nl + 1) {
+	*nl = '\0';
+	sample(wp, line, now);
+    }
+    wp->len -= (size_t)(line - wp->buf);
+    memmove(wp->buf, line, wp->len);
+    if (wp->len == sizeof(wp->buf) - 1)
+	wp->len = 0;		/* overlong line, not ours */
+}
+
+static double percentile(double p)
+/* latency in us below which fraction p of the samples fall */
+{
+    unsigned long long want = (unsigned long long)(p * samples), seen = 0;
+    int us;
+
+    for (us = 0; us < HIST_MAX; us++)
+	if ((seen += hist[us]) > want)
+	    return (double)us;
+    return (double)lat_max;
+}
+
+static bool cpu_ticks(pid_t pid, unsigned long long *ticks)
+/* user plus system time of a process, in clock ticks */
+{
+    char path[64], buf[1024], *p;
+    unsigned long long utime, stime;
+    FILE *fp;
+    bool ok;
+
+    (void)snprintf(path, sizeof(path), "/proc/%d/stat", (int)pid);
+    if ((fp = fopen(path, "r")) == NULL)
+	return false;
+    ok = fgets(buf, sizeof(buf), fp) != NULL
+	&& (p = strrchr(buf, ')')) != NULL
+	&& sscanf(p + 2, "%*c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u %llu %llu",
+		  &utime, &stime) == 2;
+    (void)fclose(fp);
+    if (ok)
+	*ticks = utime + stime;
+    return ok;
+}
+
+static bool add_source(const char *arg)
+/* proto:rate[:count] */
+{
+    char name[16];
+    double rate;
+    int count = 1, p;
+
+    if (sscanf(arg, "%15[a-z]:%lf:%d", name, &rate, &count) < 2 || rate <= 0)
+	return false;
+    for (p = 0; p < (int)NITEMS(proto_names); p++)
+	if (strcmp(name, proto_names[p]) == 0)
+	    break;
+    if (p == (int)NITEMS(proto_names))
+	return false;
+    while (count-- > 0 && nsources < MAX_SOURCES) {
+	sources[nsources].proto = (enum proto)p;
+	sources[nsources].rate = rate;
+	nsources++;
+    }
+    return true;
+}
+
+static int watcher_modes[MAX_WATCHERS];
+
+static bool add_watchers(const char *arg)
+/* mode[:count] */
+{
+    char name[16];
+    int count = 1, m;
+
+    if (sscanf(arg, "%15[a-z]:%d", name, &count) < 1)
+	return false;
+    for (m = 0; m < (int)NITEMS(watch_names); m++)
+	if (strcmp(name, watch_names[m]) == 0)
+	    break;
+    if (m == (int)NITEMS(watch_names))
+	return false;
+    while (count-- > 0 && nwatchers < MAX_WATCHERS)
+	watcher_modes[nwatchers++] = m;
+    return true;
+}
+
+static void usage(void)
+{
+    (void)fputs("Usage: gpsbench [-h] [-V] [-F control-socket | -g gpsd] "
+		"[-o gpsd-options] [-P port]\n"
+		"                [-p pid] [-d proto:rate[:count]]... "
+		"[-c mode[:count]]... [-t seconds] [-w seconds]\n"
+		"  proto is nmea, ubx or ais; mode is json, nmea or raw\n",
+		stderr);
+}
+
+int main(int argc, char **argv)
+{
+    char *control_socket = NULL, *gpsd_program = NULL, *gpsd_options = "";
+    char *port = DEFAULT_GPSD_PORT;
+    char tmpsock[GPS_PATH_MAX];
+    double duration = 10, warmup = 2;
+    pid_t pid = 0;
+    bool spawned = false, have_cpu;
+    unsigned long long cpu_start = 0, cpu_end = 0;
+    int sock, ch, i;
+    int64_t start, stop;
+    pthread_t generator;
+    struct sigaction sa;
+    unsigned long long delivered = 0, bytes = 0;
+
+    while ((ch = getopt(argc, argv, "c:d:F:g:ho:p:P:t:Vw:")) != -1) {
+	switch (ch) {
+	case 'c':
+	    if (!add_watchers(optarg)) {
+		usage();
+		exit(EXIT_FAILURE);
+	    }
+	    break;
+	case 'd':
+	    if (!add_source(optarg)) {
+		usage();
+		exit(EXIT_FAILURE);
+	    }
+	    break;
+	case 'F':
+	    control_socket = optarg;
+	    break;
+	case 'g':
+	    gpsd_program = optarg;
+	    break;
+	case 'o':
+	    gpsd_options = optarg;
+	    break;
+	case 'p':
+	    pid = (pid_t)atoi(optarg);
+	    break;
+	case 'P':
+	    port = optarg;
+	    break;
+	case 't':
+	    duration = atof(optarg);
+	    break;
+	case 'V':
+	    (void)fprintf(stderr, "%s: %s (revision %s)\n",
+			  argv[0], VERSION, REVISION);
+	    exit(EXIT_SUCCESS);
+	case 'w':
+	    warmup = atof(optarg);
+	    break;
+	case 'h':
+	case '?':
+	default:
+	    usage();
+	    exit(EXIT_FAILURE);
+	}
+    }
+    if ((control_socket == NULL) == (gpsd_program == NULL) || duration <= 0) {
+	usage();
+	exit(EXIT_FAILURE);
+    }
+    if (nsources == 0)
+	(void)add_source("nmea:1");
+    if (nwatchers == 0)
+	(void)add_watchers("json");
+
+    memset(&sa, '\0', sizeof(sa));
+    sa.sa_handler = onsig;
+    (void)sigaction(SIGINT, &sa, NULL);
+    (void)sigaction(SIGTERM, &sa, NULL);
+    (void)signal(SIGPIPE, SIG_IGN);
+
+    if (gpsd_program != NULL) {
+	char command[BUFSIZ];
+
+	(void)snprintf(tmpsock, sizeof(tmpsock), "/tmp/gpsbench-%d.sock",
+		       (int)getpid());
+	control_socket = tmpsock;
+	(void)snprintf(command, sizeof(command), "exec %s -N -F %s -S %s %s",
+		       gpsd_program, control_socket, port, gpsd_options);
+	if ((pid = fork()) == -1) {
+	    (void)fprintf(stderr, "gpsbench: fork failed: %s\n", strerror(errno));
+	    exit(EXIT_FAILURE);
+	} else if (pid == 0) {
+	    (void)execl("/bin/sh", "sh", "-c", command, (char *)NULL);
+	    _exit(127);
+	}
+	spawned = true;
+	/* give it five seconds to come up */
+	for (i = 0; i < 50 && access(control_socket, F_OK) != 0; i++)
+	    (void)usleep(100000);
+    }
+    if ((sock = netlib_localsocket(control_socket, SOCK_STREAM)) < 0) {
+	(void)fprintf(stderr, "gpsbench: can't reach gpsd at %s\n",
+		      control_socket);
+	if (spawned)
+	    (void)kill(pid, SIGTERM);
+	exit(EXIT_FAILURE);
+    }
+
+    watchers = (struct watcher_t *)calloc((size_t)nwatchers, sizeof(struct watcher_t));
+    hist = (uint32_t *)calloc(HIST_MAX, sizeof(uint32_t));
+    if (watchers == NULL || hist == NULL)
+	exit(EXIT_FAILURE);
+    for (i = 0; i < SEQ_RING; i++)
+	sent[i].seq = -1;
+    for (i = 0; i < nwatchers; i++) {
+	struct watcher_t *wp = &watchers[i];
+	int s;
+
+	wp->mode = (enum watch)watcher_modes[i];
+	for (s = 0; s < MAX_SOURCES; s++)
+	    wp->last[s] = -1;
+	wp->fd = netlib_connectsock(AF_UNSPEC, "localhost", port, "tcp");
+	if (wp->fd < 0) {
+	    (void)fprintf(stderr, "gpsbench: can't connect to gpsd on port %s\n",
+			  port);
+	    exit(EXIT_FAILURE);
+	}
+	if (write(wp->fd, watch_commands[wp->mode],
+		  strlen(watch_commands[wp->mode])) == -1)
+	    exit(EXIT_FAILURE);
+	(void)fcntl(wp->fd, F_SETFL, fcntl(wp->fd, F_GETFL) | O_NONBLOCK);
+    }
+
+    for (i = 0; i < nsources; i++) {
+	struct source_t *sp = &sources[i];
+
+	if (!vdev_open(&sp->dev)) {
+	    (void)fprintf(stderr, "gpsbench: can't make a pty: %s\n",
+			  strerror(errno));
+	    exit(EXIT_FAILURE);
+	}
+	if (vdev_control(sock, '+', sp->dev.path) != 0) {
+	    (void)fprintf(stderr,
+			  "gpsbench: gpsd refused %s, going on with %d sources\n",
+			  sp->dev.path, i);
+	    vdev_close(&sp->dev);
+	    break;
+	}
+    }
+    if ((nsources = i) == 0)
+	exit(EXIT_FAILURE);
+
+    start = now_ns();
+    window_start = start + (int64_t)(warmup * 1e9);
+    window_end = window_start + (int64_t)(duration * 1e9);
+    for (i = 0; i < nsources; i++)
+	/* stagger the sources over their first period */
+	sources[i].next = start + (int64_t)(1e9 / sources[i].rate * i / nsources);
+    if (pthread_create(&generator, NULL, generate, NULL) != 0) {
+	(void)fputs("gpsbench: can't start the generator\n", stderr);
+	exit(EXIT_FAILURE);
+    }
+
+    have_cpu = false;
+    for (;;) {
+	struct pollfd pfds[MAX_WATCHERS];
+	int64_t now = now_ns();
+
+	if (!have_cpu && now >= window_start && pid != 0)
+	    have_cpu = cpu_ticks(pid, &cpu_start);
+	/* a second's grace for the last reports */
+	if (stopping || now >= window_end + 1000000000LL)
+	    break;
+	for (i = 0; i < nwatchers; i++) {
+	    pfds[i].fd = watchers[i].fd;
+	    pfds[i].events = POLLIN;
+	}
+	if (poll(pfds, (nfds_t)nwatchers, 50) <= 0)
+	    continue;
+	for (i = 0; i < nwatchers; i++)
+	    if (pfds[i].revents & POLLIN)
+		watcher_read(&watchers[i]);
+    }
+    stopping = 1;
+    (void)pthread_join(generator, NULL);
+    stop = now_ns();
+    if (have_cpu && !cpu_ticks(pid, &cpu_end))
+	have_cpu = false;
+
+    for (i = 0; i < nsources; i++) {
+	(void)vdev_control(sock, '-', sources[i].dev.path);
+	vdev_close(&sources[i].dev);
+    }
+    (void)close(sock);
+    for (i = 0; i < nwatchers; i++) {
+	delivered += watchers[i].matched;
+	bytes += watchers[i].bytes;
+	(void)close(watchers[i].fd);
+    }
+    if (spawned) {
+	(void)kill(pid, SIGTERM);
+	(void)waitpid(pid, NULL, 0);
+    }
+
+    (void)printf("gpsbench: %d sources, %d clients, %.1f s measured\n",
+		 nsources, nwatchers, duration);
+    for (i = 0; i < nsources; i++)
+	(void)printf("  %-12s %s at %g/s, %lu sent\n", sources[i].dev.path,
+		     proto_names[sources[i].proto], sources[i].rate,
+		     sources[i].sent);
+    (void)printf("sent:      %llu messages, %.1f/s; lateness mean %.1f us, max %.1f us; %lu stalls\n",
+		 counted, counted / duration,
+		 counted ? late_total / 1e3 / counted : 0.0, late_max / 1e3,
+		 stalls);
+    (void)printf("delivered: %llu of %llu reports, %.1f/s, %.0f bytes/s to clients\n",
+		 delivered, counted * (unsigned long long)nwatchers,
+		 delivered / duration, bytes / ((stop - start) / 1e9));
+    if (have_cpu && counted > 0) {
+	double secs = (double)(cpu_end - cpu_start) / sysconf(_SC_CLK_TCK);
+
+	(void)printf("gpsd cpu:  %.3f s, %.1f%% of one core, %.1f us per message\n",
+		     secs, 100 * secs / duration, secs * 1e6 / counted);
+    } else
+	(void)printf("gpsd cpu:  not measured\n");
+    if (samples > 0)
+	(void)printf("latency:   p50 %.0f us, p99 %.0f us, p999 %.0f us, max %lld us\n",
+		     percentile(0.5), percentile(0.99), percentile(0.999),
+		     (long long)lat_max);
+    else
+	(void)printf("latency:   no reports matched\n");
+    exit(EXIT_SUCCESS);
+}
+
+/* gpsbench.c ends here */
@@ -20,10 +20,12 @@ gpsclient_deg_to_str(PyObject *self UNUSED, PyObject *args)
 {
     int fmt;
     double degrees;
+    char buf[40];
 
     if (!PyArg_ParseTuple(args, "id", &fmt, &degrees))
 	return NULL;
-    return Py_BuildValue("s", deg_to_str((enum deg_str_type)fmt, degrees));
+    return Py_BuildValue("s", deg_to_str_r((enum deg_str_type)fmt, degrees,
+					   buf, sizeof(buf)));
 }
 
 static PyObject *
@@ -54,12 +56,11 @@ static PyObject *
 gpsclient_maidenhead(PyObject *self UNUSED, PyObject *args)
 {
     const double lat, lon;
-    char *gs;
+    char gs[MAIDENHEAD_LEN];
 
     if (!PyArg_ParseTuple(args, "dd", &lat, &lon))
 	return NULL;
-    gs = maidenhead(lat, lon);
-    return Py_BuildValue("s", gs);
+    return Py_BuildValue("s", maidenhead_r(lat, lon, gs, sizeof(gs)));
 }
 
 /* List of functions defined in the module */
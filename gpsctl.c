@@ -630,6 +630,10 @@ int main(int argc, char **argv)
 	    }
 
 	    gpsd_init(&session, &context, device);
+	    if (!gpsd_device_storage(&session)) {
+		gpsd_log(&context.errout, LOG_ERROR, "out of memory.\n");
+		exit(EXIT_FAILURE);
+	    }
 	    activated = gpsd_activate(&session, O_PROBEONLY);
 	    if ( 0 > activated ) {
 		if ( PLACEHOLDING_FD == activated ) {
@@ -10,6 +10,8 @@
 #include <sys/types.h>
 #include <sys/time.h>		/* for select() */
 #include <sys/select.h>
+#include <sys/ipc.h>		/* for shmget() */
+#include <sys/shm.h>
 #include <stdio.h>
 #include <time.h>
 #include <string.h>
@@ -45,6 +47,15 @@
 #include "gps_json.h"
 #include "revision.h"
 #include "strfuncs.h"
+#ifdef AIVDM_ENABLE
+#include "aisdedup.h"
+#endif /* AIVDM_ENABLE */
+#ifdef NTPSHM_ENABLE
+#include "ntpshm.h"		/* for ntp_write() */
+#endif /* NTPSHM_ENABLE */
+#ifdef SHM_EXPORT_ENABLE
+#include "shmring.h"		/* for GPSD_SHMRING_KEY */
+#endif /* SHM_EXPORT_ENABLE */
 
 #if defined(SYSTEMD_ENABLE)
 #include "sd_socket.h"
@@ -283,6 +294,11 @@ static socket_t filesock(char *filename)
  */
 static struct gps_device_t devices[MAX_DEVICES];
 
+#ifdef AIVDM_ENABLE
+/* AIS heard by more than one receiver; table is NULL unless enabled */
+static struct ais_dedup_t ais_dedup;
+#endif /* AIVDM_ENABLE */
+
 static void adjust_max_fd(int fd, bool on)
 /* track the largest fd currently in use */
 {
@@ -496,11 +512,20 @@ struct subscriber_t
     time_t active;		/* when subscriber last polled for data */
     struct policy_t policy;	/* configurable bits */
     pthread_mutex_t mutex;	/* serialize access to fd */
+    double maxrate;		/* max fix reports/sec, 0 = unlimited */
+    struct ratelimit_t {
+	timestamp_t last;	/* slot of the last fix report shipped */
+	gps_mask_t deferred;	/* report classes held back since then */
+    } rate[MAX_DEVICES];	/* per-device maxrate state */
 };
 
 #define subscribed(sub, devp)    (sub->policy.watcher && (sub->policy.devpath[0]=='\0' || strcmp(sub->policy.devpath, devp->gpsdata.dev.path)==0))
 
 static struct subscriber_t subscribers[MAX_CLIENTS];	/* indexed by client file descriptor */
+static volatile bool subscriptions_changed;	/* recompute pruned reports */
+#ifdef SHM_EXPORT_ENABLE
+static bool shm_watched;	/* a shared-memory reader is attached */
+#endif /* SHM_EXPORT_ENABLE */
 
 static void lock_subscriber(struct subscriber_t *sub)
 {
@@ -557,9 +582,13 @@ static void detach_client(struct subscriber_t *sub)
     sub->policy.scaled = false;
     sub->policy.timing = false;
     sub->policy.split24 = false;
+    sub->maxrate = 0;
     sub->policy.devpath[0] = '\0';
+    memset(sub->rate, '\0', sizeof(sub->rate));
     sub->fd = UNALLOCATED_FD;
     unlock_subscriber(sub);
+    /* the main loop tells the drivers, outside any client I/O */
+    subscriptions_changed = true;
 }
 
 static ssize_t throttled_write(struct subscriber_t *sub, char *buf,
@@ -585,14 +614,7 @@ static ssize_t throttled_write(struct subscriber_t *sub, char *buf,
 	}
     }
 
-#if defined(PPS_ENABLE)
-    gpsd_acquire_reporting_lock();
-#endif /* PPS_ENABLE */
     status = send(sub->fd, buf, len, 0);
-#if defined(PPS_ENABLE)
-    gpsd_release_reporting_lock();
-
-#endif /* PPS_ENABLE */
     if (status == (ssize_t) len)
 	return status;
     else if (status > -1) {
@@ -637,6 +659,84 @@ static void notify_watchers(struct gps_device_t *device,
 		(void)throttled_write(sub, buf, strlen(buf));
 	}
 }
+
+#ifdef SHM_EXPORT_ENABLE
+static int shm_attached(long shmkey)
+/* processes other than us attached to the segment with the given key */
+{
+    struct shmid_ds ds;
+    int shmid = shmget((key_t)shmkey, 0, 0);
+
+    if (shmid == -1 || shmctl(shmid, IPC_STAT, &ds) == -1)
+	return 0;
+    return ds.shm_nattch > 1 ? (int)ds.shm_nattch - 1 : 0;
+}
+
+static int shm_readers(void)
+/* how many readers have either export segment attached? */
+{
+    int readers = 0;
+
+    if (context.shmexport != NULL)
+	readers += shm_attached(getenv("GPSD_SHM_KEY") ?
+		    strtol(getenv("GPSD_SHM_KEY"), NULL, 0) : GPSD_SHM_KEY);
+    if (context.shmring != NULL)
+	readers += shm_attached(getenv("GPSD_SHMRING_KEY") ?
+		    strtol(getenv("GPSD_SHMRING_KEY"), NULL, 0) :
+		    GPSD_SHMRING_KEY);
+    return readers;
+}
+#endif /* SHM_EXPORT_ENABLE */
+
+static gps_mask_t pruned_reports(struct gps_device_t *device)
+/* which report classes does no consumer of this device need? */
+{
+    struct subscriber_t *sub;
+    gps_mask_t wanted = 0;
+
+#ifdef SHM_EXPORT_ENABLE
+    /* we can't know what shared-memory readers want */
+    if (shm_watched)
+	return 0;
+#endif /* SHM_EXPORT_ENABLE */
+
+    for (sub = subscribers; sub < subscribers + MAX_CLIENTS; sub++) {
+	if (sub->active == 0)
+	    continue;
+	/* a client that isn't watching may ?POLL for a sky view */
+	if (!sub->policy.watcher) {
+	    wanted |= SATELLITE_SET;
+	    continue;
+	}
+	if (!subscribed(sub, device))
+	    continue;
+	/* JSON and raw watchers get everything the device emits */
+	if (sub->policy.json || sub->policy.raw > 0)
+	    wanted |= SATELLITE_SET | SUBFRAME_SET;
+	/* NMEA watchers only see sky views, as GSV */
+	if (sub->policy.nmea)
+	    wanted |= SATELLITE_SET;
+    }
+    return (SATELLITE_SET | SUBFRAME_SET) & ~wanted;
+}
+
+static void prune_reports(struct gps_device_t *device)
+/* tell the driver if the set of report classes nobody needs has changed */
+{
+    gps_mask_t pruned = pruned_reports(device);
+
+    if (pruned == device->pruned)
+	return;
+    device->pruned = pruned;
+    if (device->device_type != NULL
+	&& device->device_type->event_hook != NULL) {
+	if (gpsd_log_enabled(&context.errout, LOG_PROG))
+	    gpsd_log(&context.errout, LOG_PROG,
+		     "%s: reports needed by no subscriber: %s\n",
+		     device->gpsdata.dev.path, gps_maskdump(pruned));
+	device->device_type->event_hook(device, event_subscription);
+    }
+}
 #endif /* SOCKET_EXPORT_ENABLE */
 
 static void deactivate_device(struct gps_device_t *device)
@@ -718,6 +818,269 @@ static bool open_device( struct gps_device_t *device)
     return true;
 }
 
+#ifdef NTP_ENABLE
+/*
+ * Receive-to-publish latency of time handed to ntpd/chrony, per device,
+ * in power-of-two microsecond buckets: bucket n counts latencies below
+ * 2^n usec, and the last one everything slower.
+ */
+#define TIMEHIST_BUCKETS	24
+
+static struct timehist_t {
+    unsigned long count;
+    timestamp_t max;
+    unsigned long bucket[TIMEHIST_BUCKETS];
+} timehist[MAX_DEVICES];
+
+static timestamp_t wakeup_time;	/* when the main loop last saw input */
+
+static void timehist_record(struct gps_device_t *device, timestamp_t latency)
+{
+    struct timehist_t *hp = &timehist[device - devices];
+    double usec = latency * 1e6;
+    int n;
+
+    for (n = 0; n < TIMEHIST_BUCKETS - 1 && usec >= (double)(1UL << n); n++)
+	continue;
+    hp->bucket[n]++;
+    hp->count++;
+    if (latency > hp->max)
+	hp->max = latency;
+}
+
+#ifdef CONTROL_SOCKET_ENABLE
+static void timehist_dump(const struct gps_device_t *device,
+			  char *buf, size_t buflen)
+/* one line per device: count, worst case, and the nonempty buckets */
+{
+    const struct timehist_t *hp = &timehist[device - devices];
+    int n;
+
+    (void)snprintf(buf, buflen, "%s count=%lu max=%.0fus",
+		   device->gpsdata.dev.path, hp->count, hp->max * 1e6);
+    for (n = 0; n < TIMEHIST_BUCKETS; n++)
+	if (hp->bucket[n] > 0) {
+	    if (n < TIMEHIST_BUCKETS - 1)
+		str_appendf(buf, buflen, " <%luus:%lu",
+			    1UL << n, hp->bucket[n]);
+	    else
+		str_appendf(buf, buflen, " more:%lu", hp->bucket[n]);
+	}
+    (void)strlcat(buf, "\n", buflen);
+}
+#endif /* CONTROL_SOCKET_ENABLE */
+#endif /* NTP_ENABLE */
+
+#ifdef NTP_ENABLE
+/*
+ * Time-delivery pipeline.  Every time sample gpsd produces, the in-band
+ * time of a fix (TOFF) or a 1PPS edge, is offered to each sink that
+ * takes that kind of sample, subject to the sink's own filters (see
+ * timesink.c).  Sinks run in table order, most latency-sensitive first.
+ */
+#define TIMESAMPLE_TOFF	0x01	/* in-band time of a fix */
+#define TIMESAMPLE_PPS	0x02	/* 1PPS edge */
+
+struct timesample_t {
+    unsigned int kind;
+    struct timedelta_t td;
+    int precision;		/* PPS only */
+};
+
+struct timesink_t {
+    const char *name;
+    unsigned int kinds;		/* which samples this sink takes */
+    void (*deliver)(struct gps_device_t *, const struct timesample_t *,
+		    bool);
+    struct timefilter_conf_t conf;
+    struct timefilter_t state[MAX_DEVICES];
+};
+
+#ifdef NTPSHM_ENABLE
+static void timesink_shm(struct gps_device_t *device,
+			 const struct timesample_t *sample, bool holdover)
+/* the device's NTP shared-memory segment */
+{
+    struct timedelta_t td = sample->td;
+
+    if (device->shm_clock != NULL) {
+	/*
+	 * What ntpshm_put() does for in-band time, but with the leap
+	 * indicator passed in rather than read from the context, which
+	 * the PPS threads read concurrently: in holdover, tell the NTP
+	 * daemon the clock is free running.
+	 */
+	ntp_write(device->shm_clock, &td, -1,
+		  holdover ? LEAP_NOTINSYNC : context.leap_notify);
+	timehist_record(device, timestamp() - wakeup_time);
+    }
+}
+#endif /* NTPSHM_ENABLE */
+
+#ifdef SOCKET_EXPORT_ENABLE
+static void timesink_json(struct gps_device_t *device,
+			  const struct timesample_t *sample, bool holdover)
+/* TOFF and PPS reports to watching clients */
+{
+    const struct timedelta_t *td = &sample->td;
+    const char *hold = holdover ? ",\"holdover\":true" : "";
+
+    /*
+     * real_XXX - the time the GPS thinks it is at the PPS edge
+     * clock_XXX - the time the system clock thinks it is at the PPS edge
+     */
+    if (sample->kind == TIMESAMPLE_PPS)
+	notify_watchers(device, true, true,
+			"{\"class\":\"PPS\",\"device\":\"%s\",\"real_sec\":%ld, \"real_nsec\":%ld,\"clock_sec\":%ld,\"clock_nsec\":%ld,\"precision\":%d%s}\r\n",
+			device->gpsdata.dev.path,
+			td->real.tv_sec, td->real.tv_nsec,
+			td->clock.tv_sec, td->clock.tv_nsec,
+			sample->precision, hold);
+    else
+	notify_watchers(device, false, true,
+			"{\"class\":\"TOFF\",\"device\":\"%s\",\"real_sec\":%ld, \"real_nsec\":%ld,\"clock_sec\":%ld,\"clock_nsec\":%ld%s}\r\n",
+			device->gpsdata.dev.path,
+			td->real.tv_sec, td->real.tv_nsec,
+			td->clock.tv_sec, td->clock.tv_nsec, hold);
+}
+#endif /* SOCKET_EXPORT_ENABLE */
+
+static struct timesink_t timesinks[] = {
+#ifdef NTPSHM_ENABLE
+    {.name = "shm", .kinds = TIMESAMPLE_TOFF, .deliver = timesink_shm},
+#endif /* NTPSHM_ENABLE */
+#ifdef SOCKET_EXPORT_ENABLE
+    {.name = "json", .kinds = TIMESAMPLE_TOFF | TIMESAMPLE_PPS,
+     .deliver = timesink_json},
+#endif /* SOCKET_EXPORT_ENABLE */
+};
+
+static bool timesink_holdover(struct timesink_t *sink,
+			      struct gps_device_t *device, timestamp_t now)
+/* re-evaluate a sink's holdover for a device, logging any change */
+{
+    struct timefilter_t *state = &sink->state[device - devices];
+    bool held = state->holdover;
+
+    if (timefilter_holdover(&sink->conf, state, now) != held)
+	gpsd_log(&context.errout, held ? LOG_INF : LOG_WARN,
+		 "%s: time sink %s %s holdover\n",
+		 device->gpsdata.dev.path, sink->name,
+		 held ? "leaves" : "enters");
+    return state->holdover;
+}
+
+static void ship_time(struct gps_device_t *device,
+		      const struct timesample_t *sample)
+/* offer a time sample to every sink that wants it */
+{
+    struct timesink_t *sink;
+    timestamp_t now = timestamp();
+    bool locked = device->gpsdata.fix.mode >= MODE_2D;
+
+    for (sink = timesinks; sink < timesinks + NITEMS(timesinks); sink++) {
+	bool accepted, holdover;
+
+	if ((sink->kinds & sample->kind) == 0)
+	    continue;
+	accepted = timefilter_accept(&sink->conf,
+				     &sink->state[device - devices],
+				     &sample->td, locked, now);
+	holdover = timesink_holdover(sink, device, now);
+	if (accepted)
+	    sink->deliver(device, sample, holdover);
+    }
+}
+
+static void timesink_sweep(void)
+/* catch sinks going into holdover because samples stopped coming */
+{
+    struct timesink_t *sink;
+    struct gps_device_t *devp;
+    timestamp_t now = timestamp();
+
+    for (sink = timesinks; sink < timesinks + NITEMS(timesinks); sink++)
+	for (devp = devices; devp < devices + MAX_DEVICES; devp++)
+	    if (allocated_device(devp))
+		(void)timesink_holdover(sink, devp, now);
+}
+
+#ifdef CONTROL_SOCKET_ENABLE
+static bool timesink_configure(char *spec)
+/* apply "name,key=value,..." to a sink's filters */
+{
+    struct timesink_t *sink;
+    struct timefilter_conf_t conf;
+    char *item, *saveptr = NULL;
+    int i;
+
+    if ((item = strtok_r(spec, ",", &saveptr)) == NULL)
+	return false;
+    for (sink = timesinks; sink < timesinks + NITEMS(timesinks); sink++)
+	if (strcmp(sink->name, item) == 0)
+	    break;
+    if (sink == timesinks + NITEMS(timesinks))
+	return false;
+
+    conf = sink->conf;
+    while ((item = strtok_r(NULL, ",", &saveptr)) != NULL) {
+	char *value = strchr(item, '=');
+
+	if (value == NULL)
+	    return false;
+	*value++ = '\0';
+	if (strcmp(item, "median") == 0)
+	    conf.median = atoi(value);
+	else if (strcmp(item, "maxdev") == 0)
+	    conf.maxdev = strtod(value, NULL);
+	else if (strcmp(item, "interval") == 0)
+	    conf.mininterval = strtod(value, NULL);
+	else if (strcmp(item, "holdover") == 0)
+	    conf.holdover = strtod(value, NULL);
+	else
+	    return false;
+    }
+    if (conf.median < 0 || conf.median > TIMEFILTER_MEDIAN_MAX)
+	return false;
+
+    sink->conf = conf;
+    for (i = 0; i < MAX_DEVICES; i++)
+	timefilter_reset(&sink->state[i]);
+    return true;
+}
+
+static void timesink_dump(char *buf, size_t buflen)
+/* each sink's filter settings, then its counters for each device */
+{
+    struct timesink_t *sink;
+    struct gps_device_t *devp;
+    timestamp_t now = timestamp();
+
+    buf[0] = '\0';
+    for (sink = timesinks; sink < timesinks + NITEMS(timesinks); sink++) {
+	str_appendf(buf, buflen,
+		    "%s%s%s median=%d maxdev=%g interval=%g holdover=%g\n",
+		    sink->name,
+		    (sink->kinds & TIMESAMPLE_TOFF) ? " toff" : "",
+		    (sink->kinds & TIMESAMPLE_PPS) ? " pps" : "",
+		    sink->conf.median, sink->conf.maxdev,
+		    sink->conf.mininterval, sink->conf.holdover);
+	for (devp = devices; devp < devices + MAX_DEVICES; devp++) {
+	    struct timefilter_t *state = &sink->state[devp - devices];
+
+	    if (!allocated_device(devp))
+		continue;
+	    str_appendf(buf, buflen,
+			"    %s delivered=%lu rejected=%lu ratelimited=%lu%s\n",
+			devp->gpsdata.dev.path, state->delivered,
+			state->rejected, state->ratelimited,
+			timesink_holdover(sink, devp, now) ? " holdover" : "");
+	}
+    }
+}
+#endif /* CONTROL_SOCKET_ENABLE */
+#endif /* NTP_ENABLE */
+
 bool gpsd_add_device(const char *device_name, bool flag_nowait)
 /* add a device to the pool; open it right away if in nowait mode
  * return: false on failure
@@ -725,6 +1088,9 @@ bool gpsd_add_device(const char *device_name, bool flag_nowait)
  */
 {
     struct gps_device_t *devp;
+#ifdef NTP_ENABLE
+    struct timesink_t *sink;
+#endif /* NTP_ENABLE */
     bool ret = false;
     /* we can't handle paths longer than GPS_PATH_MAX, so don't try */
     if (strlen(device_name) >= GPS_PATH_MAX) {
@@ -737,9 +1103,21 @@ bool gpsd_add_device(const char *device_name, bool flag_nowait)
     for (devp = devices; devp < devices + MAX_DEVICES; devp++)
 	if (!allocated_device(devp)) {
 	    gpsd_init(devp, &context, device_name);
+	    if (!gpsd_device_storage(devp)) {
+		gpsd_log(&context.errout, LOG_ERROR,
+			 "ignoring device %s: out of memory\n", device_name);
+		free_device(devp);
+		return false;
+	    }
+	    gpsd_skyview_reset(devp);
 #ifdef NTPSHM_ENABLE
 	    ntpshm_session_init(devp);
 #endif /* NTPSHM_ENABLE */
+#ifdef NTP_ENABLE
+	    memset(&timehist[devp - devices], '\0', sizeof(timehist[0]));
+	    for (sink = timesinks; sink < timesinks + NITEMS(timesinks); sink++)
+		timefilter_reset(&sink->state[devp - devices]);
+#endif /* NTP_ENABLE */
 	    gpsd_log(&context.errout, LOG_INF,
 		     "stashing device %s at slot %d\n",
 		     device_name, (int)(devp - devices));
@@ -914,6 +1292,59 @@ static void handle_control(int sfd, char *buf)
 	    ignore_return(write(sfd, "\n", 1));
 	}
 	ignore_return(write(sfd, "OK\n", 3));
+#if defined(UBLOX_ENABLE) && defined(BINARY_ENABLE)
+    } else if (strstr(buf, "?msgstats")==buf) {
+	/* write back per-message statistics of each device followed by OK */
+	for (devp = devices; devp < devices + MAX_DEVICES; devp++) {
+	    char stats[BUFSIZ];
+	    if (!allocated_device(devp))
+		continue;
+	    ubx_msgstats_dump(devp, stats, sizeof(stats));
+	    ignore_return(write(sfd, stats, strlen(stats)));
+	}
+	ignore_return(write(sfd, "OK\n", 3));
+#endif /* defined(UBLOX_ENABLE) && defined(BINARY_ENABLE) */
+#ifdef NTP_ENABLE
+    } else if (strstr(buf, "?timehist")==buf) {
+	/* write back time-publication latency of each device followed by OK */
+	for (devp = devices; devp < devices + MAX_DEVICES; devp++) {
+	    char hist[BUFSIZ];
+	    if (!allocated_device(devp))
+		continue;
+	    timehist_dump(devp, hist, sizeof(hist));
+	    ignore_return(write(sfd, hist, strlen(hist)));
+	}
+	ignore_return(write(sfd, "OK\n", 3));
+    } else if (strstr(buf, "?timesink=")==buf) {
+	/* reconfigure one sink's filters */
+	(void)snarfline(buf + 10, &stash);
+	if (timesink_configure(stash))
+	    ignore_return(write(sfd, "OK\n", 3));
+	else
+	    ignore_return(write(sfd, "ERROR\n", 6));
+    } else if (strstr(buf, "?timesink")==buf) {
+	/* write back sink filter settings and counters followed by OK */
+	char sinks[BUFSIZ];
+	timesink_dump(sinks, sizeof(sinks));
+	ignore_return(write(sfd, sinks, strlen(sinks)));
+	ignore_return(write(sfd, "OK\n", 3));
+#endif /* NTP_ENABLE */
+#ifdef TRACE_ENABLE
+    } else if (strstr(buf, "?trace=")==buf) {
+	/* set the trace level */
+	gpsd_trace_setlevel(atoi(buf + 7));
+	gpsd_log(&context.errout, LOG_INF,
+		 "<= control(%d): trace level now %d\n",
+		 sfd, gpsd_trace_getlevel());
+	ignore_return(write(sfd, "OK\n", 3));
+    } else if (strstr(buf, "?trace")==buf) {
+	/* drain the trace rings followed by OK */
+	char trace[BUFSIZ];
+	size_t len;
+	while ((len = gpsd_trace_dump(trace, sizeof(trace))) > 0)
+	    ignore_return(write(sfd, trace, len));
+	ignore_return(write(sfd, "OK\n", 3));
+#endif /* TRACE_ENABLE */
     } else {
 	/* unknown command */
 	ignore_return(write(sfd, "ERROR\n", 6));
@@ -1075,6 +1506,50 @@ static void rstrip(char *str)
     }
 }
 
+static const char *watch_maxrate(const char *buf, char *copy, size_t copylen,
+				 double *maxrate, size_t *cut)
+/*
+ * maxrate is a ?WATCH attribute of the daemon's own, not part of the
+ * libgps policy json_watch_read() parses, so take it out of the object
+ * first.  Returns the object to parse: buf itself, or the copy with
+ * cut characters of maxrate member removed.
+ */
+{
+    const char *close = strchr(buf, '}');
+    const char *attr = strstr(buf, "\"maxrate\"");
+    const char *p, *next;
+    char *numend;
+    double value;
+
+    *cut = 0;
+    if (close == NULL || attr == NULL || attr > close
+	|| strlen(buf) >= copylen)
+	return buf;
+    for (p = attr + 9; isspace((unsigned char)*p); p++)
+	continue;
+    if (*p != ':')
+	return buf;	/* let the parser complain */
+    value = strtod(p + 1, &numend);
+    if (numend == p + 1)
+	return buf;
+    for (next = numend; isspace((unsigned char)*next); next++)
+	continue;
+    if (*next == ',')
+	++next;
+    else {
+	/* last member, so the comma to drop comes before it */
+	while (attr > buf && isspace((unsigned char)attr[-1]))
+	    --attr;
+	if (attr > buf && attr[-1] == ',')
+	    --attr;
+    }
+    *maxrate = value;
+    *cut = (size_t)(next - attr);
+    memcpy(copy, buf, (size_t)(attr - buf));
+    (void)strlcpy(copy + (attr - buf), next, copylen - (size_t)(attr - buf));
+    return copy;
+}
+
 static void handle_request(struct subscriber_t *sub,
 			   const char *buf, const char **after,
 			   char *reply, size_t replylen)
@@ -1094,10 +1569,19 @@ static void handle_request(struct subscriber_t *sub,
 	if (*buf == ';') {
 	    ++buf;
 	} else {
-	    int status = json_watch_read(buf + 1, &sub->policy, &end);
+	    char copy[BUFSIZ];
+	    size_t cut;
+	    const char *watch = watch_maxrate(buf + 1, copy, sizeof(copy),
+					      &sub->maxrate, &cut);
+	    int status = json_watch_read(watch, &sub->policy, &end);
+	    if (end != NULL && watch == copy)
+		end = buf + 1 + (end - copy) + cut;
 #ifndef TIMING_ENABLE
 	    sub->policy.timing = false;
 #endif /* TIMING_ENABLE */
+	    if (sub->maxrate < 0)
+		sub->maxrate = 0;
+	    memset(sub->rate, '\0', sizeof(sub->rate));
 	    if (end == NULL)
 		buf += strlen(buf);
 	    else {
@@ -1150,6 +1634,16 @@ static void handle_request(struct subscriber_t *sub,
 	json_devicelist_dump(reply + strlen(reply), replylen - strlen(reply));
 	json_watch_dump(&sub->policy,
 			reply + strlen(reply), replylen - strlen(reply));
+	if (sub->maxrate > 0) {
+	    /* the policy dump knows nothing of maxrate, so splice it in */
+	    char *close = strrchr(reply, '}');
+
+	    if (close != NULL) {
+		*close = '\0';
+		str_appendf(reply, replylen, ",\"maxrate\":%g}\r\n",
+			    sub->maxrate);
+	    }
+	}
     } else if (str_starts_with(buf, "DEVICE")
 	       && (buf[6] == ';' || buf[6] == '=')) {
 	struct devconfig_t devconf;
@@ -1316,7 +1810,7 @@ static void handle_request(struct subscriber_t *sub,
 	for (devp = devices; devp < devices + MAX_DEVICES; devp++) {
 	    if (allocated_device(devp) && subscribed(sub, devp)) {
 		if ((devp->observed & GPS_TYPEMASK) != 0) {
-		    json_sky_dump(&devp->gpsdata,
+		    json_sky_dump(&devp->gpsdata, NULL,
 				  reply + strlen(reply),
 				  replylen - strlen(reply));
 		    rstrip(reply);
@@ -1377,15 +1871,94 @@ static void raw_report(struct subscriber_t *sub, struct gps_device_t *device)
      */
     if (sub->policy.raw == 1) {
 	const char *hd =
-	    gpsd_hexdump(device->msgbuf, sizeof(device->msgbuf),
+	    gpsd_hexdump(device->msgbuf, GPS_MSGBUF_MAX,
 			 (char *)device->lexer.outbuffer,
 			 device->lexer.outbuflen);
-	(void)strlcat((char *)hd, "\r\n", sizeof(device->msgbuf));
+	(void)strlcat((char *)hd, "\r\n", GPS_MSGBUF_MAX);
 	(void)throttled_write(sub, (char *)hd, strlen(hd));
     }
 #endif /* BINARY_ENABLE */
 }
 
+/* report classes a subscriber's maxrate may hold back */
+#define COALESCE_SET	(REPORT_IS|GST_SET|SATELLITE_SET)
+/* a report this fraction of an interval early still counts as on time */
+#define RATE_SLOP	0.1
+
+static timestamp_t rate_due;	/* earliest held-back report, 0 = none */
+static int rate_wakeup[2] = {-1, -1};	/* self-pipe for the rate timer */
+
+static void onalarm(int sig UNUSED)
+/* the rate timer ran out; wake the main loop */
+{
+    if (rate_wakeup[1] >= 0)
+	ignore_return(write(rate_wakeup[1], "", 1));
+}
+
+static void rate_arm(timestamp_t due, timestamp_t now)
+/* make sure the main loop wakes up by due */
+{
+    struct itimerval it;
+    double delay;
+
+    if (rate_due != 0 && rate_due <= due)
+	return;
+    rate_due = due;
+    delay = due - now;
+    if (delay < 0.001)
+	delay = 0.001;
+    memset(&it, '\0', sizeof(it));
+    it.it_value.tv_sec = (time_t)delay;
+    it.it_value.tv_usec = (suseconds_t)((delay - (time_t)delay) * 1e6);
+    (void)setitimer(ITIMER_REAL, &it, NULL);
+}
+
+static void rate_advance(const struct subscriber_t *sub,
+			 struct ratelimit_t *rl, timestamp_t now)
+/*
+ * A report went out; move to the next slot.  Stepping by whole
+ * intervals rather than restarting at now keeps a receiver running at
+ * exactly maxrate, with some jitter, from losing every other report.
+ */
+{
+    timestamp_t interval = 1.0 / sub->maxrate;
+
+    rl->last += interval;
+    /* far behind, idle for a while, or the clock was stepped */
+    if (now - rl->last > interval || rl->last - now > interval)
+	rl->last = now;
+}
+
+static gps_mask_t rate_limit(struct subscriber_t *sub,
+			     struct gps_device_t *device,
+			     gps_mask_t changed)
+/* coalesce fix reports for subscribers that asked for a maximum rate */
+{
+    struct ratelimit_t *rl = &sub->rate[device - devices];
+    timestamp_t now, interval;
+
+    if (sub->maxrate <= 0 || (changed & COALESCE_SET) == 0)
+	return changed;
+
+    /*
+     * Reports are built from the session state at send time, so the
+     * classes held back here go out later with the latest values,
+     * either with the next report that passes or from rate_sweep().
+     */
+    now = timestamp();
+    interval = 1.0 / sub->maxrate;
+    if (now - rl->last < interval * (1.0 - RATE_SLOP)
+	&& rl->last - now < interval) {
+	rl->deferred |= changed & COALESCE_SET;
+	rate_arm(rl->last + interval, now);
+	return changed & ~COALESCE_SET;
+    }
+    changed |= rl->deferred;
+    rl->deferred = 0;
+    rate_advance(sub, rl, now);
+    return changed;
+}
+
 static void pseudonmea_report(struct subscriber_t *sub,
 			  gps_mask_t changed,
 			  struct gps_device_t *device)
@@ -1429,14 +2002,153 @@ static void pseudonmea_report(struct subscriber_t *sub,
 #endif /* AIVDM_ENABLE */
     }
 }
+
+static void rate_sweep(void)
+/* ship held-back reports whose interval has run out */
+{
+    struct subscriber_t *sub;
+    timestamp_t now, next = 0;
+    char buf[64];
+
+    if (rate_wakeup[0] >= 0)
+	while (read(rate_wakeup[0], buf, sizeof(buf)) > 0)
+	    continue;
+    now = timestamp();
+    if (rate_due == 0 || now < rate_due)
+	return;
+    rate_due = 0;
+
+    for (sub = subscribers; sub < subscribers + MAX_CLIENTS; sub++) {
+	struct gps_device_t *device;
+
+	if (sub->active == 0 || sub->maxrate <= 0)
+	    continue;
+	for (device = devices; device < devices + MAX_DEVICES; device++) {
+	    struct ratelimit_t *rl = &sub->rate[device - devices];
+	    gps_mask_t report = rl->deferred;
+
+	    if (report == 0)
+		continue;
+	    if (!allocated_device(device) || !subscribed(sub, device)) {
+		rl->deferred = 0;
+		continue;
+	    }
+	    if (now < rl->last + 1.0 / sub->maxrate) {
+		if (next == 0 || rl->last + 1.0 / sub->maxrate < next)
+		    next = rl->last + 1.0 / sub->maxrate;
+		continue;
+	    }
+	    rl->deferred = 0;
+	    rate_advance(sub, rl, now);
+	    if (sub->policy.nmea)
+		pseudonmea_report(sub, report, device);
+	    if (sub->policy.json) {
+		char json[GPS_JSON_RESPONSE_MAX * 4];
+
+		json_data_report(report, device, &sub->policy,
+				 json, sizeof(json));
+		if (json[0] != '\0')
+		    (void)throttled_write(sub, json, strlen(json));
+	    }
+	}
+    }
+    if (next != 0)
+	rate_arm(next, now);
+}
 #endif /* SOCKET_EXPORT_ENABLE */
 
+#ifdef NTP_ENABLE
+static void publish_time(struct gps_device_t *device, gps_mask_t changed)
+/* hand fresh time to NTP consumers, ahead of any client reporting */
+{
+    /*
+     * Time is eligible for shipping to NTPD if the driver has
+     * asserted PPSTIME_IS at any point in the current cycle.
+     */
+    if ((changed & CLEAR_IS)!=0)
+	device->ship_to_ntpd = false;
+    if ((changed & PPSTIME_IS)!=0)
+	device->ship_to_ntpd = true;
+    /*
+     * Only update the NTP time if we've seen the leap-seconds data.
+     * Else we may be providing GPS time.
+     */
+    if ((changed & TIME_SET) == 0) {
+	//gpsd_log(&context.errout, LOG_PROG, "NTP: No time this packet\n");
+    } else if ( 0 >= device->fixcnt ) {
+        /* many GPS spew random times until a valid GPS fix */
+	//gpsd_log(&context.errout, LOG_PROG, "NTP: no fix\n");
+    } else if (isnan(device->newdata.time)) {
+	//gpsd_log(&context.errout, LOG_PROG, "NTP: bad new time\n");
+#if defined(PPS_ENABLE)
+    } else if (device->newdata.time <= device->pps_thread.fix_in.real.tv_sec) {
+	//gpsd_log(&context.errout, LOG_PROG, "NTP: Not a new time\n");
+#endif /* PPS_ENABLE */
+    } else if (!device->ship_to_ntpd) {
+	//gpsd_log(&context.errout, LOG_PROG, "NTP: No precision time report\n");
+    } else {
+	struct timesample_t sample;
+#if defined(PPS_ENABLE)
+	struct gps_device_t *ppsonly;
+#endif /* PPS_ENABLE */
+
+	sample.kind = TIMESAMPLE_TOFF;
+	sample.precision = 0;
+	ntp_latch(device, &sample.td);
+
+#if defined(PPS_ENABLE)
+	/*
+	 * Propagate this in-band-time to all PPS-only devices first; their
+	 * threads are waiting on it, and the sinks below include the
+	 * client fan-out.
+	 */
+	for (ppsonly = devices; ppsonly < devices + MAX_DEVICES; ppsonly++)
+	    if (ppsonly->sourcetype == source_pps)
+		pps_thread_fixin(&ppsonly->pps_thread, &sample.td);
+#endif /* PPS_ENABLE */
+
+	ship_time(device, &sample);
+    }
+}
+#endif /* NTP_ENABLE */
+
 static void all_reports(struct gps_device_t *device, gps_mask_t changed)
 /* report on the current packet from a specified device */
 {
 #ifdef SOCKET_EXPORT_ENABLE
     struct subscriber_t *sub;
+#endif /* SOCKET_EXPORT_ENABLE */
+
+    GPSD_TRACE(LOG_IO, "report device %ld changed 0x%lx\n",
+	       device - devices, changed, 0, 0);
+
+#ifdef NTP_ENABLE
+    /* time is the most latency-sensitive output, so it goes first */
+    publish_time(device, changed);
+#endif /* NTP_ENABLE */
+
+#ifdef AIVDM_ENABLE
+    /* report each AIS transmission once, whichever receiver heard it */
+    if ((changed & AIS_SET) != 0 && ais_dedup.table != NULL
+	&& device->lexer.type == AIVDM_PACKET) {
+	char channel = device->driver->aivdm.ais_channel;
+	struct aivdm_context_t *ais_context =
+	    &device->driver->aivdm.context[channel == 'B' ? 1 : 0];
+
+	if (ais_dedup_seen(&ais_dedup,
+			   ais_dedup_hash(AIS_DEDUP_SEED, ais_context->bits,
+					  ais_context->bitlen, channel),
+			   timestamp())) {
+	    gpsd_log(&context.errout, LOG_PROG,
+		     "duplicate AIS type %u from %u on %s dropped\n",
+		     device->gpsdata.ais.type, device->gpsdata.ais.mmsi,
+		     device->gpsdata.dev.path);
+	    changed &= ~AIS_SET;
+	}
+    }
+#endif /* AIVDM_ENABLE */
 
+#ifdef SOCKET_EXPORT_ENABLE
     /* add any just-identified device to watcher lists */
     if ((changed & DRIVER_IS) != 0) {
 	bool listeners = false;
@@ -1449,6 +2161,7 @@ static void all_reports(struct gps_device_t *device, gps_mask_t changed)
 	if (listeners) {
 	    (void)awaken(device);
 	}
+	prune_reports(device);
     }
 
     /* handle laggy response to a firmware version query */
@@ -1498,64 +2211,6 @@ static void all_reports(struct gps_device_t *device, gps_mask_t changed)
     }
 
 
-#ifdef NTP_ENABLE
-    /*
-     * Time is eligible for shipping to NTPD if the driver has
-     * asserted PPSTIME_IS at any point in the current cycle.
-     */
-    if ((changed & CLEAR_IS)!=0)
-	device->ship_to_ntpd = false;
-    if ((changed & PPSTIME_IS)!=0)
-	device->ship_to_ntpd = true;
-    /*
-     * Only update the NTP time if we've seen the leap-seconds data.
-     * Else we may be providing GPS time.
-     */
-    if ((changed & TIME_SET) == 0) {
-	//gpsd_log(&context.errout, LOG_PROG, "NTP: No time this packet\n");
-    } else if ( 0 >= device->fixcnt ) {
-        /* many GPS spew random times until a valid GPS fix */
-	//gpsd_log(&context.errout, LOG_PROG, "NTP: no fix\n");
-    } else if (isnan(device->newdata.time)) {
-	//gpsd_log(&context.errout, LOG_PROG, "NTP: bad new time\n");
-#if defined(PPS_ENABLE)
-    } else if (device->newdata.time <= device->pps_thread.fix_in.real.tv_sec) {
-	//gpsd_log(&context.errout, LOG_PROG, "NTP: Not a new time\n");
-#endif /* PPS_ENABLE */
-    } else if (!device->ship_to_ntpd) {
-	//gpsd_log(&context.errout, LOG_PROG, "NTP: No precision time report\n");
-    } else {
-	struct timedelta_t td;
-#if defined(PPS_ENABLE)
-	struct gps_device_t *ppsonly;
-#endif /* PPS_ENABLE */
-
-	ntp_latch(device, &td);
-
-#if defined(PPS_ENABLE)
-	/* propagate this in-band-time to all PPS-only devices */
-	for (ppsonly = devices; ppsonly < devices + MAX_DEVICES; ppsonly++)
-	    if (ppsonly->sourcetype == source_pps)
-		pps_thread_fixin(&ppsonly->pps_thread, &td);
-#endif /* PPS_ENABLE */
-
-#ifdef NTPSHM_ENABLE
-	if (device->shm_clock != NULL) {
-	    (void)ntpshm_put(device, device->shm_clock, &td);
-	}
-#endif /* NTPSHM_ENABLE */
-
-#ifdef SOCKET_EXPORT_ENABLE
-	notify_watchers(device, false, true,
-			"{\"class\":\"TOFF\",\"device\":\"%s\",\"real_sec\":%ld, \"real_nsec\":%ld,\"clock_sec\":%ld,\"clock_nsec\":%ld}\r\n",
-			device->gpsdata.dev.path,
-			td.real.tv_sec, td.real.tv_nsec,
-			td.clock.tv_sec, td.clock.tv_nsec);
-#endif /* SOCKET_EXPORT_ENABLE */
-
-    }
-#endif /* NTP_ENABLE */
-
     /*
      * If no reliable end of cycle, must report every time
      * a sentence changes position or mode. Likely to
@@ -1589,6 +2244,7 @@ static void all_reports(struct gps_device_t *device, gps_mask_t changed)
     if ((changed & (REPORT_IS|GST_SET|SATELLITE_SET|SUBFRAME_SET|
 		    ATTITUDE_SET|RTCM2_SET|RTCM3_SET|AIS_SET)) != 0)
 	shm_update(&context, &device->gpsdata);
+    shmring_publish(&context, device, (int)(device - devices), changed);
 #endif /* SHM_EXPORT_ENABLE */
 
 #ifdef SOCKET_EXPORT_ENABLE
@@ -1616,8 +2272,10 @@ static void all_reports(struct gps_device_t *device, gps_mask_t changed)
 	/* some listeners may be in watcher mode */
 	if (sub->policy.watcher) {
 	    if (changed & DATA_IS) {
+		gps_mask_t report = rate_limit(sub, device, changed);
+
 		/* guard keeps mask dumper from eating CPU */
-		if (context.errout.debug >= LOG_PROG)
+		if (gpsd_log_enabled(&context.errout, LOG_PROG))
 		    gpsd_log(&context.errout, LOG_PROG,
 			     "Changed mask: %s with %sreliable cycle detection\n",
 			     gps_maskdump(changed),
@@ -1627,7 +2285,7 @@ static void all_reports(struct gps_device_t *device, gps_mask_t changed)
 			     "time to report a fix\n");
 
 		if (sub->policy.nmea)
-		    pseudonmea_report(sub, changed, device);
+		    pseudonmea_report(sub, report, device);
 
 		if (sub->policy.json)
 		{
@@ -1639,7 +2297,7 @@ static void all_reports(struct gps_device_t *device, gps_mask_t changed)
 			    && !sub->policy.split24)
 			    continue;
 
-		    json_data_report(changed,
+		    json_data_report(report,
 				     device, &sub->policy,
 				     buf, sizeof(buf));
 		    if (buf[0] != '\0')
@@ -1674,10 +2332,37 @@ static int handle_gpsd_request(struct subscriber_t *sub, const char *buf)
 #endif /* SOCKET_EXPORT_ENABLE */
 
 #if defined(CONTROL_SOCKET_ENABLE) && defined(PPS_ENABLE) && defined(SOCKET_EXPORT_ENABLE)
+/*
+ * PPS events are handed from each device's PPS thread to the main loop
+ * through a small single-producer/single-consumer ring, so the PPS
+ * thread never formats JSON, takes a lock, or blocks on a slow client
+ * socket.  A byte written to a non-blocking pipe wakes the main loop.
+ * PPS is nominally 1Hz, so a few slots per device is ample.
+ */
+#define PPS_QUEUE_SIZE	8
+
+struct pps_event_t {
+    struct timedelta_t td;
+    int precision;
+    timestamp_t queued;		/* when the PPS thread queued it */
+};
+
+static struct pps_queue_t {
+    volatile unsigned int head;		/* advanced by the PPS thread */
+    volatile unsigned int tail;		/* advanced by the main loop */
+    unsigned int dropped;		/* events lost to a full queue */
+    timestamp_t maxdelay;		/* worst queue-to-client delay */
+    struct pps_event_t event[PPS_QUEUE_SIZE];
+} pps_queue[MAX_DEVICES];
+
+static int pps_wakeup[2] = {-1, -1};	/* self-pipe to wake the main loop */
+
 static void ship_pps_message(struct gps_device_t *session,
 				   struct timedelta_t *td)
-/* on PPS interrupt, ship a message to all clients */
+/* on PPS interrupt, queue a message for all clients */
 {
+    struct pps_queue_t *queue = &pps_queue[session - devices];
+    struct pps_event_t *event;
     int precision = -20;
 
     if ( source_usb == session->sourcetype) {
@@ -1685,20 +2370,69 @@ static void ship_pps_message(struct gps_device_t *session,
 	precision = -10;
     }
 
-    /* real_XXX - the time the GPS thinks it is at the PPS edge */
-    /* clock_XXX - the time the system clock thinks it is at the PPS edge */
-    notify_watchers(session, true, true,
-		    "{\"class\":\"PPS\",\"device\":\"%s\",\"real_sec\":%ld, \"real_nsec\":%ld,\"clock_sec\":%ld,\"clock_nsec\":%ld,\"precision\":%d}\r\n",
-		    session->gpsdata.dev.path,
-		    td->real.tv_sec, td->real.tv_nsec,
-		    td->clock.tv_sec, td->clock.tv_nsec,
-                    precision);
+    if (queue->head - queue->tail >= PPS_QUEUE_SIZE) {
+	/* main loop is stuck; newest event is the one to lose */
+	queue->dropped++;
+	return;
+    }
+    event = &queue->event[queue->head % PPS_QUEUE_SIZE];
+    event->td = *td;
+    event->precision = precision;
+    event->queued = timestamp();
+    /* event must be complete before the main loop can see it */
+    memory_barrier();
+    queue->head++;
 
-    /*
-     * PPS receipt resets the device's timeout.  This keeps PPS-only
-     * devices, which never deliver in-band data, from timing out.
-     */
-    session->gpsdata.online = timestamp();
+    if (pps_wakeup[1] >= 0)
+	ignore_return(write(pps_wakeup[1], "", 1));
+}
+
+static void drain_pps_messages(void)
+/* in the main loop, ship queued PPS events to all clients */
+{
+    struct gps_device_t *device;
+    char buf[64];
+
+    /* the pipe only wakes us; what matters is in the queues */
+    if (pps_wakeup[0] >= 0)
+	while (read(pps_wakeup[0], buf, sizeof(buf)) > 0)
+	    continue;
+
+    for (device = devices; device < devices + MAX_DEVICES; device++) {
+	struct pps_queue_t *queue = &pps_queue[device - devices];
+
+	while (queue->tail != queue->head) {
+	    struct pps_event_t *event;
+	    timestamp_t delay;
+
+	    memory_barrier();
+	    event = &queue->event[queue->tail % PPS_QUEUE_SIZE];
+	    if (allocated_device(device)) {
+		struct timesample_t sample;
+
+		sample.kind = TIMESAMPLE_PPS;
+		sample.td = event->td;
+		sample.precision = event->precision;
+		ship_time(device, &sample);
+	    }
+	    delay = timestamp() - event->queued;
+	    if (delay > queue->maxdelay)
+		queue->maxdelay = delay;
+	    gpsd_log(&context.errout, LOG_PROG,
+		     "PPS: %s queued %.6f sec, worst %.6f, %u dropped\n",
+		     device->gpsdata.dev.path, delay,
+		     queue->maxdelay, queue->dropped);
+	    memory_barrier();
+	    queue->tail++;
+
+	    /*
+	     * PPS receipt resets the device's timeout.  This keeps
+	     * PPS-only devices, which never deliver in-band data, from
+	     * timing out.
+	     */
+	    device->gpsdata.online = timestamp();
+	}
+    }
 }
 #endif
 
@@ -1821,6 +2555,12 @@ int main(int argc, char *argv[])
     sockaddr_t fsin;
 #endif /* defined(SOCKET_EXPORT_ENABLE) || defined(CONTROL_SOCKET_ENABLE) */
     static char *pid_file = NULL;
+#ifdef NTP_ENABLE
+    time_t last_sweep = 0;
+#endif /* NTP_ENABLE */
+#if defined(SOCKET_EXPORT_ENABLE) && defined(SHM_EXPORT_ENABLE)
+    time_t last_shm_check = 0;
+#endif /* defined(SOCKET_EXPORT_ENABLE) && defined(SHM_EXPORT_ENABLE) */
     struct gps_device_t *device;
     int i, option;
     int msocks[2] = {-1, -1};
@@ -2026,9 +2766,35 @@ int main(int argc, char *argv[])
 		 "successfully connected to the DBUS system bus\n");
 #endif /* defined(DBUS_EXPORT_ENABLE) */
 
+    /* a finer geoid grid, mapped before we drop privileges */
+    if (getenv("GPSD_GEOID_GRID") != NULL) {
+	if (wgs84_geoid_load(getenv("GPSD_GEOID_GRID")))
+	    gpsd_log(&context.errout, LOG_INF,
+		     "using geoid grid %s\n", getenv("GPSD_GEOID_GRID"));
+	else
+	    gpsd_log(&context.errout, LOG_ERROR,
+		     "can't load geoid grid %s: %s\n",
+		     getenv("GPSD_GEOID_GRID"), strerror(errno));
+    }
+
+#ifdef AIVDM_ENABLE
+    if (getenv("GPSD_AIS_DEDUP") != NULL) {
+	double window = atof(getenv("GPSD_AIS_DEDUP"));
+
+	if (window > 0 && ais_dedup_init(&ais_dedup, window))
+	    gpsd_log(&context.errout, LOG_INF,
+		     "dropping AIS repeated within %.1f seconds\n", window);
+	else
+	    gpsd_log(&context.errout, LOG_ERROR,
+		     "can't set up AIS de-duplication for %s\n",
+		     getenv("GPSD_AIS_DEDUP"));
+    }
+#endif /* AIVDM_ENABLE */
+
 #ifdef SHM_EXPORT_ENABLE
     /* create the shared segment as root so readers can't mess with it */
     (void)shm_acquire(&context);
+    (void)shmring_acquire(&context);
 #endif /* SHM_EXPORT_ENABLE */
 
     /*
@@ -2125,6 +2891,12 @@ int main(int argc, char *argv[])
 	(void)sigaction(SIGTERM, &sa, NULL);
 	(void)sigaction(SIGQUIT, &sa, NULL);
 	(void)signal(SIGPIPE, SIG_IGN);
+#ifdef SOCKET_EXPORT_ENABLE
+	/* the maxrate timer only has to wake us up, so restart syscalls */
+	sa.sa_handler = onalarm;
+	sa.sa_flags = SA_RESTART;
+	(void)sigaction(SIGALRM, &sa, NULL);
+#endif /* SOCKET_EXPORT_ENABLE */
     }
 
     /* daemon got termination or interrupt signal */
@@ -2144,6 +2916,26 @@ int main(int argc, char *argv[])
 #ifdef CONTROL_SOCKET_ENABLE
     FD_ZERO(&control_fds);
 #endif /* CONTROL_SOCKET_ENABLE */
+#if defined(CONTROL_SOCKET_ENABLE) && defined(PPS_ENABLE) && defined(SOCKET_EXPORT_ENABLE)
+    if (pps_wakeup[0] < 0 && pipe(pps_wakeup) == 0) {
+	(void)fcntl(pps_wakeup[0], F_SETFL, O_NONBLOCK);
+	(void)fcntl(pps_wakeup[1], F_SETFL, O_NONBLOCK);
+    }
+    if (pps_wakeup[0] >= 0) {
+	FD_SET(pps_wakeup[0], &all_fds);
+	adjust_max_fd(pps_wakeup[0], true);
+    }
+#endif /* CONTROL_SOCKET_ENABLE && PPS_ENABLE && SOCKET_EXPORT_ENABLE */
+#ifdef SOCKET_EXPORT_ENABLE
+    if (rate_wakeup[0] < 0 && pipe(rate_wakeup) == 0) {
+	(void)fcntl(rate_wakeup[0], F_SETFL, O_NONBLOCK);
+	(void)fcntl(rate_wakeup[1], F_SETFL, O_NONBLOCK);
+    }
+    if (rate_wakeup[0] >= 0) {
+	FD_SET(rate_wakeup[0], &all_fds);
+	adjust_max_fd(rate_wakeup[0], true);
+    }
+#endif /* SOCKET_EXPORT_ENABLE */
 
     /* initialize the GPS context's time fields */
     gpsd_time_init(&context, time(NULL));
@@ -2187,6 +2979,15 @@ int main(int argc, char *argv[])
 	    exit(EXIT_FAILURE);
 	}
 
+#ifdef NTP_ENABLE
+	wakeup_time = timestamp();
+#endif /* NTP_ENABLE */
+
+#if defined(CONTROL_SOCKET_ENABLE) && defined(PPS_ENABLE) && defined(SOCKET_EXPORT_ENABLE)
+	/* ship PPS events queued by the device threads */
+	drain_pps_messages();
+#endif /* CONTROL_SOCKET_ENABLE && PPS_ENABLE && SOCKET_EXPORT_ENABLE */
+
 #ifdef SOCKET_EXPORT_ENABLE
 	/* always be open to new client connections */
 	for (i = 0; i < AFCOUNT; i++) {
@@ -2228,6 +3029,7 @@ int main(int argc, char *argv[])
 			adjust_max_fd(ssock, true);
 			client->fd = ssock;
 			client->active = time(NULL);
+			subscriptions_changed = true;
 			gpsd_log(&context.errout, LOG_SPIN,
 				 "client %s (%d) connect on fd %d\n", c_ip,
 				 sub_index(client), ssock);
@@ -2305,6 +3107,19 @@ int main(int argc, char *argv[])
 		    break;
 		}
 
+#ifdef SOCKET_EXPORT_ENABLE
+	/* maxrate reports held back from devices that went quiet */
+	rate_sweep();
+#endif /* SOCKET_EXPORT_ENABLE */
+
+#ifdef NTP_ENABLE
+	/* holdover is mostly entered when samples stop coming at all */
+	if (time(NULL) != last_sweep) {
+	    last_sweep = time(NULL);
+	    timesink_sweep();
+	}
+#endif /* NTP_ENABLE */
+
 #ifdef __UNUSED_AUTOCONNECT__
 	if (context.fixcnt > 0 && !context.autconnect) {
 	    for (device = devices; device < devices + MAX_DEVICES; device++) {
@@ -2354,6 +3169,7 @@ int main(int argc, char *argv[])
 		    sub->active = time(NULL);
 		    if (handle_gpsd_request(sub, buf) < 0)
 			detach_client(sub);
+		    subscriptions_changed = true;
 		}
 	    } else {
 		unlock_subscriber(sub);
@@ -2368,6 +3184,27 @@ int main(int argc, char *argv[])
 	    }
 	}
 
+#ifdef SHM_EXPORT_ENABLE
+	/* shared-memory readers come and go without telling us */
+	if (time(NULL) != last_shm_check) {
+	    bool watched = shm_readers() > 0;
+
+	    last_shm_check = time(NULL);
+	    if (watched != shm_watched) {
+		shm_watched = watched;
+		subscriptions_changed = true;
+	    }
+	}
+#endif /* SHM_EXPORT_ENABLE */
+
+	/* let receivers stop emitting what no subscriber needs */
+	if (subscriptions_changed) {
+	    subscriptions_changed = false;
+	    for (device = devices; device < devices + MAX_DEVICES; device++)
+		if (allocated_device(device) && device->gpsdata.gps_fd > -1)
+		    prune_reports(device);
+	}
+
 	/*
 	 * Mark devices with an identified packet type but no
 	 * remaining subscribers to be closed in RELEASE_TIME seconds.
@@ -2479,6 +3316,7 @@ shutdown:
 
 #ifdef SHM_EXPORT_ENABLE
     shm_release(&context);
+    shmring_release(&context);
 #endif /* SHM_EXPORT_ENABLE */
 
 #ifdef CONTROL_SOCKET_ENABLE
@@ -15,6 +15,7 @@ PERMISSIONS
 ***************************************************************************/
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <math.h>
 #include <assert.h>
 #include <string.h>
@@ -244,10 +245,40 @@ void json_noise_dump(const struct gps_data_t *gpsdata,
     (void)strlcat(reply, "}\r\n", replylen);
 }
 
+bool json_sky_format(struct skyview_soa_t *soa)
+/* format the entries of a skyview mirror that changed since last time */
+{
+    int i;
+
+    if (soa->json == NULL) {
+	soa->json = calloc(MAXCHANNELS, sizeof(*soa->json));
+	if (soa->json == NULL)
+	    return false;
+	/* nothing has been formatted yet */
+	for (i = 0; i < soa->nsats; i++)
+	    soa->stale[i / 64] |= (uint64_t)1 << (i % 64);
+    }
+    for (i = gpsd_sky_next(soa->stale, 0); i >= 0;
+	 i = gpsd_sky_next(soa->stale, i + 1)) {
+	bool used = (soa->used[i / 64] >> (i % 64)) & 1;
+
+	(void)snprintf(soa->json[i], sizeof(soa->json[i]),
+		       "{\"PRN\":%d,\"el\":%d,\"az\":%d,\"ss\":%.0f,\"used\":%s}",
+		       soa->PRN[i], soa->elevation[i], soa->azimuth[i],
+		       soa->ss[i], used ? "true" : "false");
+    }
+    (void)memset(soa->stale, '\0', sizeof(soa->stale));
+    return true;
+}
+
 void json_sky_dump(const struct gps_data_t *datap,
+		   const struct skyview_soa_t *soa,
 		   char *reply, size_t replylen)
+/* dump a skyview; soa may be NULL, else it must be current for datap */
 {
-    int i, reported = 0;
+    struct skyview_soa_t local;
+    char json[MAXCHANNELS][SKY_JSON_MAX];
+    int i;
 
     assert(replylen > sizeof(char *));
     (void)strlcpy(reply, "{\"class\":\"SKY\",", replylen);
@@ -273,22 +304,19 @@ void json_sky_dump(const struct gps_data_t *datap,
 	str_appendf(reply, replylen, "\"gdop\":%.2f,", datap->dop.gdop);
     if (isnan(datap->dop.pdop) == 0)
 	str_appendf(reply, replylen, "\"pdop\":%.2f,", datap->dop.pdop);
-    /* insurance against flaky drivers */
-    for (i = 0; i < datap->satellites_visible; i++)
-	if (datap->skyview[i].PRN)
-	    reported++;
-    if (reported) {
+    if (soa == NULL || soa->json == NULL) {
+	/* format on the stack when there is no cache to use */
+	gpsd_skyview_soa(&local, datap);
+	local.json = json;
+	(void)json_sky_format(&local);
+	soa = &local;
+    }
+    /* the occupancy map skips empty slots left by flaky drivers */
+    if ((i = gpsd_sky_next(soa->occupied, 0)) >= 0) {
 	(void)strlcat(reply, "\"satellites\":[", replylen);
-	for (i = 0; i < reported; i++) {
-	    if (datap->skyview[i].PRN) {
-		str_appendf(reply, replylen,
-			       "{\"PRN\":%d,\"el\":%d,\"az\":%d,\"ss\":%.0f,\"used\":%s},",
-			       datap->skyview[i].PRN,
-			       datap->skyview[i].elevation,
-			       datap->skyview[i].azimuth,
-			       datap->skyview[i].ss,
-			       datap->skyview[i].used ? "true" : "false");
-	    }
+	for (; i >= 0; i = gpsd_sky_next(soa->occupied, i + 1)) {
+	    (void)strlcat(reply, soa->json[i], replylen);
+	    (void)strlcat(reply, ",", replylen);
 	}
 	str_rstrip_char(reply, ',');
 	(void)strlcat(reply, "]", replylen);
@@ -3367,7 +3395,7 @@ void json_att_dump(const struct gps_data_t *gpsdata,
 #endif /* COMPASS_ENABLE */
 
 void json_data_report(const gps_mask_t changed,
-		 const struct gps_device_t *session,
+		 struct gps_device_t *session,
 		 const struct policy_t *policy,
 		 char *buf, size_t buflen)
 /* report a session state in JSON */
@@ -3384,7 +3412,11 @@ void json_data_report(const gps_mask_t changed,
     }
 
     if ((changed & SATELLITE_SET) != 0) {
-	json_sky_dump(datap, buf+strlen(buf), buflen-strlen(buf));
+	/* cheap when the mirror is already current */
+	gpsd_skyview_update(session);
+	(void)json_sky_format(&session->skysoa);
+	json_sky_dump(datap, &session->skysoa,
+		      buf+strlen(buf), buflen-strlen(buf));
     }
 
     if ((changed & SUBFRAME_SET) != 0) {
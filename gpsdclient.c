@@ -6,11 +6,16 @@
  */
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdbool.h>
 #include <string.h>
 #include <strings.h>   /* for strcasecmp() */
 #include <time.h>      /* for time_t */
 #include <math.h>
 #include <assert.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
 #include "gpsd_config.h"
 #include "gps.h"
@@ -28,52 +33,93 @@ static struct exportmethod_t exportmethods[] = {
 #endif /* SOCKET_EXPORT_ENABLE */
 };
 
-/* convert double degrees to a static string and return a pointer to it
+/*
+ * Fixed-point digit emitters for the coordinate formatters.  They
+ * produce exactly what the corresponding printf conversions would for
+ * the non-negative values used here, without going through stdio.
+ */
+
+static char *put_padded(char *p, int v, int width, char pad)
+/* %<width>d, or %0<width>d with pad '0'; v >= 0 */
+{
+    char digits[12];
+    int n = 0;
+
+    do {
+	digits[n++] = (char)('0' + v % 10);
+	v /= 10;
+    } while (v > 0);
+    while (width-- > n)
+	*p++ = pad;
+    while (n > 0)
+	*p++ = digits[--n];
+    return p;
+}
+
+char *deg_to_str_r(enum deg_str_type type, double f, char *buf, size_t len)
+/*
+ * Convert degrees in [0, 360] to a string in a caller-supplied buffer
+ * and return buf.  Thread-safe; output is byte-for-byte what
+ * deg_to_str() has always produced.
  *
  * deg_str_type:
  *   	deg_dd     : return DD.dddddd
  *      deg_ddmm   : return DD MM.mmmm'
  *      deg_ddmmss : return DD MM' SS.sss"
- *
  */
-char *deg_to_str(enum deg_str_type type, double f)
 {
-    static char str[40];
-    int dsec, sec, deg, min;
-    long frac_deg;
-    double fdsec, fsec, fdeg, fmin;
+    char str[40], *p = str;
+    int deg, min, sec;
+    double fmin, fsec;
 
-    if (f < 0 || f > 360) {
-	(void)strlcpy(str, "nan", sizeof(str));
-	return str;
+    if (isnan(f) != 0 || f < 0 || f > 360) {
+	(void)strlcpy(buf, "nan", len);
+	return buf;
     }
 
-    fmin = modf(f, &fdeg);
-    deg = (int)fdeg;
-    frac_deg = (long)(fmin * 1000000);
+    /* for 0 <= f <= 360 these subtractions are exact, as modf() is */
+    deg = (int)f;
+    fmin = f - deg;
+    p = put_padded(p, deg, 3, ' ');
 
     if (deg_dd == type) {
 	/* DD.dddddd */
-	(void)snprintf(str, sizeof(str), "%3d.%06ld", deg, frac_deg);
-	return str;
-    }
-    fsec = modf(fmin * 60, &fmin);
-    min = (int)fmin;
-    sec = (int)(fsec * 10000.0);
-
-    if (deg_ddmm == type) {
-	/* DD MM.mmmm */
-	(void)snprintf(str, sizeof(str), "%3d %02d.%04d'", deg, min, sec);
-	return str;
+	*p++ = '.';
+	p = put_padded(p, (int)(long)(fmin * 1000000), 6, '0');
+    } else {
+	fmin *= 60;
+	min = (int)fmin;
+	fsec = fmin - min;
+	*p++ = ' ';
+	p = put_padded(p, min, 2, '0');
+	if (deg_ddmm == type) {
+	    /* DD MM.mmmm */
+	    *p++ = '.';
+	    p = put_padded(p, (int)(fsec * 10000.0), 4, '0');
+	    *p++ = '\'';
+	} else {
+	    /* DD MM SS.sss */
+	    fsec *= 60;
+	    sec = (int)fsec;
+	    *p++ = '\'';
+	    *p++ = ' ';
+	    p = put_padded(p, sec, 2, '0');
+	    *p++ = '.';
+	    p = put_padded(p, (int)((fsec - sec) * 1000.0), 3, '0');
+	    *p++ = '"';
+	}
     }
-    /* else DD MM SS.sss */
-    fdsec = modf(fsec * 60, &fsec);
-    sec = (int)fsec;
-    dsec = (int)(fdsec * 1000.0);
-    (void)snprintf(str, sizeof(str), "%3d %02d' %02d.%03d\"", deg, min, sec,
-		   dsec);
-
-    return str;
+    *p = '\0';
+    (void)strlcpy(buf, str, len);
+    return buf;
+}
+
+char *deg_to_str(enum deg_str_type type, double f)
+/* convert double degrees to a static string and return a pointer to it */
+{
+    static char str[40];
+
+    return deg_to_str_r(type, f, str, sizeof(str));
 }
 
 /*
@@ -181,8 +227,8 @@ void gpsd_source_spec(const char *arg, struct fixsource_t *source)
 }
 
 
-char *maidenhead(double n, double e)
-/* lat/lon to Maidenhead */
+char *maidenhead_r(double n, double e, char *buf, size_t len)
+/* lat/lon to Maidenhead, in a caller buffer of at least 7 bytes */
 {
     /*
      * Specification at
@@ -201,9 +247,13 @@ char *maidenhead(double n, double e)
      *    round down from the cast). If I'm reading the spec right it
      *    is not correct to do this.
      */
-    static char buf[7];
-
     int t1;
+
+    if (len < MAIDENHEAD_LEN) {
+	if (len > 0)
+	    buf[0] = '\0';
+	return buf;
+    }
     e=e+180.0;
     t1=(int)(e/20);
     buf[0]=(char)t1+'A';
@@ -226,6 +276,14 @@ char *maidenhead(double n, double e)
     return buf;
 }
 
+char *maidenhead(double n, double e)
+/* lat/lon to Maidenhead, in a static buffer */
+{
+    static char buf[MAIDENHEAD_LEN];
+
+    return maidenhead_r(n, e, buf, sizeof(buf));
+}
+
 #define NITEMS(x) (int)(sizeof(x)/sizeof(x[0])) /* from gpsd.h-tail */
 
 struct exportmethod_t *export_lookup(const char *name)
@@ -257,6 +315,292 @@ struct exportmethod_t *export_default(void)
     return (NITEMS(exportmethods) > 0) ? &exportmethods[0] : NULL;
 }
 
+/*
+ * World Magnetic Model.
+ *
+ * If $GPSD_WMM_COF names a coefficient file in NOAA's WMM.COF format,
+ * true2magnetic() works anywhere on Earth.  Evaluating the spherical
+ * harmonic expansion takes a few hundred multiplications, so on first
+ * use declination is computed for the current date on a one-degree
+ * grid and each call just interpolates that.  If $GPSD_WMM_CACHE
+ * names a file, the grid is kept there and later runs map it in
+ * rather than recompute it; it is rebuilt when the model or the date
+ * (to within a month) no longer matches.
+ */
+
+#define WMM_NMAX	12
+#define WMM_ROWS	181		/* latitude -90..90 */
+#define WMM_COLS	361		/* longitude -180..180 */
+#define WMM_MAGIC	"GPSDWMM1"
+
+struct wmm_model_t {
+    double epoch;			/* decimal year of the coefficients */
+    int nmax;
+    /* Schmidt semi-normalized by wmm_load(), in nT and nT/year */
+    double g[WMM_NMAX + 1][WMM_NMAX + 1], h[WMM_NMAX + 1][WMM_NMAX + 1];
+    double gdot[WMM_NMAX + 1][WMM_NMAX + 1], hdot[WMM_NMAX + 1][WMM_NMAX + 1];
+};
+
+struct wmm_grid_t {
+    char magic[8];			/* WMM_MAGIC, not NUL-terminated */
+    double epoch;			/* of the model it was built from */
+    double year;			/* date it was evaluated for */
+    float decl[WMM_ROWS * WMM_COLS];	/* degrees, east positive */
+};
+
+static const struct wmm_grid_t *wmm_grid;
+static bool wmm_tried;
+
+static bool wmm_load(const char *path, struct wmm_model_t *wmm)
+/* read a WMM.COF coefficient file */
+{
+    char line[BUFSIZ];
+    double schmidt[WMM_NMAX + 1][WMM_NMAX + 1];
+    int n, m;
+    FILE *fp;
+
+    if ((fp = fopen(path, "r")) == NULL)
+	return false;
+    memset(wmm, '\0', sizeof(*wmm));
+    if (fgets(line, sizeof(line), fp) == NULL
+	|| sscanf(line, "%lf", &wmm->epoch) != 1) {
+	(void)fclose(fp);
+	return false;
+    }
+    while (fgets(line, sizeof(line), fp) != NULL) {
+	double g, h, gdot, hdot;
+
+	if (strncmp(line, "9999", 4) == 0)
+	    break;
+	if (sscanf(line, "%d %d %lf %lf %lf %lf",
+		   &n, &m, &g, &h, &gdot, &hdot) != 6
+	    || n < 1 || n > WMM_NMAX || m < 0 || m > n)
+	    continue;
+	wmm->g[n][m] = g;
+	wmm->h[n][m] = h;
+	wmm->gdot[n][m] = gdot;
+	wmm->hdot[n][m] = hdot;
+	if (n > wmm->nmax)
+	    wmm->nmax = n;
+    }
+    (void)fclose(fp);
+    if (wmm->nmax == 0)
+	return false;
+
+    /* fold the Schmidt factors into the coefficients once */
+    schmidt[0][0] = 1.0;
+    for (n = 1; n <= wmm->nmax; n++) {
+	schmidt[n][0] = schmidt[n - 1][0] * (2 * n - 1) / n;
+	for (m = 1; m <= n; m++)
+	    schmidt[n][m] = schmidt[n][m - 1]
+		* sqrt((double)((n - m + 1) * (m == 1 ? 2 : 1)) / (n + m));
+	for (m = 0; m <= n; m++) {
+	    wmm->g[n][m] *= schmidt[n][m];
+	    wmm->h[n][m] *= schmidt[n][m];
+	    wmm->gdot[n][m] *= schmidt[n][m];
+	    wmm->hdot[n][m] *= schmidt[n][m];
+	}
+    }
+    return true;
+}
+
+static void wmm_row(const struct wmm_model_t *wmm, double year,
+		    double lat, float *decl)
+/* declination at sea level along one parallel, one-degree steps */
+{
+    /* WGS84 ellipsoid and the model's reference radius, km */
+    const double a = 6378.137, b = 6356.7523142, re = 6371.2;
+    const double a2 = a * a, b2 = b * b, c2 = a2 - b2;
+    const double a4 = a2 * a2, c4 = a4 - b2 * b2;
+    double P[WMM_NMAX + 1][WMM_NMAX + 1], dP[WMM_NMAX + 1][WMM_NMAX + 1];
+    double g[WMM_NMAX + 1][WMM_NMAX + 1], h[WMM_NMAX + 1][WMM_NMAX + 1];
+    double arn[WMM_NMAX + 1];
+    double slat, clat, q, ct, st, r, d, ca, sa, dt = year - wmm->epoch;
+    int n, m, col;
+
+    /* the field is singular at the poles */
+    if (lat > 89.99)
+	lat = 89.99;
+    else if (lat < -89.99)
+	lat = -89.99;
+
+    /* geodetic to geocentric */
+    slat = sin(lat * DEG_2_RAD);
+    clat = cos(lat * DEG_2_RAD);
+    q = sqrt(a2 - c2 * slat * slat);
+    ct = slat / sqrt((a2 / b2) * (a2 / b2) * clat * clat + slat * slat);
+    st = sqrt(1.0 - ct * ct);
+    r = sqrt((a4 - c4 * slat * slat) / (q * q));
+    d = sqrt(a2 * clat * clat + b2 * slat * slat);
+    ca = d / r;
+    sa = c2 * clat * slat / (r * d);
+
+    /* Gauss-normalized associated Legendre functions and derivatives */
+    P[0][0] = 1.0;
+    dP[0][0] = 0.0;
+    for (n = 1; n <= wmm->nmax; n++)
+	for (m = 0; m <= n; m++) {
+	    if (n == m) {
+		P[n][m] = st * P[n - 1][m - 1];
+		dP[n][m] = st * dP[n - 1][m - 1] + ct * P[n - 1][m - 1];
+	    } else {
+		double k = (n == 1) ? 0.0 :
+		    (double)((n - 1) * (n - 1) - m * m)
+		    / ((2 * n - 1) * (2 * n - 3));
+
+		P[n][m] = ct * P[n - 1][m] - (n > 1 ? k * P[n - 2][m] : 0);
+		dP[n][m] = ct * dP[n - 1][m] - st * P[n - 1][m]
+		    - (n > 1 ? k * dP[n - 2][m] : 0);
+	    }
+	}
+
+    arn[0] = (re / r) * (re / r);
+    for (n = 1; n <= wmm->nmax; n++) {
+	arn[n] = arn[n - 1] * (re / r);
+	for (m = 0; m <= n; m++) {
+	    g[n][m] = wmm->g[n][m] + dt * wmm->gdot[n][m];
+	    h[n][m] = wmm->h[n][m] + dt * wmm->hdot[n][m];
+	}
+    }
+
+    for (col = 0; col < WMM_COLS; col++) {
+	double lon = (col - 180) * DEG_2_RAD;
+	double cm[WMM_NMAX + 1], sm[WMM_NMAX + 1];
+	double br = 0, bt = 0, bp = 0;
+
+	cm[0] = 1.0;
+	sm[0] = 0.0;
+	cm[1] = cos(lon);
+	sm[1] = sin(lon);
+	for (m = 2; m <= wmm->nmax; m++) {
+	    cm[m] = cm[m - 1] * cm[1] - sm[m - 1] * sm[1];
+	    sm[m] = sm[m - 1] * cm[1] + cm[m - 1] * sm[1];
+	}
+	for (n = 1; n <= wmm->nmax; n++)
+	    for (m = 0; m <= n; m++) {
+		double t = g[n][m] * cm[m] + h[n][m] * sm[m];
+
+		br += arn[n] * (n + 1) * t * P[n][m];
+		bt -= arn[n] * t * dP[n][m];
+		bp += arn[n] * m * (g[n][m] * sm[m] - h[n][m] * cm[m]) * P[n][m];
+	    }
+	bp /= st;
+	/* north is -bt, east is bp; rotate north back to geodetic */
+	decl[col] = (float)(atan2(bp, -bt * ca - br * sa) * RAD_2_DEG);
+    }
+}
+
+static double wmm_year(void)
+/* the current date as a decimal year */
+{
+    return 1970.0 + (double)time(NULL) / (365.25 * 86400);
+}
+
+static const struct wmm_grid_t *wmm_map(const char *path, double epoch,
+					double year)
+/* map a cached grid, if it is there and still current */
+{
+    struct wmm_grid_t *grid;
+    struct stat sb;
+    int fd;
+
+    if ((fd = open(path, O_RDONLY)) == -1)
+	return NULL;
+    if (fstat(fd, &sb) == -1 || sb.st_size != (off_t)sizeof(*grid)) {
+	(void)close(fd);
+	return NULL;
+    }
+    grid = mmap(NULL, sizeof(*grid), PROT_READ, MAP_SHARED, fd, 0);
+    (void)close(fd);
+    if (grid == MAP_FAILED)
+	return NULL;
+    if (memcmp(grid->magic, WMM_MAGIC, sizeof(grid->magic)) != 0
+	|| grid->epoch != epoch || fabs(grid->year - year) > 1.0 / 12) {
+	(void)munmap(grid, sizeof(*grid));
+	return NULL;
+    }
+    return grid;
+}
+
+static const struct wmm_grid_t *wmm_get_grid(void)
+/* build or map the declination grid on first use; NULL if no model */
+{
+    const char *cof = getenv("GPSD_WMM_COF");
+    const char *cache = getenv("GPSD_WMM_CACHE");
+    struct wmm_model_t wmm;
+    struct wmm_grid_t *grid;
+    double year;
+    int row;
+
+    if (wmm_tried)
+	return wmm_grid;
+    wmm_tried = true;
+    if (cof == NULL || !wmm_load(cof, &wmm))
+	return NULL;
+    year = wmm_year();
+
+    if (cache != NULL && (wmm_grid = wmm_map(cache, wmm.epoch, year)) != NULL)
+	return wmm_grid;
+
+    if ((grid = malloc(sizeof(*grid))) == NULL)
+	return NULL;
+    memcpy(grid->magic, WMM_MAGIC, sizeof(grid->magic));
+    grid->epoch = wmm.epoch;
+    grid->year = year;
+    for (row = 0; row < WMM_ROWS; row++)
+	wmm_row(&wmm, year, (double)(row - 90), grid->decl + row * WMM_COLS);
+    wmm_grid = grid;
+
+    if (cache != NULL) {
+	char tmp[BUFSIZ];
+	int fd;
+
+	/* write then rename, so a concurrent reader never maps half a grid */
+	(void)snprintf(tmp, sizeof(tmp), "%s.%ld", cache, (long)getpid());
+	if ((fd = open(tmp, O_WRONLY | O_CREAT | O_TRUNC, 0644)) != -1) {
+	    bool ok = write(fd, grid, sizeof(*grid)) == (ssize_t)sizeof(*grid);
+
+	    (void)close(fd);
+	    if (ok && rename(tmp, cache) == 0
+		&& (wmm_grid = wmm_map(cache, grid->epoch, year)) != NULL)
+		free(grid);
+	    else {
+		(void)unlink(tmp);
+		wmm_grid = grid;
+	    }
+	}
+    }
+    return wmm_grid;
+}
+
+static double wmm_declination(const struct wmm_grid_t *grid,
+			      double lat, double lon)
+/* interpolate the grid; lat/lon must be in range */
+{
+    double y = lat + 90.0, x = lon + 180.0, fy, fx, d00, d01, d10, d11;
+    int row = (int)y, col = (int)x;
+
+    if (row > WMM_ROWS - 2)
+	row = WMM_ROWS - 2;
+    if (col > WMM_COLS - 2)
+	col = WMM_COLS - 2;
+    fy = y - row;
+    fx = x - col;
+    d00 = grid->decl[row * WMM_COLS + col];
+    d01 = grid->decl[row * WMM_COLS + col + 1];
+    d10 = grid->decl[(row + 1) * WMM_COLS + col];
+    d11 = grid->decl[(row + 1) * WMM_COLS + col + 1];
+    /* don't average across the +-180 wrap near the magnetic poles */
+    if (fabs(d01 - d00) > 180)
+	d01 += (d01 < d00) ? 360 : -360;
+    if (fabs(d10 - d00) > 180)
+	d10 += (d10 < d00) ? 360 : -360;
+    if (fabs(d11 - d00) > 180)
+	d11 += (d11 < d00) ? 360 : -360;
+    return (d00 * (1 - fx) + d01 * fx) * (1 - fy)
+	+ (d10 * (1 - fx) + d11 * fx) * fy;
+}
+
 /* Convert true heading to magnetic.  Taken from the Aviation
    Formulary v1.43.  Valid to within two degrees within the
    continiental USA except for the following airports: MO49 MO86 MO50
@@ -273,11 +617,20 @@ struct exportmethod_t *export_default(void)
    off.  A better way to communicate this to the user is probably
    desirable (in case the don't notice the subtle change from "(mag)"
    to "(true)" on their display).
+
+   All of the above applies only when no World Magnetic Model is
+   configured; with one, the conversion is good everywhere.
  */
 float true2magnetic(double lat, double lon, double heading)
 {
+    const struct wmm_grid_t *grid = wmm_get_grid();
+
+    if (grid != NULL && lat >= -90.0 && lat <= 90.0
+	&& lon >= -180.0 && lon <= 180.0) {
+	heading -= wmm_declination(grid, lat, lon);
+    }
     /* Western Europe */
-    if ((lat > 36.0) && (lat < 68.0) && (lon > -10.0) && (lon < 28.0)) {
+    else if ((lat > 36.0) && (lat < 68.0) && (lon > -10.0) && (lon < 28.0)) {
 	heading =
 	    (10.4768771667158 - (0.507385322418858 * lon) +
 	     (0.00753170031703826 * pow(lon, 2))
@@ -319,6 +672,8 @@ float true2magnetic(double lat, double lon, double heading)
     /* No negative headings. */
     if (isnan(heading)== 0 && heading < 0.0)
 	heading += 360.0;
+    else if (isnan(heading) == 0 && heading >= 360.0)
+	heading -= 360.0;
 
     return (heading);
 }
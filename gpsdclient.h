@@ -35,11 +35,14 @@ enum deg_str_type { deg_dd, deg_ddmm, deg_ddmmss };
 float true2magnetic(double, double, double);
 
 extern char *deg_to_str( enum deg_str_type type,  double f);
+extern char *deg_to_str_r(enum deg_str_type, double, char *, size_t);
 
 extern void gpsd_source_spec(const char *fromstring,
 			     struct fixsource_t *source);
 
 char *maidenhead(double n,double e);
+#define MAIDENHEAD_LEN	7	/* six characters and a NUL */
+char *maidenhead_r(double, double, char *, size_t);
 
 /* this needs to match JSON_DATE_MAX in gpsd.h */
 #define CLIENT_DATE_MAX	24
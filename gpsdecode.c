@@ -7,12 +7,15 @@
 #include <stdbool.h>
 #include <string.h>
 #include <stdarg.h>
+#include <errno.h>
 #include <unistd.h>
+#include <sys/wait.h>
 
 #include "gpsd.h"
 #include "bits.h"
 #include "gps_json.h"
 #include "strfuncs.h"
+#include "capture.h"
 
 static int verbose = 0;
 static bool scaled = true;
@@ -561,6 +564,7 @@ static void decode(FILE *fpin, FILE*fpout)
     //This looks like a good idea, but it breaks regression tests
     //(void)strlcpy(session.gpsdata.dev.path, "stdin", sizeof(session.gpsdata.dev.path));
     memset(&policy, '\0', sizeof(policy));
+    memset(&session, '\0', sizeof(session));
     policy.json = json;
     policy.scaled = scaled;
     policy.nmea = pseudonmea;
@@ -568,7 +572,12 @@ static void decode(FILE *fpin, FILE*fpout)
     gpsd_time_init(&context, time(NULL));
     context.readonly = true;
     gpsd_init(&session, &context, NULL);
+    if (!gpsd_device_storage(&session)) {
+	(void)fputs("gpsdecode: out of memory\n", stderr);
+	exit(EXIT_FAILURE);
+    }
     gpsd_clear(&session);
+    gpsd_skyview_reset(&session);
     session.gpsdata.gps_fd = fileno(fpin);
     session.gpsdata.dev.baudrate = 38400;     /* hack to enable subframes */
     (void)strlcpy(session.gpsdata.dev.path,
@@ -644,6 +653,54 @@ static void decode(FILE *fpin, FILE*fpout)
     }
 }
 
+static FILE *replay(const char *path, const char *begin, const char *end,
+		    double speed)
+/*
+ * Play the packets of a capture, from begin to end, into a pipe for
+ * decode() to read; a child does the writing so the original timing
+ * can be kept.
+ */
+{
+    struct capture_t cap;
+    int64_t from = 0, to = 0;
+    int pfd[2];
+
+    if (!capture_open(&cap, path)) {
+	(void)fprintf(stderr, "gpsdecode: can't read capture %s: %s\n",
+		      path, strerror(errno));
+	exit(EXIT_FAILURE);
+    }
+    if ((begin != NULL && !capture_parse_time(begin, &cap, &from))
+	|| (end != NULL && !capture_parse_time(end, &cap, &to))) {
+	(void)fprintf(stderr, "gpsdecode: bad time, use +seconds, "
+		      "seconds since the epoch or ISO8601 UTC\n");
+	exit(EXIT_FAILURE);
+    }
+    if (begin != NULL && !capture_seek(&cap, from)) {
+	(void)fprintf(stderr, "gpsdecode: nothing in %s after %s\n",
+		      path, begin);
+	exit(EXIT_SUCCESS);
+    }
+    if (pipe(pfd) == -1) {
+	(void)fprintf(stderr, "gpsdecode: pipe: %s\n", strerror(errno));
+	exit(EXIT_FAILURE);
+    }
+    switch (fork()) {
+    case -1:
+	(void)fprintf(stderr, "gpsdecode: fork: %s\n", strerror(errno));
+	exit(EXIT_FAILURE);
+    case 0:
+	(void)close(pfd[0]);
+	_exit(capture_replay(&cap, pfd[1], to, speed) < 0
+	      ? EXIT_FAILURE : EXIT_SUCCESS);
+    default:
+	break;
+    }
+    (void)close(pfd[1]);
+    capture_close(&cap);
+    return fdopen(pfd[0], "r");
+}
+
 #ifdef SOCKET_EXPORT_ENABLE
 static void encode(FILE *fpin, FILE *fpout)
 /* JSON format on fpin to JSON on fpout - idempotency test */
@@ -692,10 +749,12 @@ int main(int argc, char **argv)
 {
     int c;
     enum { doencode, dodecode } mode = dodecode;
+    char *capfile = NULL, *begin = NULL, *end = NULL;
+    double speed = 0;
 
     gps_context_init(&context, "gpsdecode");
 
-    while ((c = getopt(argc, argv, "cdejmnpst:uvVD:")) != EOF) {
+    while ((c = getopt(argc, argv, "cdejmnpst:uvVD:C:B:E:x:")) != EOF) {
 	switch (c) {
 	case 'c':
 	    json = false;
@@ -755,6 +814,22 @@ int main(int argc, char **argv)
 	    (void)fprintf(stderr, "gpsdecode revision " VERSION "\n");
 	    exit(EXIT_SUCCESS);
 
+	case 'C':
+	    capfile = optarg;
+	    break;
+
+	case 'B':
+	    begin = optarg;
+	    break;
+
+	case 'E':
+	    end = optarg;
+	    break;
+
+	case 'x':
+	    speed = atof(optarg);
+	    break;
+
 	case '?':
 	default:
 	    (void)fputs("gpsdecode [-v]\n", stderr);
@@ -771,6 +846,13 @@ int main(int argc, char **argv)
 	(void)fprintf(stderr, "gpsdecode: encoding support isn't compiled.\n");
 	exit(EXIT_FAILURE);
 #endif /* SOCKET_EXPORT_ENABLE */
+    } else if (capfile != NULL) {
+	int status;
+
+	decode(replay(capfile, begin, end, speed), stdout);
+	if (wait(&status) != -1 && (!WIFEXITED(status)
+				    || WEXITSTATUS(status) != EXIT_SUCCESS))
+	    exit(EXIT_FAILURE);
     } else
 	decode(stdin, stdout);
     exit(EXIT_SUCCESS);
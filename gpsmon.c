@@ -1257,6 +1257,10 @@ int main(int argc, char **argv)
 
     gpsd_time_init(&context, time(NULL));
     gpsd_init(&session, &context, NULL);
+    if (!gpsd_device_storage(&session)) {
+	(void)fputs("gpsmon: out of memory\n", stderr);
+	exit(EXIT_FAILURE);
+    }
 
     /* Grok the server, port, and device. */
     if (optind < argc) {
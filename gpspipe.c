@@ -23,6 +23,9 @@
  *
  */
 
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE		/* for O_DIRECT */
+#endif /* _GNU_SOURCE */
 #include <time.h>               /* for time_t */
 #include "gpsd_config.h"
 
@@ -34,6 +37,7 @@
 #include <strings.h>
 #include <fcntl.h>
 #include <termios.h>
+#include <signal.h>
 #include <sys/time.h>
 #include <sys/types.h>
 #include <sys/stat.h>
@@ -45,9 +49,12 @@
 #include "gpsd_config.h"
 #include "gpsdclient.h"
 #include "revision.h"
+#include "capture.h"
+#include "strfuncs.h"
 
 static struct gps_data_t gpsdata;
 static void spinner(unsigned int, unsigned int);
+static void capture_begin(FILE *, const char *);
 
 /* NMEA-0183 standard baud rate */
 #define BAUDRATE B4800
@@ -58,6 +65,43 @@ static int fd_out = 1;		/* output initially goes to standard output */
 static char serbuf[255];
 static int debug;
 
+/*
+ * Recorder mode: output collects in a large aligned buffer that goes to
+ * the file in whole blocks, bypassing stdio, and the file is rotated by
+ * size or age.  Meant for recording a feed around the clock.
+ */
+#define RECORD_ALIGN	4096		/* block size for writes */
+#define RECORD_BUFSIZE	(1024 * 1024)	/* default buffer size */
+#define RECORD_IDLE	1		/* seconds before a partial flush */
+static struct {
+    bool active;
+    const char *path;		/* the live file; finished ones get a suffix */
+    int fd;
+    bool direct;		/* write with O_DIRECT */
+    char *buf;			/* RECORD_ALIGN aligned */
+    size_t size, len;
+    off_t written;		/* bytes in the current file so far */
+    off_t maxsize;		/* rotate past this size, 0 = never */
+    time_t interval;		/* rotate at multiples of this, 0 = never */
+    time_t opened, next_rotate, flushed;
+    char *compress;		/* command run on every finished file */
+} rec;
+
+/* capture mode: framed, timestamped records and an index; see capture.h */
+static bool capture;
+static struct capture_index_t capidx;
+static char capline[65536];	/* the line being assembled */
+static size_t caplen;
+static struct timespec capmono, capreal;	/* when it started arriving */
+
+/* set by a termination signal, acted on in the main loop */
+static volatile sig_atomic_t signalled;
+
+static void onsig(int sig)
+{
+    signalled = (sig_atomic_t)sig;
+}
+
 static void open_serial(char *device)
 /* open the serial port and set it up */
 {
@@ -92,6 +136,377 @@ static void open_serial(char *device)
     }
 }
 
+static void record_open(void)
+/* start a new live file; never over one that failed to move away */
+{
+    int oflags = O_WRONLY | O_CREAT | O_EXCL;
+
+#ifdef O_DIRECT
+    if (rec.direct)
+	oflags |= O_DIRECT;
+#endif /* O_DIRECT */
+    if ((rec.fd = open(rec.path, oflags, 0644)) == -1) {
+	(void)fprintf(stderr, "gpspipe: unable to open output file %s, %s(%d)\n",
+		      rec.path, strerror(errno), errno);
+	exit(EXIT_FAILURE);
+    }
+    rec.written = 0;
+    rec.opened = rec.flushed = time(NULL);
+    if (rec.interval > 0)
+	rec.next_rotate = (rec.opened / rec.interval + 1) * rec.interval;
+    if (capture)
+	capture_begin(NULL, rec.path);
+}
+
+static void record_flush(bool all)
+/*
+ * Write out the buffer.  With O_DIRECT only whole blocks can go, so
+ * unless this is the end of the file the tail stays behind.
+ */
+{
+    size_t n = rec.len;
+    char *cp;
+
+    if (rec.direct && !all)
+	n -= n % RECORD_ALIGN;
+#ifdef O_DIRECT
+    if (rec.direct && all && n % RECORD_ALIGN != 0)
+	/* the last, partial, block of the file */
+	(void)fcntl(rec.fd, F_SETFL, fcntl(rec.fd, F_GETFL) & ~O_DIRECT);
+#endif /* O_DIRECT */
+    for (cp = rec.buf; cp < rec.buf + n;) {
+	ssize_t w = write(rec.fd, cp, (size_t)(rec.buf + n - cp));
+
+	if (w == -1) {
+	    if (errno == EINTR)
+		continue;
+	    (void)fprintf(stderr, "gpspipe: write error, %s(%d)\n",
+			  strerror(errno), errno);
+	    exit(EXIT_FAILURE);
+	}
+	cp += w;
+    }
+    rec.written += (off_t)n;
+    rec.len -= n;
+    if (rec.len > 0)
+	memmove(rec.buf, rec.buf + n, rec.len);
+    rec.flushed = time(NULL);
+}
+
+static void record_write(const char *data, size_t len)
+/* add to the buffer, writing out full ones */
+{
+    while (len > 0) {
+	size_t n = rec.size - rec.len;
+
+	if (n > len)
+	    n = len;
+	memcpy(rec.buf + rec.len, data, n);
+	rec.len += n;
+	data += n;
+	len -= n;
+	if (rec.len == rec.size)
+	    record_flush(false);
+    }
+}
+
+static void record_stow(time_t opened)
+/* move the closed live file, and any index, to a dated name */
+{
+    char done[GPS_PATH_MAX + 32];
+    char idxfrom[GPS_PATH_MAX + 8], idxto[sizeof(done) + 8];
+    struct tm tm;
+    size_t n;
+    int i;
+
+    (void)snprintf(done, sizeof(done), "%s.", rec.path);
+    n = strlen(done);
+    (void)strftime(done + n, sizeof(done) - n, "%Y%m%dT%H%M%SZ",
+		   gmtime_r(&opened, &tm));
+    /* rotating by size can make more than one file a second */
+    n = strlen(done);
+    for (i = 1; access(done, F_OK) == 0; i++)
+	(void)snprintf(done + n, sizeof(done) - n, ".%d", i);
+    /* the index goes along, under the matching name */
+    (void)snprintf(idxfrom, sizeof(idxfrom), "%s.idx", rec.path);
+    (void)snprintf(idxto, sizeof(idxto), "%s.idx", done);
+    (void)rename(idxfrom, idxto);
+    if (rename(rec.path, done) != 0)
+	(void)fprintf(stderr, "gpspipe: can't rename %s to %s, %s(%d)\n",
+		      rec.path, done, strerror(errno), errno);
+    else if (rec.compress != NULL) {
+	/* compress in the background; SIGCHLD is ignored, no zombies */
+	switch (fork()) {
+	case -1:
+	    (void)fprintf(stderr, "gpspipe: can't fork compressor, %s(%d)\n",
+			  strerror(errno), errno);
+	    break;
+	case 0: {
+	    char script[BUFSIZ];
+
+	    (void)snprintf(script, sizeof(script), "%s \"$1\"", rec.compress);
+	    (void)execl("/bin/sh", "sh", "-c", script, "gpspipe", done,
+			(char *)NULL);
+	    _exit(127);
+	}
+	default:
+	    break;
+	}
+    }
+}
+
+static void record_retire(void)
+/* finish the live file and move it to a dated name */
+{
+    record_flush(true);
+    (void)close(rec.fd);
+    if (capture)
+	capture_index_close(&capidx);
+    record_stow(rec.opened);
+}
+
+static void record_recover(void)
+/*
+ * A live file already there was left by a crash, SIGKILL or power
+ * loss.  Retire it under the time of its last write rather than
+ * truncating it, since when it was started is not known.
+ */
+{
+    struct stat sb;
+
+    if (stat(rec.path, &sb) != 0)
+	return;
+    (void)fprintf(stderr, "gpspipe: retiring %s left by an earlier run\n",
+		  rec.path);
+    record_stow(sb.st_mtime);
+}
+
+static void record_rotate(void)
+/* retire the live file and start another */
+{
+    record_retire();
+    record_open();
+}
+
+static void record_close(void)
+/*
+ * Flush what is left, including a partial O_DIRECT block, and retire
+ * the file; registered with atexit() and called on a signal.
+ */
+{
+    if (rec.active) {
+	/* a write error exiting from here must not bring us back */
+	rec.active = false;
+	record_retire();
+    }
+}
+
+static void record_tick(time_t now, bool boundary)
+/*
+ * Rotation on age, when at a boundary between lines, and making sure a
+ * slow feed still reaches the disk.
+ */
+{
+    if (boundary && rec.interval > 0 && now >= rec.next_rotate)
+	record_rotate();
+    else if (rec.len > 0 && now - rec.flushed >= RECORD_IDLE)
+	record_flush(false);
+}
+
+static off_t record_size(const char *arg)
+/* parse a size with optional k, M or G suffix */
+{
+    char *end;
+    double size = strtod(arg, &end);
+
+    switch (*end) {
+    case 'k':
+    case 'K':
+	size *= 1024;
+	break;
+    case 'm':
+    case 'M':
+	size *= 1024 * 1024;
+	break;
+    case 'g':
+    case 'G':
+	size *= 1024 * 1024 * 1024;
+	break;
+    }
+    return (off_t)size;
+}
+
+static const char *stamp(const char *format, int option_u)
+/*
+ * Time stamp for the start of a line.  strftime() has nothing finer
+ * than seconds, so its output is cached and redone only when the
+ * second changes; the microseconds are filled in by hand.
+ */
+{
+    static char tmstr[256];
+    static time_t cached = -1;
+    static size_t fixed;	/* length of the per-second part */
+    struct timespec now;
+    long usec;
+    char *cp;
+    int i;
+
+    (void)clock_gettime(CLOCK_REALTIME, &now);
+    if (now.tv_sec != cached) {
+	struct tm tm;
+
+	(void)localtime_r(&now.tv_sec, &tm);
+	fixed = strftime(tmstr, 25, format, &tm);
+	if (fixed == 0 && strlen(format) > 0) {
+	    /* too long for the 24 characters we print; truncate like %.24s */
+	    char full[200];
+
+	    (void)strftime(full, sizeof(full), format, &tm);
+	    (void)strlcpy(tmstr, full, 25);
+	    fixed = strlen(tmstr);
+	}
+	if (option_u == 2)
+	    fixed += (size_t)snprintf(tmstr + fixed, sizeof(tmstr) - fixed,
+				      " %ld.", (long)now.tv_sec);
+	else if (option_u == 1)
+	    tmstr[fixed++] = '.';
+	cached = now.tv_sec;
+    }
+
+    cp = tmstr + fixed;
+    if (option_u > 0) {
+	usec = (long)now.tv_nsec / 1000;
+	for (i = 5; i >= 0; i--) {
+	    cp[i] = (char)('0' + usec % 10);
+	    usec /= 10;
+	}
+	cp += 6;
+    }
+    *cp++ = ':';
+    *cp++ = ' ';
+    *cp = '\0';
+    return tmstr;
+}
+
+static void output(FILE *fp, const char *data, size_t len)
+/* emit a piece of a line */
+{
+    if (rec.active)
+	record_write(data, len);
+    else if (fwrite(data, 1, len, fp) != len) {
+	(void)fprintf(stderr, "gpspipe: write error, %s(%d)\n",
+		      strerror(errno), errno);
+	exit(EXIT_FAILURE);
+    }
+}
+
+#define TS_NS(ts)	((int64_t)(ts).tv_sec * 1000000000LL + (ts).tv_nsec)
+
+static void capture_begin(FILE *fp, const char *path)
+/* file header and a fresh index for a new output file */
+{
+    unsigned char hdr[CAPTURE_HEADER_LEN];
+    struct timespec now;
+
+    (void)clock_gettime(CLOCK_REALTIME, &now);
+    capture_file_header(hdr, TS_NS(now));
+    output(fp, (char *)hdr, sizeof(hdr));
+    if (!capture_index_open(&capidx, path))
+	(void)fprintf(stderr, "gpspipe: can't write index for %s, %s(%d)\n",
+		      path, strerror(errno), errno);
+}
+
+static void capture_emit(FILE *fp, const char *data, size_t len, int type)
+/* write one record stamped with capmono/capreal */
+{
+    unsigned char hdr[CAPTURE_RECORD_LEN + CAPTURE_DEVICE_MAX];
+    char device[CAPTURE_DEVICE_MAX] = "";
+    uint64_t offset;
+    size_t n;
+
+    /* watch-mode JSON names its device; NMEA does not */
+    if (type == JSON_PACKET) {
+	const char *dp = strstr(data, "\"device\":\"");
+
+	if (dp != NULL && dp < data + len) {
+	    for (dp += 10, n = 0;
+		 dp < data + len && *dp != '"' && n < sizeof(device) - 1; )
+		device[n++] = *dp++;
+	    device[n] = '\0';
+	}
+    }
+    offset = rec.active ? (uint64_t)(rec.written + (off_t)rec.len)
+			: (uint64_t)ftello(fp);
+    capture_index_note(&capidx, TS_NS(capreal), offset);
+    n = capture_record_header(hdr, TS_NS(capmono), TS_NS(capreal),
+			      type, device, len);
+    output(fp, (char *)hdr, n);
+    output(fp, data, len);
+}
+
+static void capture_add(FILE *fp, const char *data, size_t len, bool eol)
+/* collect a line, which may come in pieces, into one record */
+{
+    if (caplen == 0) {
+	(void)clock_gettime(CLOCK_MONOTONIC, &capmono);
+	(void)clock_gettime(CLOCK_REALTIME, &capreal);
+    }
+    if (caplen + len > sizeof(capline) - 1) {
+	/* absurdly long; let it out as it is */
+	capture_emit(fp, capline, caplen, BAD_PACKET);
+	caplen = 0;
+	if (len > sizeof(capline) - 1) {
+	    capture_emit(fp, data, len, BAD_PACKET);
+	    return;
+	}
+    }
+    memcpy(capline + caplen, data, len);
+    caplen += len;
+    if (eol) {
+	int type;
+
+	capline[caplen] = '\0';
+	switch (capline[0]) {
+	case '{':
+	    type = JSON_PACKET;
+	    break;
+	case '$':
+	    type = NMEA_PACKET;
+	    break;
+	case '!':
+	    type = AIVDM_PACKET;
+	    break;
+	case '#':
+	    type = COMMENT_PACKET;
+	    break;
+	default:
+	    type = BAD_PACKET;
+	    break;
+	}
+	capture_emit(fp, capline, caplen, type);
+	caplen = 0;
+    }
+}
+
+static void finish(FILE *fp)
+/* on a signal, get everything received so far out before exiting */
+{
+    if (capture && caplen > 0) {
+	/* the line never completed; keep what arrived of it */
+	capture_emit(fp, capline, caplen, BAD_PACKET);
+	caplen = 0;
+    }
+    if (rec.active)
+	record_close();
+    else {
+	if (fp != NULL)
+	    (void)fflush(fp);
+	if (capture)
+	    capture_index_close(&capidx);
+    }
+    exit(EXIT_SUCCESS);
+}
+
 static void usage(void)
 {
     (void)fprintf(stderr,
@@ -110,20 +525,25 @@ static void usage(void)
 		  "-u usec time stamp, implies -t. Use -uu to output sec.usec\n"
 		  "-s [serial dev] emulate a 4800bps NMEA GPS on serial port (use with '-r').\n"
 		  "-n [count] exit after count packets.\n"
+		  "-B [size] recorder mode: write to the -o file in blocks of size.\n"
+		  "-m [size] rotate the -o file when it reaches size (k, M, G).\n"
+		  "-i [seconds] rotate the -o file at multiples of seconds.\n"
+		  "-z [command] run command on each rotated file, e.g. 'zstd -q --rm'.\n"
+		  "-x Write the -o file with O_DIRECT.\n"
+		  "-C Write the -o file in indexed capture format.\n"
 		  "-v Print a little spinner.\n"
 		  "-p Include profiling info in the JSON.\n"
 		  "-P Include PPS JSON in NMEA or raw mode.\n"
 		  "-V Print version and exit.\n\n"
 		  "You must specify one, or more, of -r, -R, or -w\n"
-		  "You must use -o if you use -d.\n");
+		  "You must use -o if you use -d, -B, -m, -i, -z, -x or -C.\n");
 }
 
 int main(int argc, char **argv)
 {
-    char buf[4096];
+    char buf[65536];
     bool timestamp = false;
     char *format = "%F %T";
-    char tmstr[200];
     bool daemonize = false;
     bool binary = false;
     bool sleepy = false;
@@ -135,7 +555,8 @@ int main(int argc, char **argv)
     long count = -1;
     int option;
     unsigned int vflag = 0, l = 0;
-    FILE *fp;
+    size_t j = 0;			/* bytes of this line in serbuf */
+    FILE *fp = NULL;
     unsigned int flags;
     fd_set fds;
 
@@ -144,7 +565,7 @@ int main(int argc, char **argv)
     char *outfile = NULL;
 
     flags = WATCH_ENABLE;
-    while ((option = getopt(argc, argv, "?dD:lhrRwStT:vVn:s:o:pPu2")) != -1) {
+    while ((option = getopt(argc, argv, "?dD:lhrRwStT:vVn:s:o:pPu2B:m:i:z:xC")) != -1) {
 	switch (option) {
 	case 'D':
 	    debug = atoi(optarg);
@@ -213,6 +634,29 @@ int main(int argc, char **argv)
 	case '2':
 	    flags |= WATCH_SPLIT24;
 	    break;
+	case 'B':
+	    rec.active = true;
+	    rec.size = (size_t)record_size(optarg);
+	    break;
+	case 'm':
+	    rec.active = true;
+	    rec.maxsize = record_size(optarg);
+	    break;
+	case 'i':
+	    rec.active = true;
+	    rec.interval = (time_t)atol(optarg);
+	    break;
+	case 'z':
+	    rec.active = true;
+	    rec.compress = optarg;
+	    break;
+	case 'x':
+	    rec.active = true;
+	    rec.direct = true;
+	    break;
+	case 'C':
+	    capture = true;
+	    break;
 	case '?':
 	case 'h':
 	default:
@@ -237,6 +681,17 @@ int main(int argc, char **argv)
 	exit(EXIT_FAILURE);
     }
 
+    if (outfile == NULL && capture) {
+	(void)fprintf(stderr, "gpspipe: use of '-C' requires '-o'.\n");
+	exit(EXIT_FAILURE);
+    }
+
+    if (outfile == NULL && rec.active) {
+	(void)fprintf(stderr,
+		      "gpspipe: recorder mode (-B, -m, -i, -z, -x) requires '-o'.\n");
+	exit(EXIT_FAILURE);
+    }
+
     if (!raw && !watch && !binary) {
 	(void)fprintf(stderr,
 		      "gpspipe: one of '-R', '-r', or '-w' is required.\n");
@@ -257,10 +712,29 @@ int main(int argc, char **argv)
     /* Open the output file if the user requested it.  If the user
      * requested '-R', we use the 'b' flag in fopen() to "do the right
      * thing" in non-linux/unix OSes. */
-    if (outfile == NULL) {
+    if (rec.active) {
+	/* whole aligned blocks, as O_DIRECT wants */
+	if (rec.size == 0)
+	    rec.size = RECORD_BUFSIZE;
+	rec.size = (rec.size + RECORD_ALIGN - 1) / RECORD_ALIGN * RECORD_ALIGN;
+	if (posix_memalign((void **)&rec.buf, RECORD_ALIGN, rec.size) != 0) {
+	    (void)fprintf(stderr, "gpspipe: can't allocate %zu byte buffer\n",
+			  rec.size);
+	    exit(EXIT_FAILURE);
+	}
+#ifndef O_DIRECT
+	rec.direct = false;
+#endif /* O_DIRECT */
+	if (rec.compress != NULL)
+	    (void)signal(SIGCHLD, SIG_IGN);
+	rec.path = outfile;
+	record_recover();
+	record_open();
+	(void)atexit(record_close);
+    } else if (outfile == NULL) {
 	fp = stdout;
     } else {
-	if (binary)
+	if (binary || capture)
 	    fp = fopen(outfile, "wb");
 	else
 	    fp = fopen(outfile, "w");
@@ -271,6 +745,8 @@ int main(int argc, char **argv)
 			  outfile);
 	    exit(EXIT_FAILURE);
 	}
+	if (capture)
+	    capture_begin(fp, outfile);
     }
 
     /* Open the serial port and set it up. */
@@ -293,10 +769,25 @@ int main(int argc, char **argv)
     if ((isatty(STDERR_FILENO) == 0) || daemonize)
 	vflag = 0;
 
+    {
+	struct sigaction sa;
+
+	/* no SA_RESTART, so a signal breaks us out of select() */
+	memset(&sa, '\0', sizeof(sa));
+	sa.sa_handler = onsig;
+	(void)sigfillset(&sa.sa_mask);
+	(void)sigaction(SIGHUP, &sa, NULL);
+	(void)sigaction(SIGINT, &sa, NULL);
+	(void)sigaction(SIGTERM, &sa, NULL);
+    }
+
     for (;;) {
 	int r = 0;
 	struct timeval tv;
 
+	if (signalled)
+	    finish(fp);
+
 	tv.tv_sec = 0;
 	tv.tv_usec = 100000;
 	FD_ZERO(&fds);
@@ -307,8 +798,11 @@ int main(int argc, char **argv)
 	    (void)fprintf(stderr, "gpspipe: select error %s(%d)\n",
 			  strerror(errno), errno);
 	    exit(EXIT_FAILURE);
-	} else if (r == 0)
-		continue;
+	} else if (r <= 0) {
+	    if (rec.active)
+		record_tick(time(NULL), new_line || binary);
+	    continue;
+	}
 
 	if (vflag)
 	    spinner(vflag, l++);
@@ -317,82 +811,87 @@ int main(int argc, char **argv)
 	errno = 0;
 	r = (int)read(gpsdata.gps_fd, buf, sizeof(buf));
 	if (r > 0) {
-	    int i = 0;
-	    int j = 0;
-	    for (i = 0; i < r; i++) {
-		char c = buf[i];
-		if (j < (int)(sizeof(serbuf) - 1)) {
-		    serbuf[j++] = buf[i];
+	    char *cp = buf, *end = buf + r;
+
+	    /* super-raw data have no framing; a record per read */
+	    if (capture && binary) {
+		(void)clock_gettime(CLOCK_MONOTONIC, &capmono);
+		(void)clock_gettime(CLOCK_REALTIME, &capreal);
+		capture_emit(fp, buf, (size_t)r, BAD_PACKET);
+	    }
+
+	    /* a line, or what we have of it, at a time */
+	    while (cp < end) {
+		char *eol = memchr(cp, '\n', (size_t)(end - cp));
+		char *stop = (eol != NULL) ? eol + 1 : end;
+		size_t n = (size_t)(stop - cp);
+
+		if (serialport != NULL) {
+		    size_t room = sizeof(serbuf) - 1 - j;
+
+		    memcpy(serbuf + j, cp, (n < room) ? n : room);
+		    j += (n < room) ? n : room;
 		}
-		if (new_line && timestamp) {
-		    char tmstr_u[20];            // time with "usec" resolution
-		    struct timespec now;
-		    struct tm *tmp_now;
-
-		    (void)clock_gettime(CLOCK_REALTIME, &now);
-		    tmp_now = localtime((time_t *)&(now.tv_sec));
-		    (void)strftime(tmstr, sizeof(tmstr), format, tmp_now);
-		    new_line = 0;
-
-		    switch( option_u ) {
-		    case 2:
-			(void)snprintf(tmstr_u, sizeof(tmstr_u),
-				       " %ld.%06ld",
-				       (long)now.tv_sec,
-				       (long)now.tv_nsec/1000);
-			break;
-		    case 1:
-			(void)snprintf(tmstr_u, sizeof(tmstr_u),
-				       ".%06ld", (long)now.tv_nsec/1000);
-			break;
-		    default:
-			*tmstr_u = '\0';
-			break;
+		if (capture) {
+		    /* records carry their own time stamps */
+		    if (!binary)
+			capture_add(fp, cp, n, eol != NULL);
+		} else {
+		    if (new_line && timestamp) {
+			const char *tmstr = stamp(format, option_u);
+
+			output(fp, tmstr, strlen(tmstr));
+			new_line = false;
 		    }
-
-		    if (fprintf(fp, "%.24s%s: ", tmstr, tmstr_u) <= 0) {
-			(void)fprintf(stderr,
-				      "gpspipe: write error, %s(%d)\n",
-				      strerror(errno), errno);
+		    output(fp, cp, n);
+		}
+		cp = stop;
+		if (eol == NULL)
+		    break;
+
+		if (serialport != NULL) {
+		    if (write(fd_out, serbuf, j) == -1) {
+			fprintf(stderr,
+				"gpspipe: serial port write error, %s(%d)\n",
+				strerror(errno), errno);
 			exit(EXIT_FAILURE);
 		    }
+		    j = 0;
 		}
-		if (fputc(c, fp) == EOF) {
-		    fprintf(stderr, "gpspipe: write error, %s(%d)\n",
-			    strerror(errno), errno);
-		    exit(EXIT_FAILURE);
-		}
-
-		if (c == '\n') {
-		    if (serialport != NULL) {
-			if (write(fd_out, serbuf, (size_t) j) == -1) {
-			    fprintf(stderr,
-				    "gpspipe: serial port write error, %s(%d)\n",
-				    strerror(errno), errno);
-			    exit(EXIT_FAILURE);
-			}
-			j = 0;
-		    }
 
-		    new_line = true;
+		new_line = true;
+		if (rec.active) {
+		    /* files only ever end between lines */
+		    if (rec.maxsize > 0
+			&& rec.written + (off_t)rec.len >= rec.maxsize)
+			record_rotate();
+		    else if (rec.interval > 0)
+			record_tick(time(NULL), true);
+		} else if (fflush(fp)) {
 		    /* flush after every good line */
-		    if (fflush(fp)) {
-			(void)fprintf(stderr,
-				      "gpspipe: fflush error, %s(%d)\n",
-				      strerror(errno), errno);
-			exit(EXIT_FAILURE);
-		    }
-		    if (count > 0) {
-			if (0 >= --count) {
-			    /* completed count */
-			    exit(EXIT_SUCCESS);
-			}
+		    (void)fprintf(stderr,
+				  "gpspipe: fflush error, %s(%d)\n",
+				  strerror(errno), errno);
+		    exit(EXIT_FAILURE);
+		}
+		if (count > 0) {
+		    if (0 >= --count) {
+			/* completed count */
+			exit(EXIT_SUCCESS);
 		    }
 		}
 	    }
+	    if (rec.active) {
+		/* super-raw data need not have lines at all */
+		if (binary && rec.maxsize > 0
+		    && rec.written + (off_t)rec.len >= rec.maxsize)
+		    record_rotate();
+		else
+		    record_tick(time(NULL), new_line || binary);
+	    }
 	} else {
 	    if (r == -1) {
-		if (errno == EAGAIN)
+		if (errno == EAGAIN || errno == EINTR)
 		    continue;
 		else
 		    (void)fprintf(stderr, "gpspipe: read error %s(%d)\n",
@@ -0,0 +1,423 @@
+/*
+ * gpsreplay - feed a log to gpsd through virtual devices, on time
+ *
+ * Each virtual device is a pty announced to gpsd through its control
+ * socket, the same way gpsdctl announces a hotplugged receiver, so the
+ * daemon takes it through gpsd_add_device() and the ordinary open,
+ * sniff and dispatch path.  The logs are cut into packets up front;
+ * while replaying, each packet is written when its original offset
+ * divided by the speedup comes due.  Deadlines are absolute
+ * CLOCK_MONOTONIC times, so sleep overshoot never accumulates, and
+ * the devices are staggered by a fraction of a packet gap rather than
+ * fired in lockstep.  The achieved rates and the timing error are
+ * reported at the end.
+ *
+ * This file is Copyright (c) 2010 by the GPSD project
+ * BSD terms apply: see the file COPYING in the distribution root for details.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <errno.h>
+#include <string.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+
+#include "gpsd.h"
+#include "capture.h"
+#include "vdev.h"
+#include "revision.h"
+#include "strfuncs.h"
+
+#define DRAIN_INTERVAL	100000000LL	/* ns between reads of gpsd's probes */
+
+struct packet_t {
+    int64_t offset;		/* ns from the start of the log */
+    size_t start, len;		/* in the arena */
+};
+
+struct replay_t {
+    struct vdev_t dev;
+    int64_t phase;		/* ns this device runs behind the schedule */
+    size_t next;		/* packet due next */
+    unsigned long cycle;	/* completed passes over the log */
+};
+
+static struct {
+    unsigned char *arena;
+    size_t used, size;
+    struct packet_t *packets;
+    size_t count, allocated;
+    int64_t duration;		/* ns from the first packet to past the last */
+} load;
+
+static struct replay_t *vdevs;
+static unsigned long stalls;
+static int nvdevs;
+static char *control_socket = DEFAULT_GPSD_SOCKET;
+static struct gps_context_t context;
+static volatile sig_atomic_t stopping = 0;
+
+static int64_t now_ns(void)
+{
+    struct timespec ts;
+
+    (void)clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static void onsig(int sig UNUSED)
+{
+    stopping = 1;
+}
+
+static void add_packet(int64_t offset, const unsigned char *data, size_t len)
+{
+    if (load.count == load.allocated) {
+	load.allocated = load.allocated ? load.allocated * 2 : 4096;
+	load.packets = (struct packet_t *)realloc(load.packets,
+				  load.allocated * sizeof(struct packet_t));
+    }
+    while (load.used + len > load.size) {
+	load.size = load.size ? load.size * 2 : 1024 * 1024;
+	load.arena = (unsigned char *)realloc(load.arena, load.size);
+    }
+    if (load.packets == NULL || load.arena == NULL) {
+	(void)fputs("gpsreplay: out of memory loading the log.\n", stderr);
+	exit(EXIT_FAILURE);
+    }
+    memcpy(load.arena + load.used, data, len);
+    load.packets[load.count].offset = offset;
+    load.packets[load.count].start = load.used;
+    load.packets[load.count].len = len;
+    load.used += len;
+    load.count++;
+}
+
+static bool load_capture(const char *path, const char *begin,
+			 const char *end)
+/* take the packets of a capture file with their recorded spacing */
+{
+    struct capture_t cap;
+    struct capture_record_t rec;
+    int64_t from = 0, until = 0, first = 0, last = 0, base = load.duration;
+    size_t n = 0;
+
+    if (!capture_open(&cap, path)) {
+	(void)fprintf(stderr, "gpsreplay: can't read capture %s: %s\n",
+		      path, strerror(errno));
+	return false;
+    }
+    if ((begin != NULL && !capture_parse_time(begin, &cap, &from))
+	|| (end != NULL && !capture_parse_time(end, &cap, &until))) {
+	(void)fputs("gpsreplay: unrecognized time in -B or -E\n", stderr);
+	capture_close(&cap);
+	return false;
+    }
+    if (begin != NULL && !capture_seek(&cap, from)) {
+	capture_close(&cap);
+	return true;
+    }
+    while (capture_next(&cap, &rec) == 1) {
+	if (until != 0 && rec.real > until)
+	    break;
+	if (rec.type == COMMENT_PACKET)
+	    continue;
+	if (n++ == 0)
+	    first = rec.mono;
+	last = rec.mono;
+	add_packet(base + rec.mono - first, rec.data, rec.len);
+    }
+    capture_close(&cap);
+    if (n > 0)
+	/* leave a mean gap before whatever follows */
+	load.duration = base + (last - first) + (last - first) / (int64_t)n;
+    return true;
+}
+
+static bool load_log(const char *path, double baud, double cycle)
+/*
+ * Cut a raw log into packets with the lexer, as gpsfake does, and
+ * space them by the time they take on a line at baud, or by a fixed
+ * cycle if one is given.
+ */
+{
+    struct gps_lexer_t lexer;
+    int fd;
+
+    if ((fd = open(path, O_RDONLY)) == -1) {
+	(void)fprintf(stderr, "gpsreplay: can't open %s: %s\n",
+		      path, strerror(errno));
+	return false;
+    }
+    lexer_init(&lexer);
+    lexer.errout = context.errout;
+    for (;;) {
+	ssize_t st;
+
+	lexer.outbuflen = 0;
+	if ((st = packet_get(fd, &lexer)) == -1) {
+	    (void)fprintf(stderr, "gpsreplay: read error on %s: %s\n",
+			  path, strerror(errno));
+	    (void)close(fd);
+	    return false;
+	}
+	if (lexer.outbuflen > 0 && lexer.type != COMMENT_PACKET
+	    && lexer.type != BAD_PACKET) {
+	    add_packet(load.duration, lexer.outbuffer, lexer.outbuflen);
+	    if (cycle > 0)
+		load.duration += (int64_t)(cycle * 1e9);
+	    else
+		/* 8N1: ten bit times per byte */
+		load.duration += (int64_t)(lexer.outbuflen * 10 * 1e9 / baud);
+	} else if (st == 0 && packet_buffered_input(&lexer) <= 0)
+	    break;
+    }
+    (void)close(fd);
+    return true;
+}
+
+static void drain(void)
+{
+    int i;
+
+    for (i = 0; i < nvdevs; i++)
+	vdev_drain(&vdevs[i].dev);
+}
+
+static void usage(void)
+{
+    (void)fputs("Usage: gpsreplay [-h] [-V] [-v] [-D debuglevel] "
+		"[-F control-socket] [-n devices]\n"
+		"                 [-x speedup] [-s baud] [-c cycle] "
+		"[-r repeat] [-B begin] [-E end] logfile...\n", stderr);
+}
+
+int main(int argc, char **argv)
+{
+    char *begin = NULL, *end = NULL;
+    double speedup = 1, baud = 4800, cycle = 0;
+    unsigned long repeat = 1;
+    int ndevices = 1, verbose = 0, sock, ch, i;
+    int64_t start, stop, gap, next_drain, next_report;
+    int64_t late_total = 0, late_max = 0;
+    unsigned long long packets = 0, bytes = 0;
+    struct sigaction sa;
+
+    gps_context_init(&context, "gpsreplay");
+    if (getenv("GPSD_SOCKET") != NULL)
+	control_socket = getenv("GPSD_SOCKET");
+    while ((ch = getopt(argc, argv, "B:c:D:E:F:hn:r:s:vVx:")) != -1) {
+	switch (ch) {
+	case 'B':
+	    begin = optarg;
+	    break;
+	case 'c':
+	    cycle = atof(optarg);
+	    break;
+	case 'D':
+	    context.errout.debug = atoi(optarg);
+	    break;
+	case 'E':
+	    end = optarg;
+	    break;
+	case 'F':
+	    control_socket = optarg;
+	    break;
+	case 'n':
+	    ndevices = atoi(optarg);
+	    break;
+	case 'r':
+	    repeat = strtoul(optarg, NULL, 10);
+	    break;
+	case 's':
+	    baud = atof(optarg);
+	    break;
+	case 'v':
+	    verbose++;
+	    break;
+	case 'V':
+	    (void)fprintf(stderr, "%s: %s (revision %s)\n",
+			  argv[0], VERSION, REVISION);
+	    exit(EXIT_SUCCESS);
+	case 'x':
+	    speedup = atof(optarg);
+	    break;
+	case 'h':
+	case '?':
+	default:
+	    usage();
+	    exit(EXIT_FAILURE);
+	}
+    }
+    if (optind >= argc || ndevices < 1 || baud <= 0 || speedup < 0) {
+	usage();
+	exit(EXIT_FAILURE);
+    }
+
+    for (i = optind; i < argc; i++) {
+	char magic[8];
+	FILE *fp;
+	bool ok, captured;
+
+	if ((fp = fopen(argv[i], "rb")) == NULL) {
+	    (void)fprintf(stderr, "gpsreplay: can't open %s: %s\n",
+			  argv[i], strerror(errno));
+	    exit(EXIT_FAILURE);
+	}
+	captured = fread(magic, 1, sizeof(magic), fp) == sizeof(magic)
+	    && memcmp(magic, CAPTURE_MAGIC, sizeof(magic)) == 0;
+	(void)fclose(fp);
+	if (captured)
+	    ok = load_capture(argv[i], begin, end);
+	else
+	    ok = load_log(argv[i], baud, cycle);
+	if (!ok)
+	    exit(EXIT_FAILURE);
+    }
+    if (load.count == 0) {
+	(void)fputs("gpsreplay: no packets in the logs.\n", stderr);
+	exit(EXIT_FAILURE);
+    }
+    gap = load.duration / (int64_t)load.count;
+
+    if ((sock = netlib_localsocket(control_socket, SOCK_STREAM)) < 0) {
+	(void)fprintf(stderr, "gpsreplay: can't reach gpsd at %s\n",
+		      control_socket);
+	exit(EXIT_FAILURE);
+    }
+    vdevs = (struct replay_t *)calloc((size_t)ndevices, sizeof(struct replay_t));
+    if (vdevs == NULL)
+	exit(EXIT_FAILURE);
+    for (i = 0; i < ndevices; i++) {
+	struct replay_t *vp = &vdevs[nvdevs];
+
+	if (!vdev_open(&vp->dev)) {
+	    (void)fprintf(stderr, "gpsreplay: can't make a pty: %s\n",
+			  strerror(errno));
+	    break;
+	}
+	if (vdev_control(sock, '+', vp->dev.path) != 0) {
+	    /* most likely the daemon's device table is full */
+	    (void)fprintf(stderr,
+			  "gpsreplay: gpsd refused %s, going on with %d devices\n",
+			  vp->dev.path, nvdevs);
+	    vdev_close(&vp->dev);
+	    break;
+	}
+	vp->phase = gap * nvdevs / ndevices;
+	nvdevs++;
+    }
+    if (nvdevs == 0)
+	exit(EXIT_FAILURE);
+
+    memset(&sa, '\0', sizeof(sa));
+    sa.sa_handler = onsig;
+    (void)sigaction(SIGINT, &sa, NULL);
+    (void)sigaction(SIGTERM, &sa, NULL);
+    (void)sigaction(SIGHUP, &sa, NULL);
+
+    (void)fprintf(stderr, "gpsreplay: %zu packets over %.3f s into %d devices at %gx\n",
+		  load.count, load.duration / 1e9, nvdevs, speedup);
+    start = next_drain = next_report = now_ns();
+    next_report += 1000000000LL;
+    while (!stopping) {
+	struct replay_t *vp = NULL;
+	const struct packet_t *pp;
+	int64_t due = 0, now;
+
+	/* the device whose next packet is due first */
+	for (i = 0; i < nvdevs; i++) {
+	    struct replay_t *cand = &vdevs[i];
+	    int64_t t;
+
+	    if (repeat != 0 && cand->cycle >= repeat)
+		continue;
+	    t = (int64_t)cand->cycle * load.duration
+		+ load.packets[cand->next].offset + cand->phase;
+	    if (vp == NULL || t < due) {
+		vp = cand;
+		due = t;
+	    }
+	}
+	if (vp == NULL)
+	    break;
+	pp = &load.packets[vp->next];
+
+	if (speedup > 0) {
+	    struct timespec at;
+
+	    due = start + (int64_t)(due / speedup);
+	    at.tv_sec = (time_t)(due / 1000000000LL);
+	    at.tv_nsec = (long)(due % 1000000000LL);
+	    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &at, NULL)
+		   == EINTR && !stopping)
+		continue;
+	    now = now_ns();
+	    if (now > due) {
+		late_total += now - due;
+		if (now - due > late_max)
+		    late_max = now - due;
+	    }
+	} else
+	    now = now_ns();
+
+	if (!vdev_write(&vp->dev, load.arena + pp->start, pp->len,
+			&stalls, &stopping)) {
+	    if (!stopping)
+		(void)fprintf(stderr, "gpsreplay: write to %s failed: %s\n",
+			      vp->dev.path, strerror(errno));
+	    break;
+	}
+	packets++;
+	bytes += pp->len;
+	if (++vp->next == load.count) {
+	    vp->next = 0;
+	    vp->cycle++;
+	}
+
+	if (now >= next_drain) {
+	    drain();
+	    next_drain = now + DRAIN_INTERVAL;
+	}
+	if (verbose > 0 && now >= next_report) {
+	    (void)fprintf(stderr, "gpsreplay: %.0f s, %llu packets, %llu bytes\n",
+			  (now - start) / 1e9, packets, bytes);
+	    next_report += 1000000000LL;
+	}
+    }
+    stop = now_ns();
+
+    for (i = 0; i < nvdevs; i++) {
+	(void)vdev_control(sock, '-', vdevs[i].dev.path);
+	vdev_close(&vdevs[i].dev);
+    }
+    (void)close(sock);
+
+    if (stop > start) {
+	double secs = (stop - start) / 1e9;
+
+	(void)printf("gpsreplay: %llu packets, %llu bytes to %d devices in %.3f s\n",
+		     packets, bytes, nvdevs, secs);
+	(void)printf("gpsreplay: achieved %.1f packets/s, %.0f bytes/s",
+		     packets / secs, bytes / secs);
+	if (speedup > 0)
+	    (void)printf(" (schedule %.1f packets/s)",
+			 nvdevs * load.count * speedup / (load.duration / 1e9));
+	(void)putchar('\n');
+	if (speedup > 0 && packets > 0)
+	    (void)printf("gpsreplay: lateness mean %.1f us, max %.1f us; %lu stalls\n",
+			 late_total / 1e3 / packets, late_max / 1e3, stalls);
+	else
+	    (void)printf("gpsreplay: %lu stalls\n", stalls);
+    }
+    exit(EXIT_SUCCESS);
+}
+
+/* gpsreplay.c ends here */
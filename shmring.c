@@ -0,0 +1,191 @@
+/*
+ * shmring.c - export every report through a shared-memory ring
+ *
+ * The writer side of shmring.h.  gpsd is the only writer; readers
+ * attach to the segment read-only and follow the sequence numbers.
+ *
+ * This file is Copyright (c) 2010 by the GPSD project
+ * BSD terms apply: see the file COPYING in the distribution root for details.
+ */
+#include <errno.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ipc.h>
+#include <sys/shm.h>
+
+#include "gpsd.h"
+#include "shmring.h"
+#include "strfuncs.h"
+
+#ifdef SHM_EXPORT_ENABLE
+
+bool shmring_acquire(struct gps_context_t *context)
+/* initialize the report ring */
+{
+    long shmkey = getenv("GPSD_SHMRING_KEY") ?
+	strtol(getenv("GPSD_SHMRING_KEY"), NULL, 0) : GPSD_SHMRING_KEY;
+    struct shmring_t *ring;
+
+    int shmid = shmget((key_t)shmkey, sizeof(struct shmring_t),
+		       (int)(IPC_CREAT|0666));
+    if (shmid == -1) {
+	gpsd_log(&context->errout, LOG_ERROR,
+		 "shmget(0x%lx, %zd, 0666) for SHM ring failed: %s\n",
+		 shmkey, sizeof(struct shmring_t), strerror(errno));
+	return false;
+    } else
+	gpsd_log(&context->errout, LOG_PROG,
+		 "shmget(0x%lx, %zd, 0666) for SHM ring succeeded\n",
+		 shmkey, sizeof(struct shmring_t));
+
+    context->shmring = (void *)shmat(shmid, 0, 0);
+    if ((int)(long)context->shmring == -1) {
+	gpsd_log(&context->errout, LOG_ERROR,
+		 "shmat failed: %s\n", strerror(errno));
+	context->shmring = NULL;
+	return false;
+    }
+
+    /* readers key off magic, so it goes in last */
+    ring = (struct shmring_t *)context->shmring;
+    memset(ring, '\0', sizeof(struct shmring_t));
+    ring->version = SHMRING_VERSION;
+    ring->size = SHMRING_BYTES;
+    ring->devices = SHMRING_DEVICES;
+    memory_barrier();
+    ring->magic = SHMRING_MAGIC;
+
+    gpsd_log(&context->errout, LOG_PROG,
+	     "shmat() for SHM ring succeeded, segment %d, %d bytes\n",
+	     shmid, SHMRING_BYTES);
+    return true;
+}
+
+void shmring_release(struct gps_context_t *context)
+/* release the report ring */
+{
+    if (context->shmring == NULL)
+	return;
+
+    ((struct shmring_t *)context->shmring)->magic = 0;
+    (void)shmdt((const void *)context->shmring);
+    context->shmring = NULL;
+}
+
+static void shmring_retire(struct shmring_t *ring, uint64_t end)
+/* move tail past every record that writing up to end will overwrite */
+{
+    while (end - ring->tail > SHMRING_BYTES)
+	ring->tail += ((struct shmring_header_t *)
+		       shmring_at(ring, ring->tail))->length;
+}
+
+static struct shmring_header_t *shmring_begin(struct shmring_t *ring,
+					      size_t len)
+/* claim room for a record of len bytes, header included */
+{
+    uint64_t pos = ring->head;
+    size_t room = SHMRING_BYTES - (size_t)(pos & (SHMRING_BYTES - 1));
+    struct shmring_header_t *h;
+
+    len = SHMRING_ALIGN(len);
+    if (room < len) {
+	/* records never wrap; pad out to the end and start over */
+	shmring_retire(ring, pos + room);
+	ring->reserve = pos + room;
+	memory_barrier();
+	h = (struct shmring_header_t *)shmring_at(ring, pos);
+	h->length = (uint32_t)room;
+	h->class = SHMRING_PAD;
+	memory_barrier();
+	ring->head = pos += room;
+    }
+    shmring_retire(ring, pos + len);
+    ring->reserve = pos + len;
+    memory_barrier();
+    h = (struct shmring_header_t *)shmring_at(ring, pos);
+    h->length = (uint32_t)len;
+    return h;
+}
+
+static void shmring_commit(struct shmring_t *ring,
+			   struct shmring_header_t *h)
+/* publish the record claimed by shmring_begin() */
+{
+    memory_barrier();
+    ring->head += h->length;
+}
+
+void shmring_publish(struct gps_context_t *context,
+		     struct gps_device_t *device, int slot,
+		     gps_mask_t changed)
+/* append one record per report class in changed */
+{
+    struct shmring_t *ring = (struct shmring_t *)context->shmring;
+    struct gps_data_t *gpsdata = &device->gpsdata;
+    struct shmring_header_t *h;
+    timestamp_t now;
+
+    if (ring == NULL)
+	return;
+
+    if (slot < SHMRING_DEVICES
+	&& strcmp(ring->path[slot], gpsdata->dev.path) != 0)
+	(void)strlcpy(ring->path[slot], gpsdata->dev.path,
+		      sizeof(ring->path[slot]));
+
+    now = timestamp();
+#define SHMRING_PAYLOAD(h)	((void *)((h) + 1))
+#define SHMRING_HEADER(cls, size)	\
+	h = shmring_begin(ring, sizeof(struct shmring_header_t) + (size)); \
+	h->number = ring->published++;	\
+	h->class = cls;	\
+	h->device = (uint16_t)slot;	\
+	h->time = now
+
+    if ((changed & REPORT_IS) != 0) {
+	struct shmring_tpv_t *tpv;
+
+	SHMRING_HEADER(SHMRING_TPV, sizeof(struct shmring_tpv_t));
+	tpv = (struct shmring_tpv_t *)SHMRING_PAYLOAD(h);
+	tpv->fix = gpsdata->fix;
+	tpv->status = gpsdata->status;
+	shmring_commit(ring, h);
+    }
+    if ((changed & SATELLITE_SET) != 0) {
+	struct shmring_sky_t *sky;
+	int n = gpsdata->satellites_visible;
+
+	if (n < 0)
+	    n = 0;
+	else if (n > MAXCHANNELS)
+	    n = MAXCHANNELS;
+	/* only the visible part; readers must not look past it */
+	SHMRING_HEADER(SHMRING_SKY, offsetof(struct shmring_sky_t, skyview)
+		       + n * sizeof(struct satellite_t));
+	sky = (struct shmring_sky_t *)SHMRING_PAYLOAD(h);
+	sky->satellites_visible = n;
+	sky->satellites_used = gpsdata->satellites_used;
+	sky->dop = gpsdata->dop;
+	memcpy(sky->skyview, gpsdata->skyview,
+	       n * sizeof(struct satellite_t));
+	shmring_commit(ring, h);
+    }
+    if ((changed & GST_SET) != 0) {
+	SHMRING_HEADER(SHMRING_GST, sizeof(struct gst_t));
+	*(struct gst_t *)SHMRING_PAYLOAD(h) = gpsdata->gst;
+	shmring_commit(ring, h);
+    }
+    if ((changed & AIS_SET) != 0) {
+	SHMRING_HEADER(SHMRING_AIS, sizeof(struct ais_t));
+	*(struct ais_t *)SHMRING_PAYLOAD(h) = gpsdata->ais;
+	shmring_commit(ring, h);
+    }
+#undef SHMRING_HEADER
+#undef SHMRING_PAYLOAD
+}
+
+#endif /* SHM_EXPORT_ENABLE */
+
+/* shmring.c ends here */
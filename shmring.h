@@ -0,0 +1,195 @@
+/*
+ * shmring.h - layout of, and reader for, the shared-memory report ring
+ *
+ * Where the classic shared-memory export (shmexport.c) holds only the
+ * latest gps_data_t, the report ring keeps the most recent reports of
+ * every class gpsd emits.  Local readers can follow every update
+ * without syscalls and tell when they have fallen so far behind that
+ * records were overwritten.
+ *
+ * Records are variable-length and packed end to end into a byte ring,
+ * so each takes only what its class needs: a TPV is a fix and a
+ * status, a SKY carries only the satellites in view.  A record never
+ * wraps; when one would not fit before the end of the ring, a padding
+ * record fills the gap and the next starts at the beginning.
+ *
+ * Positions in the ring are byte counts that only ever grow.  There is
+ * one writer (gpsd) and any number of readers; nobody locks.  Before
+ * writing, gpsd advances reserve past the bytes it is about to
+ * overwrite; after writing, it advances head.  A reader looks at
+ * reserve after copying a record: if it has moved more than a ring's
+ * length past the record, the copy may be torn and is thrown away.
+ *
+ * This file is Copyright (c) 2010 by the GPSD project
+ * BSD terms apply: see the file COPYING in the distribution root for details.
+ */
+#ifndef _GPSD_SHMRING_H_
+#define _GPSD_SHMRING_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "gps.h"
+#include "compiler.h"
+
+#define GPSD_SHMRING_KEY	0x47505352	/* "GPSR" */
+#define SHMRING_MAGIC		0x52494e47	/* "RING" */
+#define SHMRING_VERSION		2
+#define SHMRING_BYTES		(1 << 18)	/* must be a power of two */
+#define SHMRING_DEVICES		32		/* device slots with a path */
+
+/* report classes */
+#define SHMRING_PAD	0	/* filler up to the end of the ring */
+#define SHMRING_TPV	1
+#define SHMRING_SKY	2
+#define SHMRING_GST	3
+#define SHMRING_AIS	4
+
+struct shmring_header_t {
+    /* a padding record may be as short as these first three */
+    uint32_t length;		/* header and payload, a multiple of 8 */
+    uint16_t class;		/* SHMRING_* */
+    uint16_t device;		/* gpsd's device slot */
+    uint64_t number;		/* records published before this one */
+    timestamp_t time;		/* when gpsd published it */
+};
+
+struct shmring_tpv_t {
+    struct gps_fix_t fix;
+    int status;
+};
+
+struct shmring_sky_t {
+    int satellites_visible;
+    int satellites_used;
+    struct dop_t dop;
+    struct satellite_t skyview[MAXCHANNELS];	/* only visible ones stored */
+};
+
+/* a record as copied out; in the ring each is only as long as it needs */
+struct shmring_record_t {
+    struct shmring_header_t h;
+    union {
+	struct shmring_tpv_t tpv;
+	struct shmring_sky_t sky;
+	struct gst_t gst;
+	struct ais_t ais;
+    } u;
+};
+
+#define SHMRING_ALIGN(n)	(((n) + 7) & ~(size_t)7)
+
+struct shmring_t {
+    uint32_t magic;		/* SHMRING_MAGIC once initialized */
+    uint32_t version;		/* SHMRING_VERSION */
+    uint32_t size;		/* SHMRING_BYTES */
+    uint32_t devices;		/* SHMRING_DEVICES */
+    volatile uint64_t head;	/* bytes ever published */
+    volatile uint64_t reserve;	/* bytes ever claimed by the writer */
+    volatile uint64_t tail;	/* start of the oldest intact record */
+    uint64_t published;		/* records ever published */
+    char path[SHMRING_DEVICES][GPS_PATH_MAX];	/* by device slot */
+    uint64_t data[SHMRING_BYTES / sizeof(uint64_t)];
+};
+
+#define shmring_at(ring, pos) \
+	((unsigned char *)(ring)->data + ((pos) & (SHMRING_BYTES - 1)))
+
+/*
+ * Reader side.  Keep a cursor, starting at shmring_oldest() or
+ * shmring_newest(), and call shmring_read() until it returns 0.  The
+ * number in each record's header shows how many were missed after an
+ * overrun.  A device's path is in ring->path[] under its slot number;
+ * when gpsd reuses a slot for another device, records published just
+ * before may be reported under the new path.
+ */
+
+static inline uint64_t shmring_newest(const struct shmring_t *ring)
+/* cursor that will see only records published from now on */
+{
+    return ring->head;
+}
+
+static inline uint64_t shmring_oldest(const struct shmring_t *ring)
+/* cursor at the oldest record still in the ring */
+{
+    return ring->tail;
+}
+
+static inline int shmring_read(const struct shmring_t *ring,
+			       uint64_t *cursor,
+			       struct shmring_record_t *out)
+/*
+ * Copy out the record at *cursor and advance it.  Returns 1 on success,
+ * 0 if there is nothing new, or -1 if the reader was overrun; in that
+ * case *cursor has been moved to the oldest surviving record.
+ */
+{
+    for (;;) {
+	uint64_t head = ring->head;
+	size_t off = (size_t)(*cursor & (SHMRING_BYTES - 1));
+	size_t len, copy;
+
+	memory_barrier();
+	if (*cursor >= head)
+	    return 0;
+	if (head - *cursor > SHMRING_BYTES) {
+	    *cursor = ring->tail;
+	    return -1;
+	}
+	len = ((const struct shmring_header_t *)shmring_at(ring, *cursor))->length;
+	copy = len;
+	if (copy > sizeof(*out))
+	    copy = sizeof(*out);
+	if (copy > SHMRING_BYTES - off)
+	    copy = SHMRING_BYTES - off;
+	memcpy(out, shmring_at(ring, *cursor), copy);
+	memory_barrier();
+	/* was any of it overwritten while we copied? */
+	if (ring->reserve - *cursor > SHMRING_BYTES
+	    || len == 0 || len > SHMRING_BYTES - off) {
+	    *cursor = ring->tail;
+	    return -1;
+	}
+	*cursor += len;
+	if (out->h.class != SHMRING_PAD)
+	    return 1;
+    }
+}
+
+static inline bool shmring_still_valid(const struct shmring_t *ring,
+				       uint64_t cursor)
+/* has nothing overwritten the record at cursor yet? */
+{
+    memory_barrier();
+    return ring->reserve - cursor <= SHMRING_BYTES;
+}
+
+static inline const struct shmring_record_t *
+shmring_peek(const struct shmring_t *ring, uint64_t *cursor)
+/*
+ * Zero-copy access to the record at *cursor, skipping padding, or NULL
+ * if there is none.  Whatever was read from it is only good if
+ * shmring_still_valid() agrees afterwards; then advance *cursor by the
+ * record's length.
+ */
+{
+    for (;;) {
+	const struct shmring_record_t *rec;
+	uint32_t len;
+
+	if (*cursor >= ring->head)
+	    return NULL;
+	memory_barrier();
+	rec = (const struct shmring_record_t *)shmring_at(ring, *cursor);
+	if (rec->h.class != SHMRING_PAD)
+	    return rec;
+	len = rec->h.length;
+	if (!shmring_still_valid(ring, *cursor))
+	    return NULL;
+	*cursor += len;
+    }
+}
+
+#endif /* _GPSD_SHMRING_H_ */
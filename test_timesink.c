@@ -0,0 +1,156 @@
+/*
+ * test_timesink.c - drive the time-sink filters with synthetic timestamps
+ *
+ * This file is Copyright (c) 2010 by the GPSD project
+ * BSD terms apply: see the file COPYING in the distribution root for details.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "gpsd.h"
+#include "revision.h"
+
+static int verbose = 0;
+static int fail_count = 0;
+
+static struct timedelta_t sample(double offset)
+/* a time sample with the system clock offset seconds behind */
+{
+    struct timedelta_t td;
+    long nsec = (long)(offset * 1e9);
+
+    td.clock.tv_sec = 1000;
+    td.clock.tv_nsec = 500000000;
+    td.real.tv_sec = 1000 + nsec / 1000000000;
+    td.real.tv_nsec = 500000000 + nsec % 1000000000;
+    return td;
+}
+
+static void check(bool ok, const char *what)
+{
+    if (!ok) {
+	(void)printf("FAILED: %s\n", what);
+	fail_count++;
+    } else if (verbose)
+	(void)printf("ok: %s\n", what);
+}
+
+static bool offer(const struct timefilter_conf_t *conf,
+		  struct timefilter_t *state, double offset, bool locked,
+		  timestamp_t now)
+{
+    struct timedelta_t td = sample(offset);
+
+    return timefilter_accept(conf, state, &td, locked, now);
+}
+
+static void test_outliers(void)
+{
+    struct timefilter_conf_t conf = {5, 0.001, 0, 0};
+    struct timefilter_t state;
+    timestamp_t now = 0;
+    int i;
+
+    timefilter_reset(&state);
+    for (i = 0; i < 5; i++)
+	check(offer(&conf, &state, 0.0001 * i, true, now += 1),
+	      "samples are accepted while the window fills");
+    check(!offer(&conf, &state, 0.5, true, now += 1),
+	  "an offset far from the median is rejected");
+    check(offer(&conf, &state, 0.0002, true, now += 1),
+	  "the next normal sample is accepted");
+    check(state.rejected == 1, "one sample counted as rejected");
+
+    /* a genuine step is followed once it is the median */
+    check(!offer(&conf, &state, 0.2, true, now += 1),
+	  "the first sample after a step is rejected");
+    check(!offer(&conf, &state, 0.2, true, now += 1),
+	  "the second sample after a step is rejected");
+    check(offer(&conf, &state, 0.2, true, now += 1),
+	  "the step is followed once it is the median");
+}
+
+static void test_interval(void)
+{
+    struct timefilter_conf_t conf = {0, 0, 2.0, 0};
+    struct timefilter_t state;
+
+    timefilter_reset(&state);
+    check(offer(&conf, &state, 0, true, 10.0), "first sample delivered");
+    check(!offer(&conf, &state, 0, true, 11.0),
+	  "sample inside the interval held back");
+    check(offer(&conf, &state, 0, true, 12.0),
+	  "sample after the interval delivered");
+    check(state.delivered == 2 && state.ratelimited == 1,
+	  "delivered and rate-limited counts");
+}
+
+static void test_holdover(void)
+{
+    struct timefilter_conf_t conf = {0, 0, 0, 5.0};
+    struct timefilter_t state;
+    timestamp_t now;
+
+    timefilter_reset(&state);
+    check(!timefilter_holdover(&conf, &state, 100.0),
+	  "no holdover before the first good sample");
+    check(offer(&conf, &state, 0, true, 100.0), "locked sample delivered");
+    check(!timefilter_holdover(&conf, &state, 104.0),
+	  "no holdover inside the timeout");
+
+    /* the fix is lost but the receiver clock keeps sending time */
+    for (now = 101.0; now <= 110.0; now += 1)
+	check(offer(&conf, &state, 0, false, now),
+	      "unlocked samples are still delivered");
+    check(timefilter_holdover(&conf, &state, 110.0),
+	  "holdover once the timeout passes without a locked sample");
+
+    /* samples stop altogether; the main-loop sweep sees it too */
+    check(timefilter_holdover(&conf, &state, 200.0),
+	  "holdover persists with no samples at all");
+
+    check(offer(&conf, &state, 0, true, 201.0), "locked sample delivered");
+    check(!timefilter_holdover(&conf, &state, 201.0),
+	  "the first locked sample ends holdover");
+
+    conf.holdover = 0;
+    check(!timefilter_holdover(&conf, &state, 1000.0),
+	  "a zero timeout never enters holdover");
+}
+
+int main(int argc, char *argv[])
+{
+    int option;
+
+    while ((option = getopt(argc, argv, "h?vV")) != -1) {
+	switch (option) {
+	default:
+		fail_count = 1;
+		/* FALL THROUGH! */
+	case '?':
+	case 'h':
+	    (void)fputs("usage: test_timesink [-v] [-V]\n", stderr);
+	    exit(fail_count);
+	case 'V':
+	    (void)fprintf( stderr, "test_timesink %s\n",
+		VERSION);
+	    exit(EXIT_SUCCESS);
+	case 'v':
+	    verbose = 1;
+	    break;
+	}
+    }
+
+    test_outliers();
+    test_interval();
+    test_holdover();
+
+    if (fail_count)
+	(void)printf("timesink tests failed: %d\n", fail_count);
+    exit(fail_count ? EXIT_FAILURE : EXIT_SUCCESS);
+}
+
+/* end */
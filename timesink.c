@@ -0,0 +1,107 @@
+/*
+ * timesink.c - per-sink filters for the time-delivery pipeline
+ *
+ * Each time sink (NTP SHM, JSON TOFF/PPS, ...) can screen the samples
+ * offered to it: median-of-N outlier rejection on the offset, a
+ * minimum interval between deliveries, and a holdover timeout after
+ * which the sink is flagged as running without good samples.  A good
+ * sample is one that passes the outlier check while the device has a
+ * fix; time that keeps arriving after the fix is lost, from the
+ * receiver's own clock or its PPS, is still delivered, flagged as
+ * holdover once the timeout has run out.
+ *
+ * Everything here works on caller-held state and takes the current
+ * time as an argument, so it can be driven with synthetic timestamps.
+ *
+ * This file is Copyright (c) 2010 by the GPSD project
+ * BSD terms apply: see the file COPYING in the distribution root for details.
+ */
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "gpsd.h"
+
+#ifdef NTP_ENABLE
+
+static int cmp_double(const void *a, const void *b)
+{
+    double x = *(const double *)a, y = *(const double *)b;
+
+    return (x > y) - (x < y);
+}
+
+double timefilter_offset(const struct timedelta_t *td)
+/* how far the system clock is behind the reference, in seconds */
+{
+    return (double)(td->real.tv_sec - td->clock.tv_sec)
+	+ (double)(td->real.tv_nsec - td->clock.tv_nsec) / 1e9;
+}
+
+void timefilter_reset(struct timefilter_t *state)
+{
+    memset(state, '\0', sizeof(*state));
+}
+
+bool timefilter_accept(const struct timefilter_conf_t *conf,
+		       struct timefilter_t *state,
+		       const struct timedelta_t *td, bool locked,
+		       timestamp_t now)
+/*
+ * Run a sample through a sink's filters; true if it should be
+ * delivered.  locked says whether the device had a fix behind it.
+ */
+{
+    double offset = timefilter_offset(td);
+    int window = conf->median;
+
+    if (window > TIMEFILTER_MEDIAN_MAX)
+	window = TIMEFILTER_MEDIAN_MAX;
+
+    /* reject samples too far from the median of the last few */
+    if (window > 1 && conf->maxdev > 0) {
+	bool outlier = false;
+
+	if (state->nwindow >= window) {
+	    double sorted[TIMEFILTER_MEDIAN_MAX];
+
+	    memcpy(sorted, state->window, window * sizeof(double));
+	    qsort(sorted, (size_t)window, sizeof(double), cmp_double);
+	    outlier = fabs(offset - sorted[window / 2]) > conf->maxdev;
+	}
+	/* outliers still enter the window, so a genuine step is followed */
+	state->window[state->next] = offset;
+	state->next = (state->next + 1) % window;
+	if (state->nwindow < window)
+	    state->nwindow++;
+	if (outlier) {
+	    state->rejected++;
+	    return false;
+	}
+    }
+
+    if (locked)
+	state->lastgood = now;
+
+    if (conf->mininterval > 0 && state->delivered > 0
+	&& now - state->lastsent < conf->mininterval) {
+	state->ratelimited++;
+	return false;
+    }
+    state->lastsent = now;
+    state->delivered++;
+    return true;
+}
+
+bool timefilter_holdover(const struct timefilter_conf_t *conf,
+			 struct timefilter_t *state, timestamp_t now)
+/* update and return whether the sink has gone too long without a good sample */
+{
+    state->holdover = conf->holdover > 0 && state->lastgood > 0
+	&& now - state->lastgood > conf->holdover;
+    return state->holdover;
+}
+
+#endif /* NTP_ENABLE */
+
+/* timesink.c ends here */
@@ -0,0 +1,187 @@
+/*
+ * trace.c - binary trace ring buffers
+ *
+ * gpsd_log() formats every message it emits and writes it synchronously,
+ * which is too slow to leave on at high verbosity while a device is
+ * streaming.  A trace point instead stores a timestamp, a pointer to its
+ * (string literal) format and up to TRACE_NARGS integer arguments in a
+ * fixed-size record in a per-thread ring; nothing is formatted until the
+ * rings are drained, on demand, through the control socket.
+ *
+ * Each thread writes only to its own ring, so writers never contend.
+ * Old records are overwritten when a ring wraps; the drainer notices
+ * and reports how many it lost.  There is a single drainer.
+ *
+ * This file is Copyright (c) 2010 by the GPSD project
+ * BSD terms apply: see the file COPYING in the distribution root for details.
+ */
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "gpsd.h"
+#include "strfuncs.h"
+
+#ifdef TRACE_ENABLE
+
+struct trace_record_t {
+    timestamp_t time;
+    const char *fmt;		/* only the pointer is kept */
+    int level;
+    long arg[TRACE_NARGS];
+};
+
+struct trace_ring_t {
+    volatile unsigned long head;	/* records ever written */
+    unsigned long tail;			/* records drained; drainer only */
+    bool inuse;				/* owned by a live thread */
+    struct trace_record_t rec[TRACE_RING_SIZE];
+};
+
+static struct trace_ring_t rings[TRACE_RINGS];
+static pthread_mutex_t rings_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_key_t ring_key;
+static pthread_once_t ring_key_once = PTHREAD_ONCE_INIT;
+static volatile int trace_level = LOG_ERROR - 1;	/* off */
+
+static void trace_ring_release(void *ring)
+/* thread exit: let another thread have this ring */
+{
+    (void)pthread_mutex_lock(&rings_mutex);
+    ((struct trace_ring_t *)ring)->inuse = false;
+    (void)pthread_mutex_unlock(&rings_mutex);
+}
+
+static void trace_key_create(void)
+{
+    (void)pthread_key_create(&ring_key, trace_ring_release);
+}
+
+static struct trace_ring_t *trace_ring(void)
+/* return the calling thread's ring, claiming a free one on first use */
+{
+    struct trace_ring_t *ring;
+
+    (void)pthread_once(&ring_key_once, trace_key_create);
+    ring = (struct trace_ring_t *)pthread_getspecific(ring_key);
+    if (ring == NULL) {
+	(void)pthread_mutex_lock(&rings_mutex);
+	for (ring = rings; ring < rings + TRACE_RINGS; ring++)
+	    if (!ring->inuse) {
+		ring->inuse = true;
+		break;
+	    }
+	(void)pthread_mutex_unlock(&rings_mutex);
+	if (ring == rings + TRACE_RINGS)
+	    return NULL;	/* too many threads, drop the record */
+	(void)pthread_setspecific(ring_key, ring);
+    }
+    return ring;
+}
+
+void gpsd_trace_setlevel(int level)
+/* set the highest level recorded; below LOG_ERROR turns tracing off */
+{
+    trace_level = level;
+}
+
+int gpsd_trace_getlevel(void)
+{
+    return trace_level;
+}
+
+void gpsd_trace(int level, const char *fmt,
+		long a0, long a1, long a2, long a3)
+/* record a trace point without formatting it */
+{
+    struct trace_ring_t *ring;
+    struct trace_record_t *rec;
+
+    if (level > trace_level || (ring = trace_ring()) == NULL)
+	return;
+
+    rec = &ring->rec[ring->head % TRACE_RING_SIZE];
+    rec->time = timestamp();
+    rec->fmt = fmt;
+    rec->level = level;
+    rec->arg[0] = a0;
+    rec->arg[1] = a1;
+    rec->arg[2] = a2;
+    rec->arg[3] = a3;
+    /* the record must be complete before the drainer can see it */
+    memory_barrier();
+    ring->head++;
+}
+
+static bool trace_peek(struct trace_ring_t *ring,
+		       struct trace_record_t *rec, unsigned long *lost)
+/*
+ * Copy out the oldest undrained record of a ring, if there is one.
+ * The writer fills rec[head] before it advances head, so once head is
+ * TRACE_RING_SIZE ahead of a slot that slot may be half rewritten.
+ */
+{
+    for (;;) {
+	unsigned long head = ring->head;
+	unsigned long tail;
+
+	memory_barrier();
+	if (head - ring->tail >= TRACE_RING_SIZE) {
+	    *lost += head - ring->tail - (TRACE_RING_SIZE - 1);
+	    ring->tail = head - (TRACE_RING_SIZE - 1);
+	}
+	tail = ring->tail;
+	if (tail == head)
+	    return false;
+	*rec = ring->rec[tail % TRACE_RING_SIZE];
+	memory_barrier();
+	/* was the writer at or past our slot while we were copying? */
+	if (ring->head - tail < TRACE_RING_SIZE)
+	    return true;
+    }
+}
+
+size_t gpsd_trace_dump(char *buf, size_t buflen)
+/*
+ * Format undrained records, oldest first across all rings, into buf.
+ * Returns the length written; call again until it returns 0.
+ */
+{
+    unsigned long lost = 0;
+
+    buf[0] = '\0';
+    for (;;) {
+	struct trace_record_t rec, best;
+	struct trace_ring_t *ring, *bestring = NULL;
+	char line[BUFSIZ];
+
+	for (ring = rings; ring < rings + TRACE_RINGS; ring++)
+	    if (trace_peek(ring, &rec, &lost)
+		&& (bestring == NULL || rec.time < best.time)) {
+		best = rec;
+		bestring = ring;
+	    }
+	if (bestring == NULL)
+	    break;
+
+	line[0] = '\0';
+	if (lost > 0)
+	    str_appendf(line, sizeof(line), "%lu trace records lost\n", lost);
+	str_appendf(line, sizeof(line), "%.6f %d %d: ",
+		    best.time, (int)(bestring - rings), best.level);
+	str_appendf(line, sizeof(line), best.fmt,
+		    best.arg[0], best.arg[1], best.arg[2], best.arg[3]);
+	if (line[strlen(line) - 1] != '\n')
+	    (void)strlcat(line, "\n", sizeof(line));
+	if (strlen(buf) + strlen(line) >= buflen)
+	    break;		/* leave it for the next call */
+	(void)strlcat(buf, line, buflen);
+	bestring->tail++;
+	lost = 0;
+    }
+    return strlen(buf);
+}
+
+#endif /* TRACE_ENABLE */
+
+/* trace.c ends here */
@@ -0,0 +1,121 @@
+/*
+ * vdev.c - virtual devices for feeding a running gpsd
+ *
+ * See vdev.h.  Masters are non-blocking: gpsd falling behind shows up
+ * as a full pty, which vdev_write() waits out and counts.
+ *
+ * This file is Copyright (c) 2010 by the GPSD project
+ * BSD terms apply: see the file COPYING in the distribution root for details.
+ */
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE		/* for posix_openpt() and ptsname() */
+#endif /* _GNU_SOURCE */
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <string.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <termios.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#include "vdev.h"
+#include "strfuncs.h"
+
+bool vdev_open(struct vdev_t *vp)
+/* make a pty for gpsd to read, keeping the slave side open */
+{
+    struct termios t;
+    char *name;
+
+    if ((vp->master = posix_openpt(O_RDWR | O_NOCTTY)) == -1)
+	return false;
+    if (grantpt(vp->master) == -1 || unlockpt(vp->master) == -1
+	|| (name = ptsname(vp->master)) == NULL) {
+	(void)close(vp->master);
+	return false;
+    }
+    (void)strlcpy(vp->path, name, sizeof(vp->path));
+    /* hold the slave so gpsd reopening it never sees a hangup */
+    if ((vp->slave = open(vp->path, O_RDWR | O_NOCTTY)) == -1) {
+	(void)close(vp->master);
+	return false;
+    }
+    if (tcgetattr(vp->slave, &t) == 0) {
+	cfmakeraw(&t);
+	(void)tcsetattr(vp->slave, TCSANOW, &t);
+    }
+    /* as gpsdctl does, so gpsd can still use it after dropping root */
+    (void)fchmod(vp->slave, S_IRUSR|S_IWUSR|S_IRGRP|S_IWGRP);
+    (void)fcntl(vp->master, F_SETFL,
+		fcntl(vp->master, F_GETFL) | O_NONBLOCK);
+    return true;
+}
+
+void vdev_close(struct vdev_t *vp)
+{
+    (void)close(vp->master);
+    (void)close(vp->slave);
+    vp->master = vp->slave = -1;
+}
+
+int vdev_control(int sock, char op, const char *path)
+/*
+ * Send a + or - command for path over the control socket; the format
+ * has to match handle_control() in gpsd.c.  Returns 0 on OK.
+ */
+{
+    char buf[GPS_PATH_MAX + 8];
+    ssize_t n;
+
+    (void)snprintf(buf, sizeof(buf), "%c%s\r\n", op, path);
+    if (write(sock, buf, strlen(buf)) != (ssize_t)strlen(buf))
+	return -1;
+    if ((n = read(sock, buf, sizeof(buf) - 1)) <= 0)
+	return -1;
+    buf[n] = '\0';
+    return str_starts_with(buf, "OK") ? 0 : -1;
+}
+
+void vdev_drain(struct vdev_t *vp)
+/* discard whatever gpsd wrote while probing, so it never blocks */
+{
+    char junk[BUFSIZ];
+
+    while (read(vp->master, junk, sizeof(junk)) > 0)
+	continue;
+}
+
+bool vdev_write(struct vdev_t *vp, const unsigned char *data, size_t len,
+		unsigned long *stalls, volatile sig_atomic_t *stop)
+/*
+ * Write a whole packet, waiting while the pty is full and counting
+ * each wait in stalls.  False on a write error, or if stop gets set
+ * while waiting.
+ */
+{
+    while (len > 0) {
+	ssize_t w = write(vp->master, data, len);
+
+	if (w >= 0) {
+	    data += w;
+	    len -= (size_t)w;
+	} else if (errno == EAGAIN) {
+	    struct pollfd pfd;
+
+	    (*stalls)++;
+	    vdev_drain(vp);
+	    pfd.fd = vp->master;
+	    pfd.events = POLLOUT;
+	    (void)poll(&pfd, 1, 100);
+	    if (stop != NULL && *stop)
+		return false;
+	} else if (errno != EINTR)
+	    return false;
+    }
+    return true;
+}
+
+/* vdev.c ends here */
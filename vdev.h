@@ -0,0 +1,34 @@
+/*
+ * vdev.h - virtual devices for feeding a running gpsd
+ *
+ * A virtual device is a pty whose slave side gpsd is told to open
+ * through its control socket, the same way gpsdctl hands it a
+ * hotplugged receiver; whatever is written to the master side then
+ * reaches the daemon as if it came off a serial line.  Used by the
+ * replay and benchmark tools.
+ *
+ * This file is Copyright (c) 2010 by the GPSD project
+ * BSD terms apply: see the file COPYING in the distribution root for details.
+ */
+#ifndef _GPSD_VDEV_H_
+#define _GPSD_VDEV_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <signal.h>
+
+#include "gps.h"
+
+struct vdev_t {
+    int master, slave;
+    char path[GPS_PATH_MAX];
+};
+
+extern bool vdev_open(struct vdev_t *);
+extern void vdev_close(struct vdev_t *);
+extern int vdev_control(int, char, const char *);
+extern void vdev_drain(struct vdev_t *);
+extern bool vdev_write(struct vdev_t *, const unsigned char *, size_t,
+		       unsigned long *, volatile sig_atomic_t *);
+
+#endif /* _GPSD_VDEV_H_ */